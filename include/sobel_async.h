@@ -0,0 +1,58 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+
+#include "sobel_filter.h"
+
+// Asynchronous 3x3 Sobel magnitude on the library's worker threads. Each frame
+// is split into row bands, and at most maxInFlight frames are queued or running
+// at a time: submit blocks until a slot frees up, which gives double buffering
+// with maxInFlight = 2. Source and destination must stay valid, and the destination
+// untouched, until the frame completes. Frames may complete out of order,
+// and run on the highest tier up to isa the host supports.
+class SobelQueue {
+public:
+	SobelQueue(uint32_t maxInFlight, SobelIsa isa);
+	~SobelQueue();  // Waits for all submitted frames
+
+	SobelQueue(const SobelQueue&) = delete;
+	SobelQueue& operator=(const SobelQueue&) = delete;
+
+	// Future becomes ready once dst holds the magnitude
+	std::future<void> submit(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst);
+
+	// done runs on a worker thread once dst holds the magnitude, it must not submit to this queue.
+	// done must not throw either: there is no caller to report to, so an exception escaping it is
+	// caught and dropped, and the frame is still completed.
+	void submit(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, std::function<void()> done);
+
+	// Blocks until every submitted frame has completed
+	void wait() noexcept;
+
+	uint32_t in_flight() const noexcept;
+
+private:
+	void acquire() noexcept;
+	void release() noexcept;
+
+	const uint32_t maxInFlight;
+	const SobelIsa isa;
+	mutable std::mutex lock;
+	std::condition_variable released;
+	uint32_t inFlight;
+};
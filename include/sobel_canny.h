@@ -0,0 +1,25 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "sobel_filter.h"
+
+// Canny edges on the 3x3 Sobel gradient. Gradients and non-maximum suppression run
+// in one banded sweep on the library worker threads, keeping only a three row ring
+// of gradients per band. Hysteresis then runs on packed bit rows: a pixel is an edge
+// when it survives suppression with a normalized magnitude above low and is
+// 8-connected through such pixels to one above high. edges is a packed mask like
+// sobel_edge_mask. src and bytesPerLineSrc must be aligned for the chosen tier like
+// the single image kernels.
+void sobel_canny(const float* src, uint8_t* edges, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineEdges, float low, float high, SobelIsa isa) noexcept;
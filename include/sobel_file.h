@@ -0,0 +1,52 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "sobel_filter.h"
+
+// File to file 3x3 Sobel magnitude for images larger than memory. Input and output
+// are memory mapped and walked in row bands: each band and its one row halo are
+// converted into a small aligned staging buffer, filtered, converted back into the
+// output, and the pages behind the band are dropped with madvise. Resident memory
+// is a few bands whatever the image size.
+//
+// kRaw    Headerless little endian 32 bit floats, dense rows, dimensions given by the caller
+// kPfm    Grayscale "Pf" portable float map, either byte order. Rows stay in file order,
+//         which leaves the magnitude unchanged.
+// kPgm    Binary "P5" portable gray map with 8 or 16 bit samples (big endian), the
+//         magnitude is rounded and saturated to the input's maximum value
+enum class SobelFileFormat : uint32_t {
+	kRaw,
+	kPfm,
+	kPgm
+};
+
+enum class SobelFileStatus : uint32_t {
+	kOk,
+	kOpenFailed,     // Input could not be opened or output created
+	kBadHeader,      // Unsupported or malformed header, or a file too short for it
+	kMapFailed,      // mmap or resizing the output failed
+	kUnsupported,    // No memory mapping on this platform
+	kSameFile        // Output names the input file, through any path or link
+};
+
+// Writes the magnitude of input to output in the input's format. width and height are
+// only used for kRaw. bandRows of 0 picks a default. Bands run on the highest tier up
+// to isa the host supports.
+SobelFileStatus sobel_filter_file(const char* input, const char* output, SobelFileFormat format, uint32_t width, uint32_t height, uint32_t bandRows, SobelIsa isa) noexcept;
+
+// Format of a file from its header, kRaw when it is neither PFM nor PGM
+SobelFileFormat sobel_file_format(const char* path) noexcept;
+
+const char* sobel_file_status_string(SobelFileStatus status) noexcept;
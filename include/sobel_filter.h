@@ -17,3 +17,90 @@ void sobel_filter(const float* __restrict src, float* __restrict dst, uint32_t w
 void sobel_filter_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
 void sobel_filter_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
 void sobel_filter_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel_filter_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+
+// Double precision variants with the same stride, border and scaling semantics (2/4/8 lanes)
+void sobel_filter(const double* __restrict src, double* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel_filter_sse2(const double* __restrict src, double* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel_filter_avx2(const double* __restrict src, double* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel_filter_avx512(const double* __restrict src, double* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+
+// 3x3 Scharr, 5x5 and 7x7 Sobel gradient magnitude, normalized like the 3x3 Sobel filter
+void scharr_filter(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void scharr_filter_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void scharr_filter_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void scharr_filter_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void scharr_filter_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel5_filter(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel5_filter_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel5_filter_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel5_filter_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel5_filter_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel7_filter(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel7_filter_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel7_filter_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel7_filter_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+void sobel7_filter_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+
+// Pixel storage formats. 16 bit sources are widened to float in registers, the
+// magnitude is narrowed to the destination format on store (16 bit integers are
+// rounded and saturated). Rows are aligned like the float kernels, in elements.
+enum class SobelFormat : uint32_t {
+	kFloat32,
+	kFloat16,
+	kUInt16
+};
+
+// 3x3 Sobel filter on float, half float (F16C) or 16 bit integer storage
+void sobel_filter_format(const void* __restrict src, void* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatSrc, SobelFormat formatDst) noexcept;
+void sobel_filter_format_avx2(const void* __restrict src, void* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatSrc, SobelFormat formatDst) noexcept;
+void sobel_filter_format_avx512(const void* __restrict src, void* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatSrc, SobelFormat formatDst) noexcept;
+
+// 3x3 Sobel edge mask, bit x (least significant bit first) of a mask row is set where the normalized
+// magnitude exceeds threshold. Trailing bits of the last byte in a row are cleared. A negative
+// threshold sets every bit, and all tiers give the same mask for the same input.
+void sobel_edge_mask(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept;
+void sobel_edge_mask_sse2(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept;
+void sobel_edge_mask_avx2(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept;
+void sobel_edge_mask_avx512(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept;
+void sobel_edge_mask_avx512vl(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept;
+
+// Gradient statistics of the normalized 3x3 Sobel magnitude
+struct SobelStats {
+	double focus;             // Tenengrad focus score, sum of squared magnitudes
+	float maximum;            // Largest magnitude
+	uint64_t histogram[256];  // Magnitudes binned uniformly over [0, histogramMax), larger values land in the last bin
+};
+
+// 3x3 Sobel filter that gathers SobelStats in the same sweep. dst may be nullptr, in which case only
+// the source is read and nothing but the statistics is written. A histogramMax that is not positive
+// (or NaN) puts every magnitude into the last bin.
+void sobel_filter_stats(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept;
+void sobel_filter_stats_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept;
+void sobel_filter_stats_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept;
+void sobel_filter_stats_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept;
+void sobel_filter_stats_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept;
+
+// Instruction set tiers. Values are stable, so the tier added last comes last even
+// though the 256 bit kAvx512Vl ranks between kAvx2 and kAvx512 in capability.
+enum class SobelIsa : uint32_t {
+	kScalar,
+	kSse2,
+	kAvx2,      // AVX2 with FMA and F16C
+	kAvx512,    // AVX-512F on 512 bit registers
+	kAvx512Vl   // AVX-512F and VL on 256 bit registers
+};
+
+// Best tier supported by the CPU and operating system. This is never kAvx512Vl, the
+// 512 bit tier is available wherever it is: request kAvx512Vl by name, or let
+// sobel_filter_tuned time it against the others.
+SobelIsa sobel_detect_isa() noexcept;
+
+// True when the CPU and operating system can run isa
+bool sobel_isa_supported(SobelIsa isa) noexcept;
+
+// Lower case name of a tier: "scalar", "sse2", "avx2", "avx512" or "avx512vl"
+const char* sobel_isa_name(SobelIsa isa) noexcept;
+
+// Tier spelled as sobel_isa_name does into isa, false for any other name
+bool sobel_isa_parse(const char* name, SobelIsa* isa) noexcept;
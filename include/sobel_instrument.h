@@ -0,0 +1,60 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "sobel_filter.h"
+
+// Optional instrumentation of the 3x3 float kernels (sobel_filter and its SIMD tiers),
+// compiled in with the SOBEL_INSTRUMENTATION CMake option. When it is off the kernels
+// carry no probes at all, sobel_instrument_query returns false and dump prints one line.
+//
+// Whole image calls and the row bands that the threaded, planned, NUMA and pyramid paths
+// run are probed. The other kernels are not: double precision, storage formats, Scharr,
+// 5x5 and 7x7, edge mask, statistics, the pipeline's single rows, Canny and temporal.
+
+// Branch of a kernel. Width classes refer to the SIMD block of the tier that ran.
+enum class SobelPath : uint32_t {
+	kScalar,
+	kSingleBlock,      // Width of exactly one block
+	kMultiBlock,       // Width a multiple of the block, two blocks or more
+	kSingleBlockTail,  // One block and a partial one
+	kMultiBlockTail,   // Two blocks or more and a partial one
+	kFixed,            // Compile-time specialized production shape
+	kBand,             // Row band of a split call, any width
+	kCount
+};
+
+struct SobelCounters {
+	uint64_t calls;
+	uint64_t paddedCalls;   // Calls where either stride exceeds the row, the rest were dense
+	uint64_t pixels;
+	uint64_t bytes;         // Source and destination pixels moved
+	uint64_t nanoseconds;   // Wall time
+	uint64_t cycles;        // Hardware counters, zero unless hardwareCounters is set
+	uint64_t instructions;
+	uint64_t llcMisses;
+};
+
+struct SobelInstrumentStats {
+	bool hardwareCounters;  // perf_event_open succeeded for at least one calling thread
+	SobelCounters counters[5][static_cast<uint32_t>(SobelPath::kCount)];  // Indexed by SobelIsa, then SobelPath
+};
+
+// Snapshot of the counters since start up or the last reset, false when instrumentation is compiled out
+bool sobel_instrument_query(SobelInstrumentStats* stats) noexcept;
+void sobel_instrument_reset() noexcept;
+
+// One line per ISA and path that ran, with throughput, IPC and LLC misses per pixel
+void sobel_instrument_dump(FILE* file) noexcept;
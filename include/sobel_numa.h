@@ -0,0 +1,43 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "sobel_filter.h"
+
+// NUMA aware 3x3 Sobel magnitude. Every node with CPUs gets its own pool of workers
+// pinned one per CPU, and each row band of a frame runs on the pool of the node that
+// holds the band's source pages, so the destination band is first touched there too.
+// The topology comes from /sys/devices/system/node, without it everything is one node.
+
+// Nodes with CPUs available to the process
+uint32_t sobel_numa_nodes() noexcept;
+
+// Runs on the highest tier up to isa the host supports
+void sobel_filter_numa(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelIsa isa) noexcept;
+
+// Throughput of one node on a frame allocated and first touched on that node
+struct SobelNumaNode {
+	uint32_t node;        // Operating system node id
+	uint32_t cpus;
+	double singleThread;  // Mpix/s with one worker of the node
+	double allThreads;    // Mpix/s with every worker of the node
+	double remote;        // Mpix/s with every worker of the next node, 0 on single node hosts
+};
+
+// Measures up to capacity nodes on a width by height frame with the detected ISA, returns the node count
+uint32_t sobel_numa_report(uint32_t width, uint32_t height, SobelNumaNode* nodes, uint32_t capacity) noexcept;
+
+// Prints the report with the all-thread scaling over one thread per node
+void sobel_numa_dump(FILE* file, uint32_t width, uint32_t height) noexcept;
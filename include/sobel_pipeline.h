@@ -0,0 +1,71 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sobel_filter.h"
+
+// One stage of a row streamed pipeline. Output row y depends on input rows
+// y - halo() to y + halo() only. The pipeline passes them already clamped to the
+// image, 64 byte aligned and width floats long. A stage keeps no state between
+// rows, so bands of one image may run on several threads at once.
+class SobelStage {
+public:
+	virtual ~SobelStage() {}
+
+	virtual uint32_t halo() const noexcept = 0;
+
+	// rows[k] is input row y - halo() + k, out is 64 byte aligned
+	virtual void row(const float* const* rows, float* out, uint32_t width, uint32_t y) const noexcept = 0;
+};
+
+// 3x3 binomial blur with weights 1 2 1
+std::unique_ptr<SobelStage> sobel_stage_blur();
+
+// Normalized 3x3 Sobel magnitude, sobel_filter to within float rounding, on the highest tier up to isa
+std::unique_ptr<SobelStage> sobel_stage_sobel(SobelIsa isa);
+
+// 1 where the input exceeds threshold and 0 elsewhere
+std::unique_ptr<SobelStage> sobel_stage_threshold(float threshold);
+
+// 3x3 maximum and minimum
+std::unique_ptr<SobelStage> sobel_stage_dilate();
+std::unique_ptr<SobelStage> sobel_stage_erode();
+
+// A chain of stages run in one sweep over the image. Source rows are converted to
+// float on the way in, then every row a stage produces goes to a ring buffer of
+// the 2 * halo + 1 rows its consumer reads, so intermediates stay in cache instead
+// of making a full frame pass each. The image is split into row bands on the library
+// worker threads. A band recomputes the halo rows above and below it at every
+// level, which costs 2 * halo rows per stage and band.
+class SobelPipeline {
+public:
+	SobelPipeline() {}
+
+	SobelPipeline(const SobelPipeline&) = delete;
+	SobelPipeline& operator=(const SobelPipeline&) = delete;
+
+	SobelPipeline& add(std::unique_ptr<SobelStage> stage);
+
+	// Rows of source on each side that one output row depends on
+	uint32_t halo() const noexcept;
+
+	// Runs the chain from src into dst, or only the conversion for an empty chain.
+	// bandRows of 0 splits the image evenly between the workers.
+	void run(const void* src, SobelFormat formatSrc, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t bandRows = 0u) const noexcept;
+
+private:
+	std::vector<std::unique_ptr<SobelStage> > stages;
+};
@@ -0,0 +1,39 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "sobel_filter.h"
+
+// FFTW style plans for the 3x3 Sobel magnitude. A plan fixes the shape, strides and
+// storage formats, selects the kernel (including the production shape
+// specializations) and the row bands up front, so executing it is one indirect
+// call for small frames. A plan is immutable once created and may be executed from
+// several threads at once with different buffers.
+struct SobelPlanOptions {
+	SobelIsa isa;       // Highest tier to use, lowered to the best the CPU and strides support
+	uint32_t threads;   // Tasks run at once on the library workers, 0 for all of them, 1 for the caller only
+	uint32_t bandRows;  // Rows per task, 0 for the default
+};
+
+typedef struct SobelPlanData* SobelPlan;
+
+// Returns nullptr for an empty image or strides shorter than a row
+SobelPlan sobel_plan_create(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatSrc, SobelFormat formatDst, const SobelPlanOptions* options) noexcept;
+
+// Buffers must be aligned for the plan's tier like the matching sobel_filter_* call
+void sobel_plan_execute(SobelPlan plan, const void* src, void* dst) noexcept;
+
+SobelIsa sobel_plan_isa(SobelPlan plan) noexcept;
+
+void sobel_plan_destroy(SobelPlan plan) noexcept;
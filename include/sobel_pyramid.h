@@ -0,0 +1,40 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sobel_filter.h"
+
+// One level of a gradient pyramid. Level k + 1 is the 2x2 box average of level k,
+// (width + 1) / 2 by (height + 1) / 2 pixels with an odd last column or row averaged
+// with itself. Image and magnitude rows share bytesPerLine, a multiple of 64.
+struct SobelPyramidLevel {
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytesPerLine;
+	float* image;      // Downsampled source, nullptr for level 0 which is the caller's image
+	float* magnitude;  // Normalized 3x3 Sobel magnitude of image, sobel_filter to within float rounding
+};
+
+// Bytes of arena needed by sobel_pyramid, including slack to align the arena to 64 bytes
+size_t sobel_pyramid_size(uint32_t width, uint32_t height, uint32_t levels) noexcept;
+
+// Builds levels pyramid levels in one sweep per level: each band of rows gets its
+// magnitude and is downsampled into the next level while still in cache. The bands of
+// all levels run as one wavefront on the library worker threads, each starting once
+// the bands above it that feed its rows are done, so coarse levels overlap the fine
+// ones. Small pyramids are built on the calling thread.
+// Runs on the highest tier up to isa the host supports. src and bytesPerLineSrc must
+// be aligned for the chosen tier like the single image kernels.
+void sobel_pyramid(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t levels, void* arena, SobelPyramidLevel* out, SobelIsa isa) noexcept;
@@ -0,0 +1,94 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "sobel_filter.h"
+
+// Local filter service for several processes on one host. A server process owns a
+// named POSIX shared memory segment holding a table of frame slots, each with a
+// source and a destination buffer. Clients map the same segment, write a frame
+// straight into a slot, submit it, and read the 3x3 Sobel magnitude back out of the
+// slot once the server has run it on its single pool of worker threads. Frames are
+// never copied between the processes. Slot states are futex words in the segment:
+// the server sleeps on a submit counter and wakes the waiting client per slot.
+//
+// Linux only, elsewhere every call fails with kUnsupported. The name follows
+// shm_open rules, e.g. "/sobel".
+enum class SobelServiceStatus : uint32_t {
+	kOk,
+	kUnsupported,   // No shared memory futexes on this platform
+	kOpenFailed,    // Segment could not be created or opened
+	kMapFailed,     // Sizing or mapping the segment failed
+	kBadSegment,    // Not a service segment, or one of another layout version
+	kInUse,         // A live server already owns the name
+	kTooLarge,      // Frame larger than the slots of the segment
+	kTimeout,       // No free slot or no result within the timeout
+	kServiceDown,   // The server stopped or died
+	kFailed         // The server could not filter the frame
+};
+
+struct SobelServerOptions {
+	uint32_t slots;      // Frame slots shared by all clients, 0 for the default
+	uint32_t maxWidth;   // Largest frame a slot holds
+	uint32_t maxHeight;
+	SobelIsa isa;        // Highest tier to use
+	uint32_t threads;    // Worker tasks per frame, 0 for all of them
+};
+
+typedef struct SobelServerData* SobelServer;
+typedef struct SobelClientData* SobelClient;
+
+// Creates the segment, replacing one left behind by a server that died
+SobelServer sobel_server_create(const char* name, const SobelServerOptions* options, SobelServiceStatus* status) noexcept;
+
+// Serves submitted frames, oldest first, until sobel_server_stop. Returns kOk once stopped.
+SobelServiceStatus sobel_server_run(SobelServer server) noexcept;
+
+// Makes sobel_server_run return, async signal safe
+void sobel_server_stop(SobelServer server) noexcept;
+
+// Unlinks the segment, clients still waiting see kServiceDown
+void sobel_server_destroy(SobelServer server) noexcept;
+
+// A frame held by a client. src and dst point into the shared segment, rows are
+// bytesPerLine apart and aligned for every tier.
+struct SobelServiceFrame {
+	uint32_t slot;
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytesPerLine;
+	float* src;
+	const float* dst;
+};
+
+SobelClient sobel_client_connect(const char* name, SobelServiceStatus* status) noexcept;
+
+// Reserves a slot for a width by height frame, waiting up to timeoutMs for one to free up.
+// Slots held by clients that exited are reclaimed.
+SobelServiceStatus sobel_client_acquire(SobelClient client, uint32_t width, uint32_t height, uint32_t timeoutMs, SobelServiceFrame* frame) noexcept;
+
+// Hands the frame to the server once frame->src holds the image
+SobelServiceStatus sobel_client_submit(SobelClient client, const SobelServiceFrame* frame) noexcept;
+
+// Waits up to timeoutMs for frame->dst to hold the magnitude. kFailed leaves frame->dst
+// undefined, the slot still has to be released.
+SobelServiceStatus sobel_client_wait(SobelClient client, const SobelServiceFrame* frame, uint32_t timeoutMs) noexcept;
+
+// Returns the slot, its buffers must not be touched afterwards
+void sobel_client_release(SobelClient client, const SobelServiceFrame* frame) noexcept;
+
+// Releases every slot the client still holds
+void sobel_client_disconnect(SobelClient client) noexcept;
+
+const char* sobel_service_status_string(SobelServiceStatus status) noexcept;
@@ -0,0 +1,64 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "sobel_filter.h"
+
+// Spatio-temporal 3x3x3 Sobel over consecutive video frames. gx and gy are the
+// spatial derivatives and gt the temporal one, each smoothed over the other two
+// axes. They are scaled so that a unit step along their axis gives 1, and the
+// magnitude is sqrt(gx^2 + gy^2 + gt^2) / sqrt(3). Borders are replicated in x and y.
+// Frames and outputs are aligned like the matching sobel_filter_* tier.
+struct SobelTemporalOutput {
+	float* gx;           // Any of the four may be nullptr
+	float* gy;
+	float* gt;
+	float* magnitude;
+	uint32_t bytesPerLine;
+};
+
+// Gradients of curr from the frames before and after it, in one sweep
+void sobel_temporal(const float* prev, const float* curr, const float* next, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, const SobelTemporalOutput* output, SobelIsa isa) noexcept;
+
+// Frame ring for a video stream. Each pushed frame is reduced once to its vertical
+// sums, which are kept for the two outputs after it, so a frame's pixels are read
+// only while it is pushed and its buffer may be reused right after.
+class SobelTemporal {
+public:
+	SobelTemporal(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, SobelIsa isa);
+
+	SobelTemporal(const SobelTemporal&) = delete;
+	SobelTemporal& operator=(const SobelTemporal&) = delete;
+
+	// Adds the next frame. From the third frame on, writes the gradients of the frame
+	// pushed before it to output and returns true.
+	bool push(const float* frame, const SobelTemporalOutput* output) noexcept;
+
+	// Forgets the pushed frames, the next push starts a new stream
+	void reset() noexcept;
+
+private:
+	const uint32_t width;
+	const uint32_t height;
+	const uint32_t bytesPerLineSrc;
+	const SobelIsa isa;
+	const uint32_t bytesPerLineSums;
+	std::vector<float> storage;
+	float* smooth[3];
+	float* derivative[3];
+	float* scratch;
+	uint32_t scratchCount;
+	uint64_t pushed;
+};
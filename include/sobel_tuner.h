@@ -0,0 +1,40 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "sobel_filter.h"
+
+// Per host tuning of the 3x3 Sobel magnitude. The first call for an image shape
+// benchmarks every supported ISA tier, band height, thread count and store policy on
+// a synthetic image, the winner is kept in memory and appended to a cache file keyed
+// by the processor model and shape so later runs skip the benchmark. The cache file
+// is $SOBEL_TUNE_CACHE if set, else $HOME/.sobel_tune.
+struct SobelTuning {
+	SobelIsa isa;
+	uint32_t bandRows;           // Rows per task
+	uint32_t threads;            // Tasks run at once, the caller included
+	bool streaming;              // Non-temporal stores for the magnitude
+	double megapixelsPerSecond;  // Measured throughput of the winner
+};
+
+// Tuning for a shape, benchmarked on first use. Concurrent calls get the same tuning
+// for a shape, and only wait on each other for the lookup.
+SobelTuning sobel_tune(uint32_t width, uint32_t height) noexcept;
+
+// Overrides the cache file, nullptr keeps tunings in memory only. Tunings already loaded are kept.
+void sobel_tune_cache_path(const char* path) noexcept;
+
+// 3x3 Sobel filter with the tuned configuration for the shape. Tiers whose alignment
+// src, dst or the strides do not meet are stepped down to the next tier that fits.
+void sobel_filter_tuned(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
@@ -0,0 +1,92 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <utility>
+
+#include "sobel_async.h"
+#include "sobel_internal.h"
+#include "sobel_workers.h"
+
+static constexpr uint32_t kBandRows = 64u;
+
+// Filters one frame in row bands shared between the calling worker and its peers
+static void queue_filter(SobelIsa isa, const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	const SobelRowsFn rows = sobel_kernels(isa).rows;
+	const uint32_t bands = (height + kBandRows - 1u) / kBandRows;
+
+	SobelWorkers::shared().run(bands, [=](uint32_t band) {
+		const uint32_t firstRow = band * kBandRows;
+		rows(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, std::min(firstRow + kBandRows, height));
+	});
+}
+
+SobelQueue::SobelQueue(uint32_t maxInFlight, SobelIsa isa) : maxInFlight(std::max(1u, maxInFlight)), isa(sobel_resolve_isa(isa)), inFlight(0u) {
+}
+
+SobelQueue::~SobelQueue() {
+	wait();
+}
+
+void SobelQueue::acquire() noexcept {
+	std::unique_lock<std::mutex> guard(lock);
+	released.wait(guard, [this] { return inFlight < maxInFlight; });
+	++inFlight;
+}
+
+void SobelQueue::release() noexcept {
+	std::lock_guard<std::mutex> guard(lock);
+	--inFlight;
+	released.notify_all();
+}
+
+std::future<void> SobelQueue::submit(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) {
+	std::shared_ptr<std::promise<void> > promise = std::make_shared<std::promise<void> >();
+	std::future<void> future = promise->get_future();
+
+	submit(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, [promise] { promise->set_value(); });
+	return future;
+}
+
+void SobelQueue::submit(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, std::function<void()> done) {
+#ifdef _DEBUG
+	assert(src != nullptr && dst != nullptr);
+#endif
+	acquire();
+
+	try {
+		SobelWorkers::shared().post([this, src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, done] {
+			queue_filter(isa, src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+			try {
+				if (done) {
+					done();
+				}
+			} catch (...) {
+			}
+			release();
+		});
+	} catch (...) {
+		release();
+		throw;
+	}
+}
+
+void SobelQueue::wait() noexcept {
+	std::unique_lock<std::mutex> guard(lock);
+	released.wait(guard, [this] { return inFlight == 0u; });
+}
+
+uint32_t SobelQueue::in_flight() const noexcept {
+	std::lock_guard<std::mutex> guard(lock);
+	return inFlight;
+}
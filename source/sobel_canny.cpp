@@ -0,0 +1,172 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "sobel_canny.h"
+#include "sobel_engine.h"
+#include "sobel_internal.h"
+#include "sobel_workers.h"
+
+static constexpr uint32_t kMinBandRows = 32u;
+static constexpr uint64_t kParallelPixels = 1u << 16;  // Smaller images run on the caller alone
+static constexpr uintptr_t kScratchAlignment = 64u;
+
+// Grows gen through the runs of pro it touches, in both directions within one word.
+// Runs along an edge are short, so one pixel per step beats a log-step fill.
+static inline uint64_t fill_word(uint64_t gen, uint64_t pro) noexcept {
+	for (;;) {
+		const uint64_t grown = pro & ((gen << 1) | (gen >> 1)) & ~gen;
+		if (grown == 0u) {
+			return gen;
+		}
+		gen |= grown;
+	}
+}
+
+// Carries filled runs across word boundaries, up the row and then down. Words
+// themselves must already be filled.
+static inline void carry_row(uint64_t* row, const uint64_t* mask, uint32_t words) noexcept {
+	for (uint32_t i = 1u; i < words; ++i) {
+		if ((row[i - 1u] >> 63) & mask[i] & ~row[i] & 1u) {
+			row[i] = fill_word(row[i] | 1u, mask[i]);
+		}
+	}
+	for (uint32_t i = words - 1u; i-- > 0u;) {
+		if ((row[i + 1u] & 1u) && ((mask[i] & ~row[i]) >> 63)) {
+			row[i] = fill_word(row[i] | (uint64_t(1u) << 63), mask[i]);
+		}
+	}
+}
+
+// Adds the 8-neighborhood of the edges in an adjacent row to row, within mask, and
+// grows the additions along the row. Returns whether row changed.
+static inline bool grow_row(uint64_t* row, const uint64_t* adjacent, const uint64_t* mask, uint32_t words) noexcept {
+	bool changed = false;
+
+	for (uint32_t i = 0u; i < words; ++i) {
+		const uint64_t before = (i != 0u) ? adjacent[i - 1u] >> 63 : 0u;
+		const uint64_t after = (i + 1u < words) ? adjacent[i + 1u] << 63 : 0u;
+		const uint64_t reach = adjacent[i] | (adjacent[i] << 1) | (adjacent[i] >> 1) | before | after;
+		const uint64_t grown = reach & mask[i] & ~row[i];
+		if (grown != 0u) {
+			row[i] = fill_word(row[i] | grown, mask[i]);
+			changed = true;
+		}
+	}
+
+	if (changed) {
+		carry_row(row, mask, words);
+	}
+	return changed;
+}
+
+// Hysteresis on packed rows, 64 pixels per operation. Edges start as the strong
+// pixels and grow inside the candidates with alternating downward and upward
+// sweeps until a pair of sweeps adds nothing. Every sweep follows an edge any
+// distance as long as it runs in the sweep direction or along a row, so most
+// images settle after one or two pairs.
+static void canny_hysteresis(uint64_t* edges, const uint64_t* candidates, uint32_t words, uint32_t height) noexcept {
+	for (uint32_t y = 0u; y < height; ++y) {
+		uint64_t* row = &edges[y * static_cast<uintptr_t>(words)];
+		const uint64_t* mask = &candidates[y * static_cast<uintptr_t>(words)];
+		for (uint32_t i = 0u; i < words; ++i) {
+			if (row[i] != 0u) {
+				row[i] = fill_word(row[i], mask[i]);
+			}
+		}
+		carry_row(row, mask, words);
+	}
+
+	// A row is grown from a neighbor only when the neighbor changed since the last time
+	std::vector<uint32_t> versions(height, 1u);
+	std::vector<uint32_t> seenAbove(height, 0u);
+	std::vector<uint32_t> seenBelow(height, 0u);
+
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (uint32_t y = 1u; y < height; ++y) {
+			if (seenAbove[y] != versions[y - 1u]) {
+				const uintptr_t offset = y * static_cast<uintptr_t>(words);
+				seenAbove[y] = versions[y - 1u];
+				if (grow_row(&edges[offset], &edges[offset - words], &candidates[offset], words)) {
+					++versions[y];
+					changed = true;
+				}
+			}
+		}
+		for (uint32_t y = height - 1u; y-- > 0u;) {
+			if (seenBelow[y] != versions[y + 1u]) {
+				const uintptr_t offset = y * static_cast<uintptr_t>(words);
+				seenBelow[y] = versions[y + 1u];
+				if (grow_row(&edges[offset], &edges[offset + words], &candidates[offset], words)) {
+					++versions[y];
+					changed = true;
+				}
+			}
+		}
+	}
+}
+
+void sobel_canny(const float* src, uint8_t* edges, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineEdges, float low, float high, SobelIsa isa) noexcept {
+#ifdef _DEBUG
+	assert(bytesPerLineEdges * 8ull >= width);
+#endif
+	if (width == 0u || height == 0u) {
+		return;
+	}
+
+	low = std::max(low, 0.0f);
+	high = std::max(high, low);
+
+	const SobelKernels& kernels = sobel_kernels(sobel_resolve_isa(isa));
+	const uint32_t words = (width + 63u) / 64u;
+
+	// Strong pixels become the edges in place
+	std::vector<uint64_t> bits(2u * static_cast<size_t>(words) * height);
+	uint64_t* strong = bits.data();
+	uint64_t* candidates = strong + static_cast<size_t>(words) * height;
+
+	SobelWorkers& workers = SobelWorkers::shared();
+	const bool parallel = static_cast<uint64_t>(width) * height >= kParallelPixels;
+	const uint32_t bandRows = parallel ? std::max((height + workers.size() - 1u) / workers.size(), kMinBandRows) : height;
+	const uint32_t bands = (height + bandRows - 1u) / bandRows;
+	const uint32_t tasks = parallel ? std::min(workers.size(), bands) : 1u;
+
+	auto task = [&](uint32_t index) {
+		std::vector<float> scratch(kEngineCannyRows * static_cast<size_t>(engine_canny_stride(width)) + kScratchAlignment / sizeof(float));
+		float* aligned = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(scratch.data()) + kScratchAlignment - 1u) & ~(kScratchAlignment - 1u));
+
+		for (uint32_t band = index; band < bands; band += tasks) {
+			const uint32_t firstRow = band * bandRows;
+			kernels.canny(src, width, height, bytesPerLineSrc, firstRow, std::min(firstRow + bandRows, height), low, high, aligned, strong, candidates, words);
+		}
+	};
+
+	if (tasks == 1u) {
+		task(0u);
+	} else {
+		workers.run(tasks, task);
+	}
+
+	canny_hysteresis(strong, candidates, words, height);
+
+	const size_t rowBytes = (width + 7u) / 8u;
+	for (uint32_t y = 0u; y < height; ++y) {
+		memcpy(&edges[y * static_cast<uintptr_t>(bytesPerLineEdges)], &strong[y * static_cast<uintptr_t>(words)], rowBytes);
+	}
+}
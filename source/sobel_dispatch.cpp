@@ -0,0 +1,154 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include "sobel_filter.h"
+#include "sobel_internal.h"
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) noexcept {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+	for (uint32_t i = 0u; i < 4u; ++i) {
+		regs[i] = static_cast<uint32_t>(info[i]);
+	}
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv() noexcept {
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32_t eax;
+	uint32_t edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+// Bit per SobelIsa the CPU and operating system support
+static uint32_t detect_isas() noexcept {
+	uint32_t regs[4];
+	uint32_t isas = 1u << static_cast<uint32_t>(SobelIsa::kScalar);
+
+	cpuid(0u, 0u, regs);
+	const uint32_t maxLeaf = regs[0];
+
+	cpuid(1u, 0u, regs);
+	if ((regs[3] & (1u << 26)) == 0u) {
+		return isas;
+	}
+	isas |= 1u << static_cast<uint32_t>(SobelIsa::kSse2);
+
+	// AVX2 kernels also use FMA and F16C, and need the OS to save the ymm state
+	const bool osxsave = (regs[2] & (1u << 27)) != 0u;
+	const bool avx = (regs[2] & (1u << 28)) != 0u;
+	const bool fma = (regs[2] & (1u << 12)) != 0u;
+	const bool f16c = (regs[2] & (1u << 29)) != 0u;
+	if (!osxsave || !avx || !fma || !f16c || maxLeaf < 7u) {
+		return isas;
+	}
+
+	const uint64_t xcr0 = xgetbv();
+	if ((xcr0 & 0x06u) != 0x06u) {
+		return isas;
+	}
+
+	cpuid(7u, 0u, regs);
+	if ((regs[1] & (1u << 5)) == 0u) {
+		return isas;
+	}
+	isas |= 1u << static_cast<uint32_t>(SobelIsa::kAvx2);
+
+	// AVX-512F with opmask and zmm state enabled, the 256 bit tier also needs VL
+	if ((xcr0 & 0xE6u) == 0xE6u && (regs[1] & (1u << 16)) != 0u) {
+		isas |= 1u << static_cast<uint32_t>(SobelIsa::kAvx512);
+		if ((regs[1] & (1u << 31)) != 0u) {
+			isas |= 1u << static_cast<uint32_t>(SobelIsa::kAvx512Vl);
+		}
+	}
+
+	return isas;
+}
+
+static uint32_t supported_isas() noexcept {
+	static const uint32_t isas = detect_isas();
+	return isas;
+}
+
+bool sobel_isa_supported(SobelIsa isa) noexcept {
+	return static_cast<uint32_t>(isa) < 32u && (supported_isas() & (1u << static_cast<uint32_t>(isa))) != 0u;
+}
+
+SobelIsa sobel_detect_isa() noexcept {
+	// The 512 bit tier is the better of the two AVX-512 tiers unless the core drops its clock for zmm
+	return sobel_resolve_isa(SobelIsa::kAvx512);
+}
+
+SobelIsa sobel_resolve_isa(SobelIsa isa) noexcept {
+	while (!sobel_isa_supported(isa)) {
+		isa = sobel_isa_lower(isa);
+	}
+	return isa;
+}
+
+static const char* const kIsaNames[] = { "scalar", "sse2", "avx2", "avx512", "avx512vl" };
+
+const char* sobel_isa_name(SobelIsa isa) noexcept {
+	const uint32_t index = static_cast<uint32_t>(isa);
+	return index < sizeof(kIsaNames) / sizeof(kIsaNames[0]) ? kIsaNames[index] : "unknown";
+}
+
+bool sobel_isa_parse(const char* name, SobelIsa* isa) noexcept {
+	for (uint32_t i = 0u; i < sizeof(kIsaNames) / sizeof(kIsaNames[0]); ++i) {
+		if (strcmp(name, kIsaNames[i]) == 0) {
+			*isa = static_cast<SobelIsa>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const SobelKernels& sobel_kernels(SobelIsa isa) noexcept {
+	static const SobelKernels kKernels[] = {
+		{ sobel_filter, 2u, sobel_rows, sobel_rows, sobel_row, sobel_canny_rows, sobel_downsample, sobel_fixed, sobel_filter_format, sobel_temporal_sums, sobel_temporal_rows },
+		{ sobel_filter_sse2, 4u, sobel_rows_sse2, sobel_rows_stream_sse2, sobel_row_sse2, sobel_canny_rows_sse2, sobel_downsample_sse2, sobel_fixed_sse2, sobel_filter_format, sobel_temporal_sums_sse2, sobel_temporal_rows_sse2 },
+		{ sobel_filter_avx2, 8u, sobel_rows_avx2, sobel_rows_stream_avx2, sobel_row_avx2, sobel_canny_rows_avx2, sobel_downsample_avx2, sobel_fixed_avx2, sobel_filter_format_avx2, sobel_temporal_sums_avx2, sobel_temporal_rows_avx2 },
+		{ sobel_filter_avx512, 16u, sobel_rows_avx512, sobel_rows_stream_avx512, sobel_row_avx512, sobel_canny_rows_avx512, sobel_downsample_avx512, sobel_fixed_avx512, sobel_filter_format_avx512, sobel_temporal_sums_avx512, sobel_temporal_rows_avx512 },
+		{ sobel_filter_avx512vl, 8u, sobel_rows_avx512vl, sobel_rows_stream_avx512vl, sobel_row_avx512vl, sobel_canny_rows_avx512vl, sobel_downsample_avx512vl, sobel_fixed_avx512vl, sobel_filter_format_avx2, sobel_temporal_sums_avx512vl, sobel_temporal_rows_avx512vl },
+	};
+	return kKernels[static_cast<uint32_t>(isa)];
+}
+
+void sobel_cpu_model(char model[49]) noexcept {
+	uint32_t regs[4];
+	memset(model, 0, 49u);
+
+	cpuid(0x80000000u, 0u, regs);
+	if (regs[0] < 0x80000004u) {
+		return;
+	}
+
+	for (uint32_t leaf = 0u; leaf < 3u; ++leaf) {
+		cpuid(0x80000002u + leaf, 0u, regs);
+		memcpy(&model[16u * leaf], regs, sizeof(regs));
+	}
+}
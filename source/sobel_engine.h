@@ -0,0 +1,1022 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "sobel_filter.h"
+
+// Separable derivative stencils. Each kernel is described by half of its
+// symmetric smoothing taps (smooth(0) is the center tap) and half of its
+// anti-symmetric derivative taps (derivative(0) is always zero).
+//
+//   gx = derivative(x) * smooth(y)
+//   gy = smooth(x) * derivative(y)
+//
+// The magnitude is normalized so that a unit step maps to at most 1.0, which for
+// the 3x3 Sobel kernel is the familiar 1 / sqrt(32).
+
+struct Sobel3Kernel {
+	static constexpr uint32_t kRadius = 1u;
+	static constexpr float smooth(uint32_t k) noexcept { return k == 0u ? 2.0f : 1.0f; }
+	static constexpr float derivative(uint32_t k) noexcept { return k == 0u ? 0.0f : 1.0f; }
+	static constexpr double norm_squared() noexcept { return 2.0 * (4.0 * 4.0) * (1.0 * 1.0); }
+};
+
+struct Scharr3Kernel {
+	static constexpr uint32_t kRadius = 1u;
+	static constexpr float smooth(uint32_t k) noexcept { return k == 0u ? 10.0f : 3.0f; }
+	static constexpr float derivative(uint32_t k) noexcept { return k == 0u ? 0.0f : 1.0f; }
+	static constexpr double norm_squared() noexcept { return 2.0 * (16.0 * 16.0) * (1.0 * 1.0); }
+};
+
+struct Sobel5Kernel {
+	static constexpr uint32_t kRadius = 2u;
+	static constexpr float smooth(uint32_t k) noexcept { return k == 0u ? 6.0f : (k == 1u ? 4.0f : 1.0f); }
+	static constexpr float derivative(uint32_t k) noexcept { return k == 0u ? 0.0f : (k == 1u ? 2.0f : 1.0f); }
+	static constexpr double norm_squared() noexcept { return 2.0 * (16.0 * 16.0) * (3.0 * 3.0); }
+};
+
+struct Sobel7Kernel {
+	static constexpr uint32_t kRadius = 3u;
+	static constexpr float smooth(uint32_t k) noexcept { return k == 0u ? 20.0f : (k == 1u ? 15.0f : (k == 2u ? 6.0f : 1.0f)); }
+	static constexpr float derivative(uint32_t k) noexcept { return k == 0u ? 0.0f : (k == 1u ? 5.0f : (k == 2u ? 4.0f : 1.0f)); }
+	static constexpr double norm_squared() noexcept { return 2.0 * (64.0 * 64.0) * (10.0 * 10.0); }
+};
+
+template <typename T>
+static inline const T* engine_offset_ptr(const T* ptr, uintptr_t byteOffset) noexcept {
+	const void* offsetPtr = &reinterpret_cast<const uint8_t*>(ptr)[byteOffset];
+	return static_cast<const T*>(offsetPtr);
+}
+
+template <typename T>
+static inline T* engine_offset_ptr(T* ptr, uintptr_t byteOffset) noexcept {
+	void* offsetPtr = &reinterpret_cast<uint8_t*>(ptr)[byteOffset];
+	return static_cast<T*>(offsetPtr);
+}
+
+// Multiply by a tap weight, folding the common 1 and 2 weights into cheaper operations
+template <typename V>
+static inline typename V::type engine_weight(typename V::type v, float weight) noexcept {
+	typedef typename V::value_type value_type;
+	return (weight == 1.0f) ? v : ((weight == 2.0f) ? V::add(v, v) : V::mul(v, V::set1(static_cast<value_type>(weight))));
+}
+
+#if defined(__GNUC__)
+#define ENGINE_FLATTEN __attribute__((flatten))
+#else
+#define ENGINE_FLATTEN
+#endif
+
+// Loads and stores the vector value type directly. Storage formats that need a
+// conversion (half floats, 16 bit integers) provide the same two functions.
+template <typename V>
+struct EngineNative {
+	typedef typename V::value_type storage_type;
+
+	static inline typename V::type load(const storage_type* ptr) noexcept { return V::load(ptr); }
+	static inline void store(storage_type* ptr, typename V::type v) noexcept { V::store(ptr, v); }
+};
+
+// Non-temporal stores past the cache for outputs that will not be read back soon,
+// the caller fences once the rows are written
+template <typename V>
+struct EngineStream {
+	typedef typename V::value_type storage_type;
+
+	static inline typename V::type load(const storage_type* ptr) noexcept { return V::load(ptr); }
+	static inline void store(storage_type* ptr, typename V::type v) noexcept { V::stream(ptr, v); }
+};
+
+// Partial block at the end of a row. stage() fills a whole block from the first
+// count elements of a row and replicates the last of them, store() writes the first
+// count lanes of a block. Tiers with masked loads and stores specialize it for their
+// native storage, everything else goes through a padded buffer.
+template <typename V, typename L>
+struct EngineTail {
+	typedef typename V::type type;
+	typedef typename L::storage_type storage_type;
+
+	static inline void stage(storage_type* block, const storage_type* row, uint32_t count) noexcept {
+		uint32_t i = 0u;
+		for (; i < count; ++i) {
+			block[i] = row[i];
+		}
+		for (; i < V::kWidth; ++i) {
+			block[i] = row[count - 1u];
+		}
+	}
+
+	static inline void store(storage_type* row, type v, uint32_t count) noexcept {
+		alignas(64) storage_type block[V::kWidth];
+		L::store(block, v);
+		for (uint32_t i = 0u; i < count; ++i) {
+			row[i] = block[i];
+		}
+	}
+};
+
+// A streamed row stores its partial block like a native one. Streaming only pays for
+// whole aligned blocks, the staging buffer is on the stack and is read straight back.
+template <typename V>
+struct EngineTail<V, EngineStream<V> > : EngineTail<V, EngineNative<V> > {
+};
+
+// Compile-time unrolled taps. The radius one specialization holds the center
+// tap and the first neighbors, every further radius adds one pair of taps.
+template <typename V, typename Kernel, typename L, uint32_t K = Kernel::kRadius>
+struct EngineTaps {
+	typedef typename V::type type;
+	typedef typename L::storage_type storage_type;
+
+	// Vertical pass producing the smoothed (vs) and differentiated (vd) column sums
+	static inline void vertical(const storage_type* const* rows, uint32_t x, type& vs, type& vd) noexcept {
+		EngineTaps<V, Kernel, L, K - 1u>::vertical(rows, x, vs, vd);
+
+		const type top = L::load(&rows[Kernel::kRadius - K][x]);
+		const type low = L::load(&rows[Kernel::kRadius + K][x]);
+
+		vs = V::add(vs, engine_weight<V>(V::add(top, low), Kernel::smooth(K)));
+		vd = V::add(vd, engine_weight<V>(V::sub(low, top), Kernel::derivative(K)));
+	}
+
+	// Horizontal pass over the register rotated column sums
+	static inline void horizontal(const type* vs, const type* vd, type& gx, type& gy) noexcept {
+		EngineTaps<V, Kernel, L, K - 1u>::horizontal(vs, vd, gx, gy);
+
+		const type ls = V::template shift_left<K>(vs[1], vs[2]);
+		const type rs = V::template shift_right<K>(vs[1], vs[0]);
+		const type ld = V::template shift_left<K>(vd[1], vd[2]);
+		const type rd = V::template shift_right<K>(vd[1], vd[0]);
+
+		gx = V::add(gx, engine_weight<V>(V::sub(ls, rs), Kernel::derivative(K)));
+		gy = V::add(gy, engine_weight<V>(V::add(ld, rd), Kernel::smooth(K)));
+	}
+};
+
+template <typename V, typename Kernel, typename L>
+struct EngineTaps<V, Kernel, L, 1u> {
+	typedef typename V::type type;
+	typedef typename L::storage_type storage_type;
+
+	static inline void vertical(const storage_type* const* rows, uint32_t x, type& vs, type& vd) noexcept {
+		const type top = L::load(&rows[Kernel::kRadius - 1u][x]);
+		const type mid = L::load(&rows[Kernel::kRadius][x]);
+		const type low = L::load(&rows[Kernel::kRadius + 1u][x]);
+
+		vs = V::add(engine_weight<V>(mid, Kernel::smooth(0u)), engine_weight<V>(V::add(top, low), Kernel::smooth(1u)));
+		vd = engine_weight<V>(V::sub(low, top), Kernel::derivative(1u));
+	}
+
+	static inline void horizontal(const type* vs, const type* vd, type& gx, type& gy) noexcept {
+		const type ls = V::template shift_left<1u>(vs[1], vs[2]);
+		const type rs = V::template shift_right<1u>(vs[1], vs[0]);
+		const type ld = V::template shift_left<1u>(vd[1], vd[2]);
+		const type rd = V::template shift_right<1u>(vd[1], vd[0]);
+
+		gx = engine_weight<V>(V::sub(ls, rs), Kernel::derivative(1u));
+		gy = V::add(engine_weight<V>(vd[1], Kernel::smooth(0u)), engine_weight<V>(V::add(ld, rd), Kernel::smooth(1u)));
+	}
+};
+
+// Writes the normalized gradient magnitude
+template <typename V, typename S = EngineNative<V> >
+struct MagnitudeOutput {
+	typedef typename V::type type;
+	typedef typename V::value_type value_type;
+	typedef typename S::storage_type storage_type;
+
+	storage_type* dst;
+	uint32_t bytesPerLineDst;
+	type scale;
+	storage_type* row;
+
+	MagnitudeOutput(storage_type* dst, uint32_t bytesPerLineDst, double scale) noexcept
+		: dst(dst), bytesPerLineDst(bytesPerLineDst), scale(V::set1(static_cast<value_type>(scale))), row(dst) {
+	}
+
+	inline void begin_row(uint32_t y) noexcept {
+		row = engine_offset_ptr(dst, y * static_cast<uintptr_t>(bytesPerLineDst));
+	}
+
+	inline type magnitude(type gx, type gy) const noexcept {
+		return V::mul(V::sqrt(V::fmadd(gx, gx, V::mul(gy, gy))), scale);
+	}
+
+	inline void store(uint32_t x, type gx, type gy) noexcept {
+		S::store(&row[x], magnitude(gx, gy));
+	}
+
+	inline void store_tail(uint32_t x, uint32_t count, type gx, type gy) noexcept {
+		EngineTail<V, S>::store(&row[x], magnitude(gx, gy), count);
+	}
+
+	inline void end_row() noexcept {
+	}
+};
+
+// Limit on the squared, unnormalized magnitude for a threshold on the normalized one.
+// Every magnitude exceeds a negative threshold, which squaring alone would lose.
+static inline double engine_mask_limit(float threshold, double normSquared) noexcept {
+	return threshold < 0.0f ? -1.0 : static_cast<double>(threshold) * threshold * normSquared;
+}
+
+// Writes a packed binary mask, one bit per pixel (least significant bit first),
+// set where the magnitude exceeds the threshold. The comparison happens on the
+// squared, unnormalized magnitude, so no square root is taken. The squares are
+// added without fusing, as in the scalar sobel_edge_mask, so that pixels right at
+// the threshold get the same bit on every tier.
+template <typename V>
+struct MaskOutput {
+	typedef typename V::type type;
+	typedef typename V::value_type value_type;
+
+	uint8_t* mask;
+	uint32_t bytesPerLineMask;
+	type limit;
+	uint8_t* row;
+	uint64_t bits;
+	uint32_t pending;
+
+	MaskOutput(uint8_t* mask, uint32_t bytesPerLineMask, double limit) noexcept
+		: mask(mask), bytesPerLineMask(bytesPerLineMask), limit(V::set1(static_cast<value_type>(limit))), row(mask), bits(0u), pending(0u) {
+	}
+
+	inline void begin_row(uint32_t y) noexcept {
+		row = &mask[y * static_cast<uintptr_t>(bytesPerLineMask)];
+		bits = 0u;
+		pending = 0u;
+	}
+
+	inline void append(uint64_t lanes, uint32_t count) noexcept {
+		bits |= lanes << pending;
+		pending += count;
+		if (pending == 64u) {
+			memcpy(row, &bits, sizeof(bits));
+			row += sizeof(bits);
+			bits = 0u;
+			pending = 0u;
+		}
+	}
+
+	inline void store(uint32_t, type gx, type gy) noexcept {
+		append(V::mask_greater(V::add(V::mul(gx, gx), V::mul(gy, gy)), limit), V::kWidth);
+	}
+
+	inline void store_tail(uint32_t, uint32_t count, type gx, type gy) noexcept {
+		const uint64_t lanes = V::mask_greater(V::add(V::mul(gx, gx), V::mul(gy, gy)), limit);
+		append(lanes & ((uint64_t(1u) << count) - 1u), count);
+	}
+
+	inline void end_row() noexcept {
+		memcpy(row, &bits, (pending + 7u) / 8u);
+	}
+};
+
+// Canny front end: the squared, unnormalized magnitude and both gradient components
+// of a row go to a ring of three rows each, picked by the row index modulo 3. Lanes
+// from the image width up to the end of a ring row are zeroed, so non-maximum
+// suppression sees empty neighbors outside the image.
+template <typename V>
+struct GradientOutput {
+	typedef typename V::type type;
+	typedef typename V::value_type value_type;
+
+	value_type* ring;  // 3 magnitude rows, 3 gx rows, then 3 gy rows
+	uint32_t stride;
+	uint32_t width;
+	value_type* magnitude;
+	value_type* gxRow;
+	value_type* gyRow;
+
+	GradientOutput(value_type* ring, uint32_t stride, uint32_t width) noexcept
+		: ring(ring), stride(stride), width(width), magnitude(ring), gxRow(ring), gyRow(ring) {
+	}
+
+	inline void begin_row(uint32_t y) noexcept {
+		const uintptr_t slot = y % 3u;
+		magnitude = &ring[slot * stride];
+		gxRow = &ring[(3u + slot) * stride];
+		gyRow = &ring[(6u + slot) * stride];
+	}
+
+	inline void store(uint32_t x, type gx, type gy) noexcept {
+		V::store(&magnitude[x], V::fmadd(gx, gx, V::mul(gy, gy)));
+		V::store(&gxRow[x], gx);
+		V::store(&gyRow[x], gy);
+	}
+
+	inline void store_tail(uint32_t x, uint32_t, type gx, type gy) noexcept {
+		store(x, gx, gy);
+	}
+
+	inline void end_row() noexcept {
+		for (uint32_t x = width; x < stride; ++x) {
+			magnitude[x] = 0;
+		}
+	}
+};
+
+// Accumulates the focus score, maximum and histogram of the normalized magnitude
+// while optionally writing it. Four interleaved histograms keep consecutive lanes
+// from serializing on the same counter. Bins are clamped to the histogram on both
+// ends, a histogramMax that is not positive sends every magnitude to the last bin.
+template <typename V>
+struct StatsOutput {
+	typedef typename V::type type;
+	typedef typename V::value_type value_type;
+
+	static constexpr uint32_t kBins = 256u;
+	static constexpr uint32_t kSplit = 4u;
+
+	value_type* dst;
+	uint32_t bytesPerLineDst;
+	type scale;
+	type binScale;
+	type binBase;
+	type lastBin;
+	value_type* row;
+
+	double focusScale;
+	type sum;
+	type maximum;
+	double focus;
+	uint64_t histogram[kSplit][kBins];
+
+	StatsOutput(value_type* dst, uint32_t bytesPerLineDst, double scale, float histogramMax) noexcept
+		: dst(dst), bytesPerLineDst(bytesPerLineDst), scale(V::set1(static_cast<value_type>(scale))),
+		binScale(V::set1(static_cast<value_type>(histogramMax > 0.0f ? kBins / histogramMax : 0.0f))),
+		binBase(V::set1(static_cast<value_type>(histogramMax > 0.0f ? 0u : kBins - 1u))), lastBin(V::set1(static_cast<value_type>(kBins - 1u))),
+		row(nullptr), focusScale(scale * scale), sum(V::set1(0)), maximum(V::set1(0)), focus(0.0) {
+		memset(histogram, 0, sizeof(histogram));
+	}
+
+	inline void begin_row(uint32_t y) noexcept {
+		if (dst != nullptr) {
+			row = engine_offset_ptr(dst, y * static_cast<uintptr_t>(bytesPerLineDst));
+		}
+	}
+
+	inline void count(type magnitude, uint32_t lanes) noexcept {
+		alignas(64) int32_t bins[V::kWidth];
+		// min and max return their second operand for NaN, which lands it in the last bin
+		V::store_int(bins, V::max(V::min(V::fmadd(magnitude, binScale, binBase), lastBin), V::set1(0)));
+		uint32_t i = 0u;
+		for (; i + kSplit <= lanes; i += kSplit) {
+			++histogram[0u][bins[i]];
+			++histogram[1u][bins[i + 1u]];
+			++histogram[2u][bins[i + 2u]];
+			++histogram[3u][bins[i + 3u]];
+		}
+		for (; i < lanes; ++i) {
+			++histogram[0u][bins[i]];
+		}
+	}
+
+	inline void store(uint32_t x, type gx, type gy) noexcept {
+		const type squared = V::fmadd(gx, gx, V::mul(gy, gy));
+		const type magnitude = V::mul(V::sqrt(squared), scale);
+
+		sum = V::add(sum, squared);
+		maximum = V::max(maximum, magnitude);
+		count(magnitude, V::kWidth);
+
+		if (row != nullptr) {
+			V::store(&row[x], magnitude);
+		}
+	}
+
+	inline void store_tail(uint32_t x, uint32_t lanes, type gx, type gy) noexcept {
+		alignas(64) value_type squared[V::kWidth];
+		alignas(64) value_type magnitude[V::kWidth];
+		V::store(squared, V::fmadd(gx, gx, V::mul(gy, gy)));
+		V::store(magnitude, V::mul(V::sqrt(V::load(squared)), scale));
+
+		value_type peak = 0;
+		for (uint32_t i = 0u; i < lanes; ++i) {
+			focus += squared[i] * focusScale;
+			peak = magnitude[i] > peak ? magnitude[i] : peak;
+		}
+		maximum = V::max(maximum, V::set1(peak));
+		count(V::load(magnitude), lanes);
+
+		if (row != nullptr) {
+			for (uint32_t i = 0u; i < lanes; ++i) {
+				row[x + i] = magnitude[i];
+			}
+		}
+	}
+
+	inline void end_row() noexcept {
+		focus += V::reduce_add(sum) * focusScale;
+		sum = V::set1(0);
+	}
+
+	// Adds the accumulated statistics to the totals in stats
+	inline void finish(SobelStats& stats) const noexcept {
+		stats.focus += focus;
+		const float peak = static_cast<float>(V::reduce_max(maximum));
+		stats.maximum = peak > stats.maximum ? peak : stats.maximum;
+		for (uint32_t b = 0u; b < kBins; ++b) {
+			for (uint32_t i = 0u; i < kSplit; ++i) {
+				stats.histogram[b] += histogram[i][b];
+			}
+		}
+	}
+};
+
+// Runs the stencil over one output row y given the kTaps source rows centered on
+// it, already clamped to the image. Full blocks are loaded straight from the source
+// rows, a partial block at the end of the row is staged through a small padded
+// buffer so that the same register rotation covers every width, including widths
+// below the SIMD width.
+template <typename V, typename Kernel, typename L, typename Output>
+static inline void engine_row(const typename L::storage_type* const* rows, uint32_t width, uint32_t y, Output& output) noexcept {
+	typedef typename V::type type;
+	typedef typename L::storage_type storage_type;
+	typedef EngineTaps<V, Kernel, L> Taps;
+
+	static constexpr uint32_t kTaps = 2u * Kernel::kRadius + 1u;
+	static constexpr uint32_t kWidth = V::kWidth;
+
+	static_assert(Kernel::kRadius < kWidth, "stencil radius must be below the SIMD width");
+
+	const uint32_t blocks = width / kWidth;
+	const uint32_t remainder = width - blocks * kWidth;
+	const uint32_t full = blocks * kWidth;
+
+	output.begin_row(y);
+
+	// Rotating window of column sums: previous, current and next block
+	type vs[3];
+	type vd[3];
+	type gx;
+	type gy;
+
+	uint32_t x = 0u;
+
+	if (blocks != 0u) {
+		Taps::vertical(rows, 0u, vs[1], vd[1]);
+		vs[0] = V::first(vs[1]);
+		vd[0] = V::first(vd[1]);
+
+		for (; x + kWidth < full; x += kWidth) {
+			Taps::vertical(rows, x + kWidth, vs[2], vd[2]);
+			Taps::horizontal(vs, vd, gx, gy);
+			output.store(x, gx, gy);
+
+			vs[0] = vs[1];
+			vd[0] = vd[1];
+			vs[1] = vs[2];
+			vd[1] = vd[2];
+		}
+	}
+
+	if (remainder != 0u) {
+		alignas(64) storage_type tail[kTaps][kWidth];
+		const storage_type* tailRows[kTaps];
+
+		for (uint32_t k = 0u; k < kTaps; ++k) {
+			EngineTail<V, L>::stage(tail[k], &rows[k][full], remainder);
+			tailRows[k] = tail[k];
+		}
+
+		if (blocks != 0u) {
+			Taps::vertical(tailRows, 0u, vs[2], vd[2]);
+			Taps::horizontal(vs, vd, gx, gy);
+			output.store(x, gx, gy);
+
+			vs[0] = vs[1];
+			vd[0] = vd[1];
+			vs[1] = vs[2];
+			vd[1] = vd[2];
+			x += kWidth;
+		} else {
+			Taps::vertical(tailRows, 0u, vs[1], vd[1]);
+			vs[0] = V::first(vs[1]);
+			vd[0] = V::first(vd[1]);
+		}
+
+		vs[2] = V::last(vs[1]);
+		vd[2] = V::last(vd[1]);
+		Taps::horizontal(vs, vd, gx, gy);
+		output.store_tail(x, remainder, gx, gy);
+	} else if (blocks != 0u) {
+		vs[2] = V::last(vs[1]);
+		vd[2] = V::last(vd[1]);
+		Taps::horizontal(vs, vd, gx, gy);
+		output.store(x, gx, gy);
+	}
+
+	output.end_row();
+}
+
+// Runs the stencil over the output rows [firstRow, lastRow) of an image with
+// replicated borders
+template <typename V, typename Kernel, typename L, typename Output>
+static inline void engine_rows(const typename L::storage_type* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, Output& output) noexcept {
+	static constexpr uint32_t kTaps = 2u * Kernel::kRadius + 1u;
+
+#ifdef _DEBUG
+	assert(firstRow <= lastRow && lastRow <= height);
+#endif
+
+	const typename L::storage_type* rows[kTaps];
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		for (uint32_t k = 0u; k < kTaps; ++k) {
+			int64_t ry = static_cast<int64_t>(y) + static_cast<int64_t>(k) - static_cast<int64_t>(Kernel::kRadius);
+			ry = ry < 0 ? 0 : (ry >= static_cast<int64_t>(height) ? static_cast<int64_t>(height) - 1 : ry);
+			rows[k] = engine_offset_ptr(src, static_cast<uintptr_t>(ry) * bytesPerLineSrc);
+		}
+
+		engine_row<V, Kernel, L>(rows, width, y, output);
+	}
+}
+
+// Source and destination rows are aligned to one SIMD block of their storage type
+template <typename V, typename Kernel, typename L = EngineNative<V>, typename S = EngineNative<V> >
+static inline void engine_filter(const typename L::storage_type* src, typename S::storage_type* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+#ifdef _DEBUG
+	static constexpr uintptr_t kMaskAlignSrc = V::kWidth * sizeof(typename L::storage_type) - 1u;
+	static constexpr uintptr_t kMaskAlignDst = V::kWidth * sizeof(typename S::storage_type) - 1u;
+	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlignSrc) == 0u);
+	assert((reinterpret_cast<uintptr_t>(dst) & kMaskAlignDst) == 0u);
+	assert((bytesPerLineSrc & kMaskAlignSrc) == 0u);
+	assert((bytesPerLineDst & kMaskAlignDst) == 0u);
+#endif
+	MagnitudeOutput<V, S> output(dst, bytesPerLineDst, 1.0 / std::sqrt(Kernel::norm_squared()));
+	engine_rows<V, Kernel, L>(src, width, height, bytesPerLineSrc, 0u, height, output);
+}
+
+// Whole image magnitude for a shape fixed at compile time with dense rows. Block
+// counts, the tail and every row offset fold to constants once engine_rows is
+// flattened into the instantiation.
+template <typename V, typename Kernel, uint32_t kImageWidth, uint32_t kImageHeight>
+ENGINE_FLATTEN static void engine_fixed(const typename V::value_type* src, typename V::value_type* dst) noexcept {
+	static constexpr uint32_t kBytesPerLine = kImageWidth * sizeof(typename V::value_type);
+	static_assert(kImageWidth % V::kWidth == 0u, "fixed shapes are whole SIMD blocks wide");
+
+	MagnitudeOutput<V> output(dst, kBytesPerLine, 1.0 / std::sqrt(Kernel::norm_squared()));
+	engine_rows<V, Kernel, EngineNative<V> >(src, kImageWidth, kImageHeight, kBytesPerLine, 0u, kImageHeight, output);
+}
+
+template <typename V, typename Kernel>
+static inline void engine_stats(const typename V::value_type* src, typename V::value_type* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept {
+#ifdef _DEBUG
+	static constexpr uintptr_t kMaskAlign = V::kWidth * sizeof(typename V::value_type) - 1u;
+	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
+	assert((reinterpret_cast<uintptr_t>(dst) & kMaskAlign) == 0u);
+	assert((bytesPerLineSrc & kMaskAlign) == 0u);
+	assert((bytesPerLineDst & kMaskAlign) == 0u);
+#endif
+	StatsOutput<V> output(dst, bytesPerLineDst, 1.0 / std::sqrt(Kernel::norm_squared()), histogramMax);
+	engine_rows<V, Kernel, EngineNative<V> >(src, width, height, bytesPerLineSrc, 0u, height, output);
+
+	memset(stats, 0, sizeof(*stats));
+	output.finish(*stats);
+}
+
+template <typename V, typename Kernel>
+static inline void engine_mask(const typename V::value_type* src, uint8_t* mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept {
+#ifdef _DEBUG
+	static constexpr uintptr_t kMaskAlign = V::kWidth * sizeof(typename V::value_type) - 1u;
+	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
+	assert((bytesPerLineSrc & kMaskAlign) == 0u);
+	assert(bytesPerLineMask * 8ull >= width);
+#endif
+	MaskOutput<V> output(mask, bytesPerLineMask, engine_mask_limit(threshold, Kernel::norm_squared()));
+	engine_rows<V, Kernel, EngineNative<V> >(src, width, height, bytesPerLineSrc, 0u, height, output);
+}
+
+// Magnitude rows [firstRow, lastRow) of the full image, for banded drivers
+template <typename V, typename Kernel, typename S = EngineNative<V> >
+static inline void engine_band(const typename V::value_type* src, typename V::value_type* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+#ifdef _DEBUG
+	static constexpr uintptr_t kMaskAlign = V::kWidth * sizeof(typename V::value_type) - 1u;
+	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
+	assert((reinterpret_cast<uintptr_t>(dst) & kMaskAlign) == 0u);
+	assert((bytesPerLineSrc & kMaskAlign) == 0u);
+	assert((bytesPerLineDst & kMaskAlign) == 0u);
+	assert(firstRow <= lastRow && lastRow <= height);
+#endif
+	MagnitudeOutput<V, S> output(dst, bytesPerLineDst, 1.0 / std::sqrt(Kernel::norm_squared()));
+	engine_rows<V, Kernel, EngineNative<V> >(src, width, height, bytesPerLineSrc, firstRow, lastRow, output);
+}
+
+// Magnitude of a single row from its clamped source rows, for row streamed drivers
+template <typename V, typename Kernel>
+static inline void engine_stream_row(const typename V::value_type* const* rows, typename V::value_type* out, uint32_t width) noexcept {
+	MagnitudeOutput<V> output(out, 0u, 1.0 / std::sqrt(Kernel::norm_squared()));
+	engine_row<V, Kernel, EngineNative<V> >(rows, width, 0u, output);
+}
+
+// Values per row of the Canny ring: the width rounded up to 16 lanes plus one block
+// of zeros that the last block of a row reads as its right neighbor
+static inline uint32_t engine_canny_stride(uint32_t width) noexcept {
+	return ((width + 15u) & ~15u) + 16u;
+}
+
+// Ring rows engine_canny needs in its scratch: 9 for GradientOutput and one zero row
+static constexpr uint32_t kEngineCannyRows = 10u;
+
+// Non-maximum suppression of the middle of three magnitude rows. The gradient
+// direction is quantized to horizontal, vertical and the two diagonals with
+// tan(22.5) and tan(67.5), and a pixel survives when it is greater than its
+// neighbor on one side and at least its neighbor on the other side, which keeps
+// one pixel of a plateau. Surviving pixels above low and above high are set in
+// the candidate and strong bit rows, least significant bit first.
+template <typename V>
+static inline void engine_canny_nms(const typename V::value_type* const* magnitude, const typename V::value_type* gxRow, const typename V::value_type* gyRow, uint32_t width, typename V::type low, typename V::type high, uint64_t* strong, uint64_t* candidates) noexcept {
+	typedef typename V::type type;
+	typedef typename V::value_type value_type;
+	static constexpr uint32_t kWidth = V::kWidth;
+	static constexpr uint32_t kLanes = (1u << kWidth) - 1u;
+
+	static_assert(kWidth < 32u && 64u % kWidth == 0u, "lane masks are packed into 64 bit words");
+
+	const type zero = V::set1(0);
+	const type tan22 = V::set1(static_cast<value_type>(0.41421356237309503));
+	const type tan67 = V::set1(static_cast<value_type>(2.4142135623730949));
+
+	// Previous, current and next block of the rows above, at and below y
+	type window[3][3];
+	for (uint32_t r = 0u; r < 3u; ++r) {
+		window[r][0] = zero;
+		window[r][1] = V::load(magnitude[r]);
+	}
+
+	uint64_t strongBits = 0u;
+	uint64_t candidateBits = 0u;
+	uint32_t pending = 0u;
+
+	for (uint32_t x = 0u; x < width; x += kWidth) {
+		for (uint32_t r = 0u; r < 3u; ++r) {
+			window[r][2] = V::load(&magnitude[r][x + kWidth]);
+		}
+
+		const type center = window[1][1];
+		const uint32_t aboveLow = V::mask_greater(center, low);
+
+		// Most of an image is flat, skip the direction tests for blocks with nothing above low
+		uint32_t maxima = 0u;
+		if (aboveLow != 0u) {
+			const type gx = V::load(&gxRow[x]);
+			const type gy = V::load(&gyRow[x]);
+			const type ax = V::max(gx, V::sub(zero, gx));
+			const type ay = V::max(gy, V::sub(zero, gy));
+
+			const uint32_t vertical = V::mask_greater(ay, V::mul(ax, tan67));
+			const uint32_t horizontal = ~V::mask_greater(ay, V::mul(ax, tan22)) & kLanes;
+			const uint32_t diagonal = ~(vertical | horizontal) & kLanes;
+			const uint32_t rising = V::mask_greater(V::mul(gx, gy), zero);
+
+			const type left = V::template shift_right<1u>(center, window[1][0]);
+			const type right = V::template shift_left<1u>(center, window[1][2]);
+			const type upLeft = V::template shift_right<1u>(window[0][1], window[0][0]);
+			const type upRight = V::template shift_left<1u>(window[0][1], window[0][2]);
+			const type downLeft = V::template shift_right<1u>(window[2][1], window[2][0]);
+			const type downRight = V::template shift_left<1u>(window[2][1], window[2][2]);
+
+			maxima =
+				(horizontal & V::mask_greater(center, left) & ~V::mask_greater(right, center)) |
+				(vertical & V::mask_greater(center, window[0][1]) & ~V::mask_greater(window[2][1], center)) |
+				(diagonal & rising & V::mask_greater(center, upLeft) & ~V::mask_greater(downRight, center)) |
+				(diagonal & ~rising & V::mask_greater(center, upRight) & ~V::mask_greater(downLeft, center));
+		}
+
+		strongBits |= static_cast<uint64_t>(maxima & V::mask_greater(center, high)) << pending;
+		candidateBits |= static_cast<uint64_t>(maxima & aboveLow) << pending;
+		pending += kWidth;
+		if (pending == 64u) {
+			*strong++ = strongBits;
+			*candidates++ = candidateBits;
+			strongBits = 0u;
+			candidateBits = 0u;
+			pending = 0u;
+		}
+
+		for (uint32_t r = 0u; r < 3u; ++r) {
+			window[r][0] = window[r][1];
+			window[r][1] = window[r][2];
+		}
+	}
+
+	if (pending != 0u) {
+		*strong = strongBits;
+		*candidates = candidateBits;
+	}
+}
+
+// Canny gradient and non-maximum suppression for rows [firstRow, lastRow) in one
+// sweep: gradient rows are computed one row ahead into a ring in scratch and
+// suppressed as soon as the row below is there. scratch holds kEngineCannyRows rows
+// of engine_canny_stride(width) values and is aligned to 64 bytes. Bit rows are
+// wordsPerLine 64 bit words apart. Thresholds are on the normalized magnitude.
+template <typename V, typename Kernel>
+static inline void engine_canny(const typename V::value_type* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, typename V::value_type* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept {
+	typedef typename V::value_type value_type;
+#ifdef _DEBUG
+	static constexpr uintptr_t kMaskAlign = V::kWidth * sizeof(value_type) - 1u;
+	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
+	assert((reinterpret_cast<uintptr_t>(scratch) & kMaskAlign) == 0u);
+	assert((bytesPerLineSrc & kMaskAlign) == 0u);
+	assert(firstRow <= lastRow && lastRow <= height);
+	assert(wordsPerLine * 64ull >= width);
+#endif
+	const uint32_t stride = engine_canny_stride(width);
+	const value_type* zeroRow = &scratch[9u * static_cast<uintptr_t>(stride)];
+	memset(&scratch[9u * static_cast<uintptr_t>(stride)], 0, stride * sizeof(value_type));
+
+	const typename V::type lowLimit = V::set1(static_cast<value_type>(static_cast<double>(low) * low * Kernel::norm_squared()));
+	const typename V::type highLimit = V::set1(static_cast<value_type>(static_cast<double>(high) * high * Kernel::norm_squared()));
+
+	GradientOutput<V> output(scratch, stride, width);
+	uint32_t next = firstRow != 0u ? firstRow - 1u : 0u;
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		const uint32_t below = y + 1u < height ? y + 1u : y;
+		if (next <= below) {
+			engine_rows<V, Kernel, EngineNative<V> >(src, width, height, bytesPerLineSrc, next, below + 1u, output);
+			next = below + 1u;
+		}
+
+		const value_type* magnitude[3] = {
+			y != 0u ? &scratch[((y - 1u) % 3u) * static_cast<uintptr_t>(stride)] : zeroRow,
+			&scratch[(y % 3u) * static_cast<uintptr_t>(stride)],
+			y + 1u < height ? &scratch[((y + 1u) % 3u) * static_cast<uintptr_t>(stride)] : zeroRow
+		};
+		const uintptr_t slot = y % 3u;
+		engine_canny_nms<V>(magnitude, &scratch[(3u + slot) * stride], &scratch[(6u + slot) * stride], width, lowLimit, highLimit, &strong[y * static_cast<uintptr_t>(wordsPerLine)], &candidates[y * static_cast<uintptr_t>(wordsPerLine)]);
+	}
+}
+
+// Spatio-temporal 3x3x3 Sobel. The 3x3x3 kernels factor into a vertical pass per
+// frame, the smoothed vs = top + 2 mid + low and the differentiated vd = low - top,
+// and a temporal and horizontal pass over the sums of the previous (p), current (c)
+// and next (n) frame:
+//
+//   gx = dx(vs_p + 2 vs_c + vs_n)
+//   gy = sx(vd_p + 2 vd_c + vd_n)
+//   gt = sx(vs_n - vs_p)
+//
+// with dx the horizontal [-1 0 1] and sx the horizontal [1 2 1]. A frame's sums serve
+// three successive outputs, so a frame ring computes them once per frame and keeps
+// them in planes of engine_temporal_stride(width) values per row. The lanes of the last
+// block past the width hold the replicated last column.
+static inline uint32_t engine_temporal_stride(uint32_t width) noexcept {
+	return (width + 15u) & ~15u;
+}
+
+// Rows of engine_temporal_stride(width) values engine_temporal needs in its scratch
+static constexpr uint32_t kEngineTemporalRows = 3u;
+
+template <typename V>
+static inline void engine_temporal_vertical(const typename V::value_type* const* rows, uint32_t x, typename V::type& vs, typename V::type& vd) noexcept {
+	const typename V::type top = V::load(&rows[0][x]);
+	const typename V::type mid = V::load(&rows[1][x]);
+	const typename V::type low = V::load(&rows[2][x]);
+	vs = V::add(V::add(mid, mid), V::add(top, low));
+	vd = V::sub(low, top);
+}
+
+// Clamped rows around y, with the partial block at the end of the row staged into
+// tail so that whole blocks can be loaded from tailRows at offset 0
+template <typename V>
+static inline void engine_temporal_rows(const typename V::value_type* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t y, const typename V::value_type** rows, typename V::value_type (*tail)[V::kWidth], const typename V::value_type** tailRows) noexcept {
+	const uint32_t full = width - width % V::kWidth;
+	for (uint32_t k = 0u; k < 3u; ++k) {
+		const uint32_t ry = (y + k == 0u) ? 0u : (y + k - 1u >= height ? height - 1u : y + k - 1u);
+		rows[k] = engine_offset_ptr(src, static_cast<uintptr_t>(ry) * bytesPerLineSrc);
+		if (full != width) {
+			EngineTail<V, EngineNative<V> >::stage(tail[k], &rows[k][full], width - full);
+		}
+		tailRows[k] = tail[k];
+	}
+}
+
+// Vertical sums of rows [firstRow, lastRow) of one frame into the smooth and derivative planes
+template <typename V>
+static inline void engine_temporal_sums(const typename V::value_type* src, typename V::value_type* smooth, typename V::value_type* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept {
+	typedef typename V::type type;
+	typedef typename V::value_type value_type;
+	static constexpr uint32_t kWidth = V::kWidth;
+#ifdef _DEBUG
+	static constexpr uintptr_t kMaskAlign = kWidth * sizeof(value_type) - 1u;
+	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
+	assert((reinterpret_cast<uintptr_t>(smooth) & kMaskAlign) == 0u);
+	assert((reinterpret_cast<uintptr_t>(derivative) & kMaskAlign) == 0u);
+	assert((bytesPerLineSrc & kMaskAlign) == 0u);
+	assert(bytesPerLineSums >= engine_temporal_stride(width) * sizeof(value_type));
+	assert(firstRow <= lastRow && lastRow <= height);
+#endif
+	const uint32_t full = width - width % kWidth;
+
+	const value_type* rows[3];
+	alignas(64) value_type tail[3][kWidth] = {};
+	const value_type* tailRows[3];
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		engine_temporal_rows<V>(src, width, height, bytesPerLineSrc, y, rows, tail, tailRows);
+		value_type* vsRow = engine_offset_ptr(smooth, static_cast<uintptr_t>(y) * bytesPerLineSums);
+		value_type* vdRow = engine_offset_ptr(derivative, static_cast<uintptr_t>(y) * bytesPerLineSums);
+
+		type vs;
+		type vd;
+		uint32_t x = 0u;
+		for (; x < full; x += kWidth) {
+			engine_temporal_vertical<V>(rows, x, vs, vd);
+			V::store(&vsRow[x], vs);
+			V::store(&vdRow[x], vd);
+		}
+
+		// The lanes of the last block past the width repeat the last column
+		if (x != width) {
+			engine_temporal_vertical<V>(tailRows, 0u, vs, vd);
+			V::store(&vsRow[x], vs);
+			V::store(&vdRow[x], vd);
+		}
+	}
+}
+
+// Spatio-temporal gradients of rows [firstRow, lastRow) of the current frame from the
+// previous, current and next frame. The sums of frame t are read from the smooth[t]
+// and derivative[t] planes when smooth[t] is set, otherwise they are computed from
+// frames[t], and those of the next frame are also stored to the store planes when
+// store[0] is set. A frame ring thus reduces each new frame once, in the same sweep
+// that combines it with the cached sums of the two frames before it. outputs holds
+// gx, gy, gt and the magnitude, any of them nullptr. The components are scaled so
+// that a unit step along their axis gives 1, the magnitude is their root sum of
+// squares divided by sqrt(3). scratch holds kEngineTemporalRows rows of
+// engine_temporal_stride(width) values and is aligned to 64 bytes.
+template <typename V>
+static inline void engine_temporal(const typename V::value_type* const* frames, const typename V::value_type* const* smooth, const typename V::value_type* const* derivative, typename V::value_type* const* store, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, typename V::value_type* const* outputs, uint32_t bytesPerLineDst, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, typename V::value_type* scratch) noexcept {
+	typedef typename V::type type;
+	typedef typename V::value_type value_type;
+	typedef EngineTail<V, EngineNative<V> > Tail;
+	static constexpr uint32_t kWidth = V::kWidth;
+#ifdef _DEBUG
+	static constexpr uintptr_t kMaskAlign = kWidth * sizeof(value_type) - 1u;
+	assert((reinterpret_cast<uintptr_t>(scratch) & kMaskAlign) == 0u);
+	assert((bytesPerLineSrc & kMaskAlign) == 0u);
+	assert((bytesPerLineSums & kMaskAlign) == 0u);
+	assert((bytesPerLineDst & kMaskAlign) == 0u);
+	assert(store[0] == nullptr || smooth[2] == nullptr);
+	assert(firstRow <= lastRow && lastRow <= height);
+#endif
+	const uint32_t full = width - width % kWidth;
+	const uint32_t padded = (width + kWidth - 1u) & ~(kWidth - 1u);
+	const uint32_t stride = engine_temporal_stride(width);
+
+	value_type* sRow = scratch;
+	value_type* dRow = &scratch[stride];
+	value_type* tRow = &scratch[2u * static_cast<uintptr_t>(stride)];
+
+	const type two = V::set1(static_cast<value_type>(2));
+	const type componentScale = V::set1(static_cast<value_type>(1.0 / 16.0));
+	const type magnitudeScale = V::set1(static_cast<value_type>(1.0 / std::sqrt(3.0)));
+
+	// Cached frames only fill the first two rows, the last block of a frame read
+	// directly comes from its staged tail
+	const value_type* rows[3][3] = {};
+	alignas(64) value_type tail[3][3][kWidth] = {};
+	const value_type* tailRows[3][3] = {};
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		// Temporal pass into the scratch rows
+		for (uint32_t t = 0u; t < 3u; ++t) {
+			if (smooth[t] != nullptr) {
+				rows[t][0] = engine_offset_ptr(smooth[t], static_cast<uintptr_t>(y) * bytesPerLineSums);
+				rows[t][1] = engine_offset_ptr(derivative[t], static_cast<uintptr_t>(y) * bytesPerLineSums);
+			} else {
+				engine_temporal_rows<V>(frames[t], width, height, bytesPerLineSrc, y, rows[t], tail[t], tailRows[t]);
+			}
+		}
+		value_type* vsStore = store[0] != nullptr ? engine_offset_ptr(store[0], static_cast<uintptr_t>(y) * bytesPerLineSums) : nullptr;
+		value_type* vdStore = store[0] != nullptr ? engine_offset_ptr(store[1], static_cast<uintptr_t>(y) * bytesPerLineSums) : nullptr;
+
+		type vs[3];
+		type vd[3];
+		for (uint32_t x = 0u; x < padded; x += kWidth) {
+			for (uint32_t t = 0u; t < 3u; ++t) {
+				if (smooth[t] != nullptr) {
+					vs[t] = V::load(&rows[t][0][x]);
+					vd[t] = V::load(&rows[t][1][x]);
+				} else if (x < full) {
+					engine_temporal_vertical<V>(rows[t], x, vs[t], vd[t]);
+				} else {
+					engine_temporal_vertical<V>(tailRows[t], 0u, vs[t], vd[t]);
+				}
+			}
+			if (vsStore != nullptr) {
+				V::store(&vsStore[x], vs[2]);
+				V::store(&vdStore[x], vd[2]);
+			}
+			V::store(&sRow[x], V::add(V::fmadd(vs[1], two, vs[0]), vs[2]));
+			V::store(&dRow[x], V::add(V::fmadd(vd[1], two, vd[0]), vd[2]));
+			V::store(&tRow[x], V::sub(vs[2], vs[0]));
+		}
+
+		// Horizontal pass over a window of the previous, current and next block
+		value_type* out[4];
+		for (uint32_t i = 0u; i < 4u; ++i) {
+			out[i] = outputs[i] != nullptr ? engine_offset_ptr(outputs[i], static_cast<uintptr_t>(y) * bytesPerLineDst) : nullptr;
+		}
+
+		type s[3] = { V::set1(0), V::load(sRow), V::set1(0) };
+		type d[3] = { V::set1(0), V::load(dRow), V::set1(0) };
+		type g[3] = { V::set1(0), V::load(tRow), V::set1(0) };
+		s[0] = V::first(s[1]);
+		d[0] = V::first(d[1]);
+		g[0] = V::first(g[1]);
+
+		for (uint32_t x = 0u; x < padded; x += kWidth) {
+			if (x + kWidth < padded) {
+				s[2] = V::load(&sRow[x + kWidth]);
+				d[2] = V::load(&dRow[x + kWidth]);
+				g[2] = V::load(&tRow[x + kWidth]);
+			} else {
+				s[2] = V::last(s[1]);
+				d[2] = V::last(d[1]);
+				g[2] = V::last(g[1]);
+			}
+
+			type gradient[4];
+			gradient[0] = V::mul(V::sub(V::template shift_left<1u>(s[1], s[2]), V::template shift_right<1u>(s[1], s[0])), componentScale);
+			gradient[1] = V::mul(V::fmadd(d[1], two, V::add(V::template shift_left<1u>(d[1], d[2]), V::template shift_right<1u>(d[1], d[0]))), componentScale);
+			gradient[2] = V::mul(V::fmadd(g[1], two, V::add(V::template shift_left<1u>(g[1], g[2]), V::template shift_right<1u>(g[1], g[0]))), componentScale);
+			gradient[3] = V::mul(V::sqrt(V::fmadd(gradient[0], gradient[0], V::fmadd(gradient[1], gradient[1], V::mul(gradient[2], gradient[2])))), magnitudeScale);
+
+			for (uint32_t i = 0u; i < 4u; ++i) {
+				if (out[i] == nullptr) {
+					continue;
+				}
+				if (x < full) {
+					V::store(&out[i][x], gradient[i]);
+				} else {
+					Tail::store(&out[i][x], gradient[i], width - full);
+				}
+			}
+
+			s[0] = s[1];
+			d[0] = d[1];
+			g[0] = g[1];
+			s[1] = s[2];
+			d[1] = d[2];
+			g[1] = g[2];
+		}
+	}
+}
+
+// 2x2 box average into rows [firstRow, lastRow) of the half resolution image. An odd last
+// column or row is averaged with itself. V::pairwise_add(a, b) returns the sums of adjacent
+// lane pairs of a followed by those of b.
+template <typename V>
+static inline void engine_downsample(const typename V::value_type* src, typename V::value_type* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	typedef typename V::type type;
+	typedef typename V::value_type value_type;
+	static constexpr uint32_t kWidth = V::kWidth;
+#ifdef _DEBUG
+	static constexpr uintptr_t kMaskAlign = kWidth * sizeof(value_type) - 1u;
+	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
+	assert((reinterpret_cast<uintptr_t>(dst) & kMaskAlign) == 0u);
+	assert((bytesPerLineSrc & kMaskAlign) == 0u);
+	assert((bytesPerLineDst & kMaskAlign) == 0u);
+	assert(firstRow <= lastRow && lastRow <= (height + 1u) / 2u);
+#endif
+	const uint32_t outWidth = (width + 1u) / 2u;
+	const uint32_t vectorEnd = (width / (2u * kWidth)) * kWidth;
+	const type quarter = V::set1(static_cast<value_type>(0.25));
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		const value_type* a = engine_offset_ptr(src, static_cast<uintptr_t>(2u * y) * bytesPerLineSrc);
+		const value_type* b = engine_offset_ptr(src, static_cast<uintptr_t>(2u * y + 1u < height ? 2u * y + 1u : height - 1u) * bytesPerLineSrc);
+		value_type* out = engine_offset_ptr(dst, static_cast<uintptr_t>(y) * bytesPerLineDst);
+
+		uint32_t x = 0u;
+		for (; x < vectorEnd; x += kWidth) {
+			const type lo = V::add(V::load(a + 2u * x), V::load(b + 2u * x));
+			const type hi = V::add(V::load(a + 2u * x + kWidth), V::load(b + 2u * x + kWidth));
+			V::store(out + x, V::mul(V::pairwise_add(lo, hi), quarter));
+		}
+
+		for (; x < outWidth; ++x) {
+			const uint32_t x0 = 2u * x;
+			const uint32_t x1 = x0 + 1u < width ? x0 + 1u : width - 1u;
+			out[x] = static_cast<value_type>(0.25) * ((a[x0] + a[x1]) + (b[x0] + b[x1]));
+		}
+	}
+}
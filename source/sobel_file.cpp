@@ -0,0 +1,354 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "sobel_file.h"
+#include "sobel_internal.h"
+#include "sobel_workers.h"
+
+static constexpr uint32_t kDefaultBandRows = 256u;
+static constexpr uint32_t kTaskRows = 16u;  // Rows per worker task within a band
+
+struct FileLayout {
+	SobelFileFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytesPerSample;
+	uint32_t maxValue;  // PGM only
+	bool bigEndian;     // PFM only
+	size_t dataOffset;
+};
+
+// Header tokens are separated by whitespace, PGM also allows # comments
+static bool next_token(const char* header, size_t size, size_t& pos, char* token, size_t capacity) noexcept {
+	for (;;) {
+		while (pos < size && (header[pos] == ' ' || header[pos] == '\t' || header[pos] == '\r' || header[pos] == '\n')) {
+			++pos;
+		}
+		if (pos < size && header[pos] == '#') {
+			while (pos < size && header[pos] != '\n') {
+				++pos;
+			}
+			continue;
+		}
+		break;
+	}
+
+	size_t length = 0u;
+	while (pos < size && length + 1u < capacity && header[pos] != ' ' && header[pos] != '\t' && header[pos] != '\r' && header[pos] != '\n') {
+		token[length++] = header[pos++];
+	}
+	token[length] = '\0';
+	return length != 0u;
+}
+
+static bool parse_dimension(const char* token, uint32_t& value) noexcept {
+	char* end;
+	const unsigned long parsed = strtoul(token, &end, 10);
+	if (*end != '\0' || parsed == 0ul || parsed > 0xFFFFFFFFul) {
+		return false;
+	}
+	value = static_cast<uint32_t>(parsed);
+	return true;
+}
+
+// Fills in everything but dataOffset validation against the file size
+static bool parse_header(const char* header, size_t size, FileLayout& layout) noexcept {
+	char token[64];
+	size_t pos = 0u;
+
+	if (!next_token(header, size, pos, token, sizeof(token))) {
+		return false;
+	}
+
+	const bool pfm = strcmp(token, "Pf") == 0;
+	if (!pfm && strcmp(token, "P5") != 0) {
+		return false;
+	}
+
+	if (!next_token(header, size, pos, token, sizeof(token)) || !parse_dimension(token, layout.width)) {
+		return false;
+	}
+	if (!next_token(header, size, pos, token, sizeof(token)) || !parse_dimension(token, layout.height)) {
+		return false;
+	}
+	if (!next_token(header, size, pos, token, sizeof(token))) {
+		return false;
+	}
+
+	if (pfm) {
+		const double scale = strtod(token, nullptr);
+		if (scale == 0.0) {
+			return false;
+		}
+		layout.format = SobelFileFormat::kPfm;
+		layout.bytesPerSample = 4u;
+		layout.bigEndian = scale > 0.0;
+	} else {
+		uint32_t maxValue;
+		if (!parse_dimension(token, maxValue) || maxValue > 65535u) {
+			return false;
+		}
+		layout.format = SobelFileFormat::kPgm;
+		layout.bytesPerSample = maxValue > 255u ? 2u : 1u;
+		layout.maxValue = maxValue;
+	}
+
+	// Exactly one whitespace character ends the header
+	if (pos >= size) {
+		return false;
+	}
+	layout.dataOffset = pos + 1u;
+	return true;
+}
+
+static void load_row(const FileLayout& layout, const uint8_t* in, float* out) noexcept {
+	if (layout.format == SobelFileFormat::kPgm) {
+		if (layout.bytesPerSample == 1u) {
+			for (uint32_t x = 0u; x < layout.width; ++x) {
+				out[x] = static_cast<float>(in[x]);
+			}
+		} else {
+			for (uint32_t x = 0u; x < layout.width; ++x) {
+				out[x] = static_cast<float>((static_cast<uint32_t>(in[2u * x]) << 8) | in[2u * x + 1u]);
+			}
+		}
+	} else if (layout.bigEndian) {
+		for (uint32_t x = 0u; x < layout.width; ++x) {
+			const uint32_t bits = (static_cast<uint32_t>(in[4u * x]) << 24) | (static_cast<uint32_t>(in[4u * x + 1u]) << 16) | (static_cast<uint32_t>(in[4u * x + 2u]) << 8) | in[4u * x + 3u];
+			memcpy(&out[x], &bits, sizeof(bits));
+		}
+	} else {
+		memcpy(out, in, static_cast<size_t>(layout.width) * sizeof(float));
+	}
+}
+
+// Outputs are little endian floats, or PGM samples in the input's depth
+static void store_row(const FileLayout& layout, const float* in, uint8_t* out) noexcept {
+	if (layout.format == SobelFileFormat::kPgm) {
+		const float maxValue = static_cast<float>(layout.maxValue);
+		for (uint32_t x = 0u; x < layout.width; ++x) {
+			const uint32_t value = static_cast<uint32_t>(std::nearbyint(std::min(in[x], maxValue)));
+			if (layout.bytesPerSample == 1u) {
+				out[x] = static_cast<uint8_t>(value);
+			} else {
+				out[2u * x] = static_cast<uint8_t>(value >> 8);
+				out[2u * x + 1u] = static_cast<uint8_t>(value);
+			}
+		}
+	} else {
+		memcpy(out, in, static_cast<size_t>(layout.width) * sizeof(float));
+	}
+}
+
+SobelFileFormat sobel_file_format(const char* path) noexcept {
+	char magic[2] = { 0, 0 };
+	FILE* file = fopen(path, "rb");
+	if (file != nullptr) {
+		if (fread(magic, 1u, sizeof(magic), file) != sizeof(magic)) {
+			magic[0] = 0;
+		}
+		fclose(file);
+	}
+
+	if (magic[0] == 'P' && magic[1] == 'f') {
+		return SobelFileFormat::kPfm;
+	}
+	if (magic[0] == 'P' && magic[1] == '5') {
+		return SobelFileFormat::kPgm;
+	}
+	return SobelFileFormat::kRaw;
+}
+
+const char* sobel_file_status_string(SobelFileStatus status) noexcept {
+	switch (status) {
+	case SobelFileStatus::kOk:
+		return "ok";
+	case SobelFileStatus::kOpenFailed:
+		return "cannot open input or create output";
+	case SobelFileStatus::kBadHeader:
+		return "unsupported or truncated image";
+	case SobelFileStatus::kMapFailed:
+		return "cannot map or size the files";
+	case SobelFileStatus::kUnsupported:
+		return "memory mapped files are not supported on this platform";
+	case SobelFileStatus::kSameFile:
+		return "output would overwrite the input";
+	}
+	return "unknown";
+}
+
+#if defined(_WIN32)
+
+SobelFileStatus sobel_filter_file(const char*, const char*, SobelFileFormat, uint32_t, uint32_t, uint32_t, SobelIsa) noexcept {
+	return SobelFileStatus::kUnsupported;
+}
+
+#else
+
+// Drops mapped pages in [released, end) once the band walk is past them
+static void release_pages(uint8_t* base, size_t& released, size_t end, bool dirty) noexcept {
+	static const size_t kPageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	end &= ~(kPageSize - 1u);
+	if (end <= released) {
+		return;
+	}
+
+	if (dirty) {
+		// Start write back so the page cache does not pile up dirty pages
+		msync(base + released, end - released, MS_ASYNC);
+	}
+	madvise(base + released, end - released, MADV_DONTNEED);
+	released = end;
+}
+
+static SobelFileStatus filter_mapped(const FileLayout& layout, const uint8_t* in, uint8_t* out, size_t headerBytes, uint32_t bandRows, SobelIsa isa) noexcept {
+	const SobelRowsFn rows = sobel_kernels(sobel_resolve_isa(isa)).rows;
+	const uint32_t width = layout.width;
+	const uint32_t height = layout.height;
+	const size_t fileBytesPerLine = static_cast<size_t>(width) * layout.bytesPerSample;
+	const uint32_t bytesPerLine = (width * static_cast<uint32_t>(sizeof(float)) + 63u) & ~63u;
+	const uint32_t stagingRows = bandRows + 2u;
+
+	// Band plus halo rows in, magnitude rows out, aligned for every tier
+	std::vector<uint8_t> staging(2u * static_cast<size_t>(bytesPerLine) * stagingRows + 64u);
+	float* src = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(staging.data()) + 63u) & ~static_cast<uintptr_t>(63u));
+	float* dst = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(src) + static_cast<size_t>(bytesPerLine) * stagingRows);
+
+	const uint8_t* inData = in + layout.dataOffset;
+	uint8_t* outData = out + headerBytes;
+	size_t inReleased = 0u;
+	size_t outReleased = 0u;
+
+	for (uint32_t firstRow = 0u; firstRow < height; firstRow += bandRows) {
+		const uint32_t lastRow = std::min(firstRow + bandRows, height);
+		const uint32_t count = lastRow - firstRow + 2u;
+
+		// Staging row i holds image row firstRow - 1 + i, replicated at the image edges
+		for (uint32_t i = 0u; i < count; ++i) {
+			const int64_t y = static_cast<int64_t>(firstRow) - 1 + i;
+			const uint32_t row = y < 0 ? 0u : (y >= static_cast<int64_t>(height) ? height - 1u : static_cast<uint32_t>(y));
+			load_row(layout, inData + row * fileBytesPerLine, reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(src) + static_cast<size_t>(i) * bytesPerLine));
+		}
+
+		const uint32_t tasks = (count - 2u + kTaskRows - 1u) / kTaskRows;
+		SobelWorkers::shared().run(tasks, [&](uint32_t task) {
+			const uint32_t first = 1u + task * kTaskRows;
+			rows(src, dst, width, count, bytesPerLine, bytesPerLine, first, std::min(first + kTaskRows, count - 1u));
+		});
+
+		for (uint32_t y = firstRow; y < lastRow; ++y) {
+			store_row(layout, reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(dst) + static_cast<size_t>(y - firstRow + 1u) * bytesPerLine), outData + y * fileBytesPerLine);
+		}
+
+		// The last row of this band is the next band's upper halo
+		release_pages(const_cast<uint8_t*>(in), inReleased, layout.dataOffset + (lastRow - 1u) * fileBytesPerLine, false);
+		release_pages(out, outReleased, headerBytes + lastRow * fileBytesPerLine, true);
+	}
+
+	return SobelFileStatus::kOk;
+}
+
+SobelFileStatus sobel_filter_file(const char* input, const char* output, SobelFileFormat format, uint32_t width, uint32_t height, uint32_t bandRows, SobelIsa isa) noexcept {
+	const int inFile = open(input, O_RDONLY);
+	if (inFile < 0) {
+		return SobelFileStatus::kOpenFailed;
+	}
+
+	struct stat inStat;
+	if (fstat(inFile, &inStat) != 0 || inStat.st_size == 0) {
+		close(inFile);
+		return SobelFileStatus::kBadHeader;
+	}
+
+	const size_t inBytes = static_cast<size_t>(inStat.st_size);
+	void* inMap = mmap(nullptr, inBytes, PROT_READ, MAP_SHARED, inFile, 0);
+	close(inFile);
+	if (inMap == MAP_FAILED) {
+		return SobelFileStatus::kMapFailed;
+	}
+
+	const uint8_t* in = static_cast<const uint8_t*>(inMap);
+	madvise(inMap, inBytes, MADV_SEQUENTIAL);
+
+	FileLayout layout;
+	memset(&layout, 0, sizeof(layout));
+	if (format == SobelFileFormat::kRaw) {
+		layout.format = SobelFileFormat::kRaw;
+		layout.width = width;
+		layout.height = height;
+		layout.bytesPerSample = 4u;
+	} else if (!parse_header(reinterpret_cast<const char*>(in), std::min<size_t>(inBytes, 1024u), layout) || layout.format != format) {
+		munmap(inMap, inBytes);
+		return SobelFileStatus::kBadHeader;
+	}
+
+	const size_t dataBytes = static_cast<size_t>(layout.width) * layout.height * layout.bytesPerSample;
+	if (layout.width == 0u || layout.height == 0u || layout.dataOffset + dataBytes > inBytes) {
+		munmap(inMap, inBytes);
+		return SobelFileStatus::kBadHeader;
+	}
+
+	char header[96];
+	int headerBytes = 0;
+	if (layout.format == SobelFileFormat::kPfm) {
+		headerBytes = snprintf(header, sizeof(header), "Pf\n%u %u\n-1.0\n", layout.width, layout.height);
+	} else if (layout.format == SobelFileFormat::kPgm) {
+		headerBytes = snprintf(header, sizeof(header), "P5\n%u %u\n%u\n", layout.width, layout.height, layout.maxValue);
+	}
+
+	const size_t outBytes = static_cast<size_t>(headerBytes) + dataBytes;
+	// Not truncated on open: the output may turn out to be the input under another path
+	const int outFile = open(output, O_RDWR | O_CREAT, 0644);
+	if (outFile < 0) {
+		munmap(inMap, inBytes);
+		return SobelFileStatus::kOpenFailed;
+	}
+
+	struct stat outStat;
+	if (fstat(outFile, &outStat) == 0 && outStat.st_dev == inStat.st_dev && outStat.st_ino == inStat.st_ino) {
+		close(outFile);
+		munmap(inMap, inBytes);
+		return SobelFileStatus::kSameFile;
+	}
+
+	void* outMap = ftruncate(outFile, static_cast<off_t>(outBytes)) == 0 ? mmap(nullptr, outBytes, PROT_READ | PROT_WRITE, MAP_SHARED, outFile, 0) : MAP_FAILED;
+	close(outFile);
+	if (outMap == MAP_FAILED) {
+		munmap(inMap, inBytes);
+		return SobelFileStatus::kMapFailed;
+	}
+
+	madvise(outMap, outBytes, MADV_SEQUENTIAL);
+	memcpy(outMap, header, static_cast<size_t>(headerBytes));
+
+	const SobelFileStatus status = filter_mapped(layout, in, static_cast<uint8_t*>(outMap), static_cast<size_t>(headerBytes), bandRows != 0u ? bandRows : kDefaultBandRows, isa);
+
+	munmap(outMap, outBytes);
+	munmap(inMap, inBytes);
+	return status;
+}
+
+#endif
@@ -12,13 +12,21 @@
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 
 #include "sobel_filter.h"
+#include "sobel_engine.h"
+#include "sobel_internal.h"
+#include "sobel_probe.h"
 
 static constexpr uint32_t kByteAlign = sizeof(float);
 static constexpr uint32_t kMaskAlign = kByteAlign - 1u;
 static const float kScaleFactor = 1.0f / sqrtf(32.0f);
 
+static constexpr uint32_t kByteAlignDouble = sizeof(double);
+static constexpr uint32_t kMaskAlignDouble = kByteAlignDouble - 1u;
+static const double kScaleFactorDouble = 1.0 / sqrt(32.0);
+
 static inline const float* offset_ptr(const void* ptr, uintptr_t byteOffset) noexcept {
 #ifdef _DEBUG
 	assert((reinterpret_cast<uintptr_t>(ptr) & kMaskAlign) == 0u);
@@ -37,6 +45,49 @@ static inline float* offset_ptr(void* ptr, uintptr_t byteOffset) noexcept {
 	return static_cast<float*>(offsetPtr);
 }
 
+static inline const double* offset_ptr_double(const void* ptr, uintptr_t byteOffset) noexcept {
+#ifdef _DEBUG
+	assert((reinterpret_cast<uintptr_t>(ptr) & kMaskAlignDouble) == 0u);
+	assert((byteOffset & kMaskAlignDouble) == 0u);
+#endif
+	const void* offsetPtr = &(static_cast<const uint8_t*>(ptr)[byteOffset]);
+	return static_cast<const double*>(offsetPtr);
+}
+
+static inline double* offset_ptr_double(void* ptr, uintptr_t byteOffset) noexcept {
+#ifdef _DEBUG
+	assert((reinterpret_cast<uintptr_t>(ptr) & kMaskAlignDouble) == 0u);
+	assert((byteOffset & kMaskAlignDouble) == 0u);
+#endif
+	void* offsetPtr = &(static_cast<uint8_t*>(ptr)[byteOffset]);
+	return static_cast<double*>(offsetPtr);
+}
+
+static inline uint32_t clamp_index(int64_t i, uint32_t count) noexcept {
+	return i < 0 ? 0u : (i >= static_cast<int64_t>(count) ? count - 1u : static_cast<uint32_t>(i));
+}
+
+// 3x3 Sobel magnitude with clamped borders for images below the two rows and two
+// columns the row walk of sobel_filter needs
+template <typename T>
+static void sobel_filter_clamped(const T* src, T* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, T scale) noexcept {
+	for (uint32_t y = 0u; y < height; ++y) {
+		const T* pr = reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(src) + clamp_index(static_cast<int64_t>(y) - 1, height) * static_cast<uintptr_t>(bytesPerLineSrc));
+		const T* cr = reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(src) + y * static_cast<uintptr_t>(bytesPerLineSrc));
+		const T* nr = reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(src) + clamp_index(static_cast<int64_t>(y) + 1, height) * static_cast<uintptr_t>(bytesPerLineSrc));
+		T* dr = reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(dst) + y * static_cast<uintptr_t>(bytesPerLineDst));
+
+		for (uint32_t x = 0u; x < width; ++x) {
+			const uint32_t lx = clamp_index(static_cast<int64_t>(x) - 1, width);
+			const uint32_t rx = clamp_index(static_cast<int64_t>(x) + 1, width);
+
+			const T dx = (pr[rx] - pr[lx]) + 2 * (cr[rx] - cr[lx]) + (nr[rx] - nr[lx]);
+			const T dy = (pr[lx] - nr[lx]) + 2 * (pr[x] - nr[x]) + (pr[rx] - nr[rx]);
+			dr[x] = std::sqrt(dx * dx + dy * dy) * scale;
+		}
+	}
+}
+
 void sobel_filter(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
 #ifdef _DEBUG
 	// Verify 32 bit alignment
@@ -45,6 +96,13 @@ void sobel_filter(const float* __restrict src, float* __restrict dst, uint32_t w
 	assert((bytesPerLineSrc & kMaskAlign) == 0u);
 	assert((bytesPerLineDst & kMaskAlign) == 0u);
 #endif
+	SOBEL_PROBE(SobelIsa::kScalar, sobel_path(width, 1u), width, height, bytesPerLineSrc, bytesPerLineDst);
+
+	if (width < 2u || height < 2u) {
+		sobel_filter_clamped(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, kScaleFactor);
+		return;
+	}
+
 	const float* pr = src;
 	const float* cr = src;
 	const float* nr = offset_ptr(src, bytesPerLineSrc);
@@ -107,3 +165,525 @@ void sobel_filter(const float* __restrict src, float* __restrict dst, uint32_t w
 		dr = offset_ptr(dr, bytesPerLineDst);
 	}
 }
+
+void sobel_filter(const double* __restrict src, double* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+#ifdef _DEBUG
+	// Verify 64 bit alignment
+	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlignDouble) == 0u);
+	assert((reinterpret_cast<uintptr_t>(dst) & kMaskAlignDouble) == 0u);
+	assert((bytesPerLineSrc & kMaskAlignDouble) == 0u);
+	assert((bytesPerLineDst & kMaskAlignDouble) == 0u);
+#endif
+	if (width < 2u || height < 2u) {
+		sobel_filter_clamped(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, kScaleFactorDouble);
+		return;
+	}
+
+	const double* pr = src;
+	const double* cr = src;
+	const double* nr = offset_ptr_double(src, bytesPerLineSrc);
+	const double* lr = offset_ptr_double(src, (height - 1u) * static_cast<uintptr_t>(bytesPerLineSrc));
+
+	double* dr = dst;
+
+	const uint32_t lx = width - 1u;
+
+	while (pr < lr) {
+		{
+			const double dx =
+				1.0 * (pr[1u] - pr[0u]) +
+				2.0 * (cr[1u] - cr[0u]) +
+				1.0 * (nr[1u] - nr[0u]);
+
+			const double dy =
+				1.0 * (pr[0u] - nr[0u]) +
+				2.0 * (pr[0u] - nr[0u]) +
+				1.0 * (pr[1u] - nr[1u]);
+
+			dr[0u] = sqrt(dx * dx + dy * dy) * kScaleFactorDouble;
+		}
+
+		for (uint32_t x = 1u; x < lx; ++x) {
+			const double dx =
+				1.0 * (pr[x + 1u] - pr[x - 1u]) +
+				2.0 * (cr[x + 1u] - cr[x - 1u]) +
+				1.0 * (nr[x + 1u] - nr[x - 1u]);
+
+			const double dy =
+				1.0 * (pr[x - 1u] - nr[x - 1u]) +
+				2.0 * (pr[x] - nr[x]) +
+				1.0 * (pr[x + 1u] - nr[x + 1u]);
+
+			dr[x] = sqrt(dx * dx + dy * dy) * kScaleFactorDouble;
+		}
+
+		{
+			const double dx =
+				1.0 * (pr[lx] - pr[lx - 1u]) +
+				2.0 * (cr[lx] - cr[lx - 1u]) +
+				1.0 * (nr[lx] - nr[lx - 1u]);
+
+			const double dy =
+				1.0 * (pr[lx - 1u] - nr[lx - 1u]) +
+				2.0 * (pr[lx] - nr[lx]) +
+				1.0 * (pr[lx] - nr[lx]);
+
+			dr[lx] = sqrt(dx * dx + dy * dy) * kScaleFactorDouble;
+		}
+
+		pr = cr;
+		cr = nr;
+		nr = offset_ptr_double(nr, bytesPerLineSrc);
+		if (nr > lr) {
+			nr = lr;
+		}
+
+		dr = offset_ptr_double(dr, bytesPerLineDst);
+	}
+}
+
+// IEEE 754 binary16 conversions with round to nearest even, matching F16C
+static inline float half_to_float(uint16_t value) noexcept {
+	const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1Fu;
+	const uint32_t mantissa = value & 0x3FFu;
+
+	uint32_t bits;
+	if (exponent == 0u) {
+		// Zero or subnormal, mantissa * 2^-24
+		const float magnitude = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+		memcpy(&bits, &magnitude, sizeof(bits));
+		bits |= sign;
+	} else if (exponent == 31u) {
+		bits = sign | 0x7F800000u | (mantissa << 13);
+	} else {
+		bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+static inline uint16_t float_to_half(float value) noexcept {
+	static constexpr uint32_t kInfinity = 255u << 23;
+	static constexpr uint32_t kHalfOverflow = (127u + 16u) << 23;
+	static constexpr uint32_t kHalfNormal = 113u << 23;
+	static constexpr uint32_t kDenormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	uint32_t result;
+	if (bits >= kHalfOverflow) {
+		// Infinity or NaN
+		result = (bits > kInfinity) ? 0x7E00u : 0x7C00u;
+	} else if (bits < kHalfNormal) {
+		// Subnormal, let the float adder do the rounding
+		float magnitude;
+		float magic;
+		memcpy(&magnitude, &bits, sizeof(magnitude));
+		memcpy(&magic, &kDenormMagic, sizeof(magic));
+		magnitude += magic;
+		memcpy(&bits, &magnitude, sizeof(bits));
+		result = bits - kDenormMagic;
+	} else {
+		const uint32_t odd = (bits >> 13) & 1u;
+		bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFFu + odd;
+		result = bits >> 13;
+	}
+
+	return static_cast<uint16_t>(result | (sign >> 16));
+}
+
+struct ScalarFloat {
+	typedef float storage_type;
+	static inline float load(const float* ptr) noexcept { return *ptr; }
+	static inline void store(float* ptr, float v) noexcept { *ptr = v; }
+};
+
+struct ScalarHalf {
+	typedef uint16_t storage_type;
+	static inline float load(const uint16_t* ptr) noexcept { return half_to_float(*ptr); }
+	static inline void store(uint16_t* ptr, float v) noexcept { *ptr = float_to_half(v); }
+};
+
+struct ScalarUInt16 {
+	typedef uint16_t storage_type;
+	static inline float load(const uint16_t* ptr) noexcept { return static_cast<float>(*ptr); }
+	static inline void store(uint16_t* ptr, float v) noexcept { *ptr = static_cast<uint16_t>(std::nearbyint(v < 65535.0f ? v : 65535.0f)); }
+};
+
+// Direct 2D evaluation of a separable stencil with replicated borders, the reference for the SIMD engines
+template <typename Kernel, typename L>
+static inline void stencil_gradient(const typename L::storage_type* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t x, uint32_t y, float& dx, float& dy) noexcept {
+	static constexpr int64_t kRadius = static_cast<int64_t>(Kernel::kRadius);
+
+	dx = 0.0f;
+	dy = 0.0f;
+
+	for (int64_t j = -kRadius; j <= kRadius; ++j) {
+		const typename L::storage_type* row = engine_offset_ptr(src, clamp_index(y + j, height) * static_cast<uintptr_t>(bytesPerLineSrc));
+		const float sj = Kernel::smooth(static_cast<uint32_t>(j < 0 ? -j : j));
+		const float dj = j < 0 ? -Kernel::derivative(static_cast<uint32_t>(-j)) : Kernel::derivative(static_cast<uint32_t>(j));
+
+		for (int64_t i = -kRadius; i <= kRadius; ++i) {
+			const float p = L::load(&row[clamp_index(x + i, width)]);
+			const float si = Kernel::smooth(static_cast<uint32_t>(i < 0 ? -i : i));
+			const float di = i < 0 ? -Kernel::derivative(static_cast<uint32_t>(-i)) : Kernel::derivative(static_cast<uint32_t>(i));
+
+			dx += sj * di * p;
+			dy += dj * si * p;
+		}
+	}
+}
+
+template <typename Kernel, typename L = ScalarFloat, typename S = ScalarFloat>
+static void stencil_filter(const typename L::storage_type* __restrict src, typename S::storage_type* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	const float scale = static_cast<float>(1.0 / std::sqrt(Kernel::norm_squared()));
+
+	for (uint32_t y = 0u; y < height; ++y) {
+		typename S::storage_type* dr = engine_offset_ptr(dst, y * static_cast<uintptr_t>(bytesPerLineDst));
+
+		for (uint32_t x = 0u; x < width; ++x) {
+			float dx;
+			float dy;
+			stencil_gradient<Kernel, L>(src, width, height, bytesPerLineSrc, x, y, dx, dy);
+
+			S::store(&dr[x], sqrtf(dx * dx + dy * dy) * scale);
+		}
+	}
+}
+
+template <typename L>
+static void format_filter(const void* src, void* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatDst) noexcept {
+	const typename L::storage_type* typedSrc = static_cast<const typename L::storage_type*>(src);
+
+	switch (formatDst) {
+	case SobelFormat::kFloat16:
+		stencil_filter<Sobel3Kernel, L, ScalarHalf>(typedSrc, static_cast<uint16_t*>(dst), width, height, bytesPerLineSrc, bytesPerLineDst);
+		break;
+	case SobelFormat::kUInt16:
+		stencil_filter<Sobel3Kernel, L, ScalarUInt16>(typedSrc, static_cast<uint16_t*>(dst), width, height, bytesPerLineSrc, bytesPerLineDst);
+		break;
+	default:
+		stencil_filter<Sobel3Kernel, L, ScalarFloat>(typedSrc, static_cast<float*>(dst), width, height, bytesPerLineSrc, bytesPerLineDst);
+		break;
+	}
+}
+
+void sobel_filter_format(const void* __restrict src, void* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatSrc, SobelFormat formatDst) noexcept {
+	switch (formatSrc) {
+	case SobelFormat::kFloat16:
+		format_filter<ScalarHalf>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, formatDst);
+		break;
+	case SobelFormat::kUInt16:
+		format_filter<ScalarUInt16>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, formatDst);
+		break;
+	default:
+		format_filter<ScalarFloat>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, formatDst);
+		break;
+	}
+}
+
+void scharr_filter(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	stencil_filter<Scharr3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
+
+void sobel5_filter(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	stencil_filter<Sobel5Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
+
+void sobel7_filter(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	stencil_filter<Sobel7Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
+
+// 3x3 Sobel gradient in the evaluation order of the SIMD engine: column sums first,
+// then the horizontal pass, with the weights of two folded into additions
+static inline void sobel3_gradient(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t x, uint32_t y, float& dx, float& dy) noexcept {
+	const float* top = offset_ptr(src, clamp_index(static_cast<int64_t>(y) - 1, height) * static_cast<uintptr_t>(bytesPerLineSrc));
+	const float* mid = offset_ptr(src, y * static_cast<uintptr_t>(bytesPerLineSrc));
+	const float* low = offset_ptr(src, clamp_index(static_cast<int64_t>(y) + 1, height) * static_cast<uintptr_t>(bytesPerLineSrc));
+
+	float vs[3];
+	float vd[3];
+	for (uint32_t i = 0u; i < 3u; ++i) {
+		const uint32_t cx = clamp_index(static_cast<int64_t>(x) + i - 1, width);
+		vs[i] = (mid[cx] + mid[cx]) + (top[cx] + low[cx]);
+		vd[i] = low[cx] - top[cx];
+	}
+
+	dx = vs[2] - vs[0];
+	dy = (vd[1] + vd[1]) + (vd[2] + vd[0]);
+}
+
+void sobel_edge_mask(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept {
+	const float limit = static_cast<float>(engine_mask_limit(threshold, Sobel3Kernel::norm_squared()));
+
+	for (uint32_t y = 0u; y < height; ++y) {
+		uint8_t* mr = &mask[y * static_cast<uintptr_t>(bytesPerLineMask)];
+		memset(mr, 0, (width + 7u) / 8u);
+
+		for (uint32_t x = 0u; x < width; ++x) {
+			float dx;
+			float dy;
+			sobel3_gradient(src, width, height, bytesPerLineSrc, x, y, dx, dy);
+
+			const float squared = dx * dx + dy * dy;
+			if (squared > limit) {
+				mr[x / 8u] |= static_cast<uint8_t>(1u << (x % 8u));
+			}
+		}
+	}
+}
+
+void sobel_filter_stats(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept {
+	const double scale = 1.0 / std::sqrt(Sobel3Kernel::norm_squared());
+	const float binScale = histogramMax > 0.0f ? 256.0f / histogramMax : 0.0f;
+	const float binBase = histogramMax > 0.0f ? 0.0f : 255.0f;
+
+	memset(stats, 0, sizeof(*stats));
+
+	for (uint32_t y = 0u; y < height; ++y) {
+		float* dr = (dst != nullptr) ? offset_ptr(dst, y * static_cast<uintptr_t>(bytesPerLineDst)) : nullptr;
+
+		for (uint32_t x = 0u; x < width; ++x) {
+			float dx;
+			float dy;
+			stencil_gradient<Sobel3Kernel, ScalarFloat>(src, width, height, bytesPerLineSrc, x, y, dx, dy);
+
+			const float squared = dx * dx + dy * dy;
+			const float magnitude = sqrtf(squared) * static_cast<float>(scale);
+			const float bin = magnitude * binScale + binBase;
+
+			stats->focus += squared * scale * scale;
+			stats->maximum = magnitude > stats->maximum ? magnitude : stats->maximum;
+			++stats->histogram[bin < 255.0f ? (bin > 0.0f ? static_cast<uint32_t>(bin) : 0u) : 255u];
+
+			if (dr != nullptr) {
+				dr[x] = magnitude;
+			}
+		}
+	}
+}
+
+void sobel_rows(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	SOBEL_PROBE(SobelIsa::kScalar, SobelPath::kBand, width, lastRow - firstRow, bytesPerLineSrc, bytesPerLineDst);
+
+	const float scale = static_cast<float>(1.0 / std::sqrt(Sobel3Kernel::norm_squared()));
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		float* dr = offset_ptr(dst, y * static_cast<uintptr_t>(bytesPerLineDst));
+
+		for (uint32_t x = 0u; x < width; ++x) {
+			float dx;
+			float dy;
+			stencil_gradient<Sobel3Kernel, ScalarFloat>(src, width, height, bytesPerLineSrc, x, y, dx, dy);
+			dr[x] = sqrtf(dx * dx + dy * dy) * scale;
+		}
+	}
+}
+
+void sobel_row(const float* const* rows, float* out, uint32_t width) noexcept {
+	const float* pr = rows[0];
+	const float* cr = rows[1];
+	const float* nr = rows[2];
+
+	for (uint32_t x = 0u; x < width; ++x) {
+		const uint32_t lx = clamp_index(static_cast<int64_t>(x) - 1, width);
+		const uint32_t rx = clamp_index(static_cast<int64_t>(x) + 1, width);
+
+		const float dx = (pr[rx] - pr[lx]) + 2.0f * (cr[rx] - cr[lx]) + (nr[rx] - nr[lx]);
+		const float dy = (nr[lx] - pr[lx]) + 2.0f * (nr[x] - pr[x]) + (nr[rx] - pr[rx]);
+		out[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
+	}
+}
+
+void sobel_convert_row(const void* src, SobelFormat format, float* dst, uint32_t width) noexcept {
+	if (format == SobelFormat::kFloat16) {
+		const uint16_t* typed = static_cast<const uint16_t*>(src);
+		for (uint32_t x = 0u; x < width; ++x) {
+			dst[x] = half_to_float(typed[x]);
+		}
+	} else if (format == SobelFormat::kUInt16) {
+		const uint16_t* typed = static_cast<const uint16_t*>(src);
+		for (uint32_t x = 0u; x < width; ++x) {
+			dst[x] = static_cast<float>(typed[x]);
+		}
+	} else {
+		memcpy(dst, src, static_cast<size_t>(width) * sizeof(float));
+	}
+}
+
+// Magnitude row lookup with empty neighbors outside the image, as in engine_canny_nms
+static inline float canny_at(const float* row, int64_t x, uint32_t width) noexcept {
+	return (row != nullptr && x >= 0 && x < static_cast<int64_t>(width)) ? row[x] : 0.0f;
+}
+
+void sobel_canny_rows(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept {
+	static constexpr float kTan22 = 0.41421356237309503f;
+	static constexpr float kTan67 = 2.4142135623730949f;
+
+	const uint32_t stride = engine_canny_stride(width);
+	const float lowLimit = static_cast<float>(static_cast<double>(low) * low * Sobel3Kernel::norm_squared());
+	const float highLimit = static_cast<float>(static_cast<double>(high) * high * Sobel3Kernel::norm_squared());
+
+	// Same ring layout as GradientOutput: magnitude, gx and gy rows by row modulo 3
+	uint32_t next = firstRow != 0u ? firstRow - 1u : 0u;
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		const uint32_t below = y + 1u < height ? y + 1u : y;
+		for (; next <= below; ++next) {
+			const uintptr_t slot = next % 3u;
+			for (uint32_t x = 0u; x < width; ++x) {
+				float dx;
+				float dy;
+				stencil_gradient<Sobel3Kernel, ScalarFloat>(src, width, height, bytesPerLineSrc, x, next, dx, dy);
+				scratch[slot * stride + x] = dx * dx + dy * dy;
+				scratch[(3u + slot) * stride + x] = dx;
+				scratch[(6u + slot) * stride + x] = dy;
+			}
+		}
+
+		const float* up = y != 0u ? &scratch[((y - 1u) % 3u) * static_cast<uintptr_t>(stride)] : nullptr;
+		const float* center = &scratch[(y % 3u) * static_cast<uintptr_t>(stride)];
+		const float* down = y + 1u < height ? &scratch[((y + 1u) % 3u) * static_cast<uintptr_t>(stride)] : nullptr;
+		const float* gxRow = &scratch[(3u + y % 3u) * static_cast<uintptr_t>(stride)];
+		const float* gyRow = &scratch[(6u + y % 3u) * static_cast<uintptr_t>(stride)];
+
+		uint64_t* sr = &strong[y * static_cast<uintptr_t>(wordsPerLine)];
+		uint64_t* cr = &candidates[y * static_cast<uintptr_t>(wordsPerLine)];
+		memset(sr, 0, ((width + 63u) / 64u) * sizeof(uint64_t));
+		memset(cr, 0, ((width + 63u) / 64u) * sizeof(uint64_t));
+
+		for (uint32_t x = 0u; x < width; ++x) {
+			const float m = center[x];
+			const float gx = gxRow[x];
+			const float gy = gyRow[x];
+			const float ax = fabsf(gx);
+			const float ay = fabsf(gy);
+
+			float a;
+			float b;
+			if (!(ay > ax * kTan22)) {
+				a = canny_at(center, static_cast<int64_t>(x) - 1, width);
+				b = canny_at(center, x + 1, width);
+			} else if (ay > ax * kTan67) {
+				a = canny_at(up, x, width);
+				b = canny_at(down, x, width);
+			} else if (gx * gy > 0.0f) {
+				a = canny_at(up, static_cast<int64_t>(x) - 1, width);
+				b = canny_at(down, x + 1, width);
+			} else {
+				a = canny_at(up, x + 1, width);
+				b = canny_at(down, static_cast<int64_t>(x) - 1, width);
+			}
+
+			if (m > a && !(b > m)) {
+				const uint64_t bit = uint64_t(1u) << (x % 64u);
+				if (m > highLimit) {
+					sr[x / 64u] |= bit;
+				}
+				if (m > lowLimit) {
+					cr[x / 64u] |= bit;
+				}
+			}
+		}
+	}
+}
+
+// The scalar tier has no shape specializations
+SobelFixedFn sobel_fixed(uint32_t, uint32_t, uint32_t, uint32_t) noexcept {
+	return nullptr;
+}
+
+void sobel_downsample(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	const uint32_t outWidth = (width + 1u) / 2u;
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		const float* a = offset_ptr(src, 2u * y * static_cast<uintptr_t>(bytesPerLineSrc));
+		const float* b = offset_ptr(src, clamp_index(2u * y + 1u, height) * static_cast<uintptr_t>(bytesPerLineSrc));
+		float* dr = offset_ptr(dst, y * static_cast<uintptr_t>(bytesPerLineDst));
+
+		for (uint32_t x = 0u; x < outWidth; ++x) {
+			const uint32_t x0 = 2u * x;
+			const uint32_t x1 = clamp_index(x0 + 1u, width);
+			dr[x] = 0.25f * ((a[x0] + a[x1]) + (b[x0] + b[x1]));
+		}
+	}
+}
+
+// Vertical [1 2 1] and [-1 0 1] sums of column x around row y, see engine_temporal
+static inline void temporal_vertical(const float* src, uint32_t height, uint32_t bytesPerLineSrc, uint32_t x, uint32_t y, float& vs, float& vd) noexcept {
+	const float top = offset_ptr(src, clamp_index(static_cast<int64_t>(y) - 1, height) * static_cast<uintptr_t>(bytesPerLineSrc))[x];
+	const float mid = offset_ptr(src, y * static_cast<uintptr_t>(bytesPerLineSrc))[x];
+	const float low = offset_ptr(src, clamp_index(static_cast<int64_t>(y) + 1, height) * static_cast<uintptr_t>(bytesPerLineSrc))[x];
+	vs = 2.0f * mid + (top + low);
+	vd = low - top;
+}
+
+void sobel_temporal_sums(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept {
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		float* vsRow = offset_ptr(smooth, y * static_cast<uintptr_t>(bytesPerLineSums));
+		float* vdRow = offset_ptr(derivative, y * static_cast<uintptr_t>(bytesPerLineSums));
+
+		for (uint32_t x = 0u; x < width; ++x) {
+			temporal_vertical(src, height, bytesPerLineSrc, x, y, vsRow[x], vdRow[x]);
+		}
+	}
+}
+
+void sobel_temporal_rows(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept {
+	const uint32_t stride = engine_temporal_stride(width);
+	const float componentScale = 1.0f / 16.0f;
+	const float magnitudeScale = static_cast<float>(1.0 / std::sqrt(3.0));
+	float* sRow = scratch;
+	float* dRow = &scratch[stride];
+	float* tRow = &scratch[2u * static_cast<uintptr_t>(stride)];
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		for (uint32_t x = 0u; x < width; ++x) {
+			float vs[3];
+			float vd[3];
+			for (uint32_t t = 0u; t < 3u; ++t) {
+				if (source->smooth[t] != nullptr) {
+					vs[t] = offset_ptr(source->smooth[t], y * static_cast<uintptr_t>(source->bytesPerLineSums))[x];
+					vd[t] = offset_ptr(source->derivative[t], y * static_cast<uintptr_t>(source->bytesPerLineSums))[x];
+				} else {
+					temporal_vertical(source->frames[t], height, source->bytesPerLine, x, y, vs[t], vd[t]);
+				}
+			}
+			if (source->store[0] != nullptr) {
+				offset_ptr(source->store[0], y * static_cast<uintptr_t>(source->bytesPerLineSums))[x] = vs[2];
+				offset_ptr(source->store[1], y * static_cast<uintptr_t>(source->bytesPerLineSums))[x] = vd[2];
+			}
+			sRow[x] = vs[0] + 2.0f * vs[1] + vs[2];
+			dRow[x] = vd[0] + 2.0f * vd[1] + vd[2];
+			tRow[x] = vs[2] - vs[0];
+		}
+
+		for (uint32_t x = 0u; x < width; ++x) {
+			const uint32_t lx = clamp_index(static_cast<int64_t>(x) - 1, width);
+			const uint32_t rx = clamp_index(static_cast<int64_t>(x) + 1, width);
+
+			const float gx = (sRow[rx] - sRow[lx]) * componentScale;
+			const float gy = (dRow[lx] + 2.0f * dRow[x] + dRow[rx]) * componentScale;
+			const float gt = (tRow[lx] + 2.0f * tRow[x] + tRow[rx]) * componentScale;
+			if (output->gx != nullptr) {
+				offset_ptr(output->gx, y * static_cast<uintptr_t>(output->bytesPerLine))[x] = gx;
+			}
+			if (output->gy != nullptr) {
+				offset_ptr(output->gy, y * static_cast<uintptr_t>(output->bytesPerLine))[x] = gy;
+			}
+			if (output->gt != nullptr) {
+				offset_ptr(output->gt, y * static_cast<uintptr_t>(output->bytesPerLine))[x] = gt;
+			}
+			if (output->magnitude != nullptr) {
+				offset_ptr(output->magnitude, y * static_cast<uintptr_t>(output->bytesPerLine))[x] = sqrtf(gx * gx + gy * gy + gt * gt) * magnitudeScale;
+			}
+		}
+	}
+}
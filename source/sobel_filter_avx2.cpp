@@ -9,323 +9,254 @@
  * - The authors reserve the rights to change the license agreements in future versions of the software
  */
 
-#include <cassert>
-#include <cmath>
 #include <cstdint>
 
 #include <immintrin.h> // Intel AVX
 
 #include "sobel_filter.h"
+#include "sobel_engine.h"
+#include "sobel_internal.h"
+#include "sobel_probe.h"
+
+// AVX2 vector operations for the generic stencil engine
+struct Avx2Float {
+	typedef __m256 type;
+	typedef float value_type;
+
+	static constexpr uint32_t kWidth = 8u;
+
+	static inline type load(const float* ptr) noexcept { return _mm256_load_ps(ptr); }
+	static inline void store(float* ptr, type v) noexcept { _mm256_store_ps(ptr, v); }
+	static inline void stream(float* ptr, type v) noexcept { _mm256_stream_ps(ptr, v); }
+	static inline type set1(float v) noexcept { return _mm256_set1_ps(v); }
+	static inline type add(type a, type b) noexcept { return _mm256_add_ps(a, b); }
+	static inline type sub(type a, type b) noexcept { return _mm256_sub_ps(a, b); }
+	static inline type mul(type a, type b) noexcept { return _mm256_mul_ps(a, b); }
+	static inline type fmadd(type a, type b, type c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+	static inline type sqrt(type v) noexcept { return _mm256_sqrt_ps(v); }
+	static inline type min(type a, type b) noexcept { return _mm256_min_ps(a, b); }
+	static inline type max(type a, type b) noexcept { return _mm256_max_ps(a, b); }
+
+	// Bit per lane where a > b
+	static inline uint32_t mask_greater(type a, type b) noexcept { return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ))); }
+
+	// Truncating conversion to 32 bit integers
+	static inline void store_int(int32_t* ptr, type v) noexcept { _mm256_store_si256(reinterpret_cast<__m256i*>(ptr), _mm256_cvttps_epi32(v)); }
+
+	// Horizontal reductions
+	static inline float reduce_add(type v) noexcept {
+		__m128 r = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		r = _mm_add_ps(r, _mm_movehl_ps(r, r));
+		return _mm_cvtss_f32(_mm_add_ss(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
 
-#define RSHIFT(shift) _mm256_permutevar8x32_ps(shift, kRightShiftVec)
-#define LSHIFT(shift) _mm256_permutevar8x32_ps(shift, kLeftShiftVec)
-#define RSHIFTM(shift, merge) _mm256_blend_ps(RSHIFT(shift), _mm256_permutevar8x32_ps(merge, kRightMergeVec), 0b00000001)
-#define LSHIFTM(shift, merge) _mm256_blend_ps(LSHIFT(shift), _mm256_permutevar8x32_ps(merge, kLeftMergeVec), 0b10000000)
+	static inline float reduce_max(type v) noexcept {
+		__m128 r = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		r = _mm_max_ps(r, _mm_movehl_ps(r, r));
+		return _mm_cvtss_f32(_mm_max_ss(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
 
-static constexpr uint32_t kSimdWidth = 8u;
-static constexpr uint32_t kByteAlign = kSimdWidth * sizeof(float);
-static constexpr uint32_t kMaskAlign = kByteAlign - 1u;
+	// Sums of adjacent lane pairs, those of a in the low half and those of b in the high half
+	static inline type pairwise_add(type a, type b) noexcept {
+		const __m256 sum = _mm256_add_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
 
-alignas(32) static constexpr uint32_t kRightShift[8] = { 0, 0, 1, 2, 3, 4, 5, 6 };
-alignas(32) static constexpr uint32_t kLeftShift[8] = { 1, 2, 3, 4, 5, 6, 7, 7 };
-alignas(32) static constexpr uint32_t kRightMerge[8] = { 7, 7, 7, 7, 7, 7, 7, 7 };
-alignas(32) static constexpr uint32_t kLeftMerge[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	// Broadcast the first/last lane, used to replicate the left/right border
+	static inline type first(type v) noexcept { return _mm256_permutevar8x32_ps(v, _mm256_setzero_si256()); }
+	static inline type last(type v) noexcept { return _mm256_permutevar8x32_ps(v, _mm256_set1_epi32(7)); }
+
+	// Lanes shifted K steps towards higher/lower indices, filled from the neighboring block.
+	// The 128 bit lane swap lets the in-lane byte alignment cross the lane boundary.
+	template <uint32_t K>
+	static inline type shift_right(type curr, type prev) noexcept {
+		static_assert(K <= 4u, "shift limited to one 128 bit lane");
+		const __m256 swap = _mm256_permute2f128_ps(prev, curr, 0x21);
+		return _mm256_castsi256_ps(_mm256_alignr_epi8(_mm256_castps_si256(curr), _mm256_castps_si256(swap), 16 - 4 * K));
+	}
 
-static const __m256i kRightShiftVec = _mm256_load_si256(reinterpret_cast<const __m256i*>(&kRightShift[0]));
-static const __m256i kLeftShiftVec = _mm256_load_si256(reinterpret_cast<const __m256i*>(&kLeftShift[0]));
-static const __m256i kRightMergeVec = _mm256_load_si256(reinterpret_cast<const __m256i*>(&kRightMerge[0]));
-static const __m256i kLeftMergeVec = _mm256_load_si256(reinterpret_cast<const __m256i*>(&kLeftMerge[0]));
+	template <uint32_t K>
+	static inline type shift_left(type curr, type next) noexcept {
+		static_assert(K <= 4u, "shift limited to one 128 bit lane");
+		const __m256 swap = _mm256_permute2f128_ps(curr, next, 0x21);
+		return _mm256_castsi256_ps(_mm256_alignr_epi8(_mm256_castps_si256(swap), _mm256_castps_si256(curr), 4 * K));
+	}
+};
 
-static const float kScaleFactor = 1.0f / sqrtf(32.0f);
-static const __m256 kScaleVec = _mm256_set1_ps(kScaleFactor);
+static const SobelFixedKernel kFixedKernels[] = {
+	SOBEL_FIXED_SHAPES(Avx2Float)
+};
 
-static inline const float* offset_ptr(const void* ptr, uintptr_t byteOffset) noexcept {
-#ifdef _DEBUG
-	assert((reinterpret_cast<uintptr_t>(ptr) & kMaskAlign) == 0u);
-	assert((byteOffset & kMaskAlign) == 0u);
-#endif
-	const void* offsetPtr = &static_cast<const uint8_t*>(ptr)[byteOffset];
-	return static_cast<const float*>(offsetPtr);
-}
-
-static inline float* offset_ptr(void* ptr, uintptr_t byteOffset) noexcept {
-#ifdef _DEBUG
-	assert((reinterpret_cast<uintptr_t>(ptr) & kMaskAlign) == 0u);
-	assert((byteOffset & kMaskAlign) == 0u);
-#endif
-	void* offsetPtr = &static_cast<uint8_t*>(ptr)[byteOffset];
-	return static_cast<float*>(offsetPtr);
+SobelFixedFn sobel_fixed_avx2(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	return sobel_fixed_lookup(kFixedKernels, width, height, bytesPerLineSrc, bytesPerLineDst);
 }
 
 void sobel_filter_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
 #ifdef _DEBUG
-	// Verify 256 bit alignment
+	// Verify 256 bit alignment here, fixed shapes do not go through engine_filter
+	static constexpr uintptr_t kMaskAlign = Avx2Float::kWidth * sizeof(float) - 1u;
 	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
 	assert((reinterpret_cast<uintptr_t>(dst) & kMaskAlign) == 0u);
 	assert((bytesPerLineSrc & kMaskAlign) == 0u);
 	assert((bytesPerLineDst & kMaskAlign) == 0u);
-	// Verify minimum SIMD width
-	assert(width >= kSimdWidth);
 #endif
+	// Production shapes with dense rows run a compile-time specialization
+	const SobelFixedFn fixed = sobel_fixed_avx2(width, height, bytesPerLineSrc, bytesPerLineDst);
+	SOBEL_PROBE(SobelIsa::kAvx2, fixed != nullptr ? SobelPath::kFixed : sobel_path(width, Avx2Float::kWidth), width, height, bytesPerLineSrc, bytesPerLineDst);
 
-	const float* pr = src;
-	const float* cr = src;
-	const float* nr = offset_ptr(src, bytesPerLineSrc);
-	const float* lr = offset_ptr(src, (height - 1u) * static_cast<uintptr_t>(bytesPerLineSrc));
-
-	float* dr = dst;
-
-	if ((width & 7u) == 0u) {
-		if (width >= 16u) {
-			while (pr < lr) {
-				__m256 top = _mm256_load_ps(pr);
-				__m256 mid = _mm256_load_ps(cr);
-				__m256 low = _mm256_load_ps(nr);
-
-				__m256 currx = _mm256_add_ps(_mm256_add_ps(mid, mid), _mm256_add_ps(top, low));
-				__m256 curry = _mm256_sub_ps(top, low);
-
-				top = _mm256_load_ps(&pr[8u]);
-				mid = _mm256_load_ps(&cr[8u]);
-				low = _mm256_load_ps(&nr[8u]);
-
-				__m256 nextx = _mm256_add_ps(_mm256_add_ps(mid, mid), _mm256_add_ps(top, low));
-				__m256 nexty = _mm256_sub_ps(top, low);
-
-				__m256 xout = _mm256_sub_ps(RSHIFT(currx), LSHIFTM(currx, nextx));
-				xout = _mm256_mul_ps(xout, xout);
-
-				__m256 out = _mm256_add_ps(_mm256_add_ps(curry, curry), _mm256_add_ps(RSHIFT(curry), LSHIFTM(curry, nexty)));
-				out = _mm256_fmadd_ps(out, out, xout);
-
-				out = _mm256_mul_ps(_mm256_sqrt_ps(out), kScaleVec);
-
-				_mm256_store_ps(dr, out);
-
-				uint32_t x = 16u;
-
-				for (; x < width; x += 8u) {
-					const __m256 prevx = currx;
-					const __m256 prevy = curry;
-
-					currx = nextx;
-					curry = nexty;
-
-					top = _mm256_load_ps(&pr[x]);
-					mid = _mm256_load_ps(&cr[x]);
-					low = _mm256_load_ps(&nr[x]);
-
-					nextx = _mm256_add_ps(_mm256_add_ps(mid, mid), _mm256_add_ps(top, low));
-					nexty = _mm256_sub_ps(top, low);
-
-					xout = _mm256_sub_ps(RSHIFTM(currx, prevx), LSHIFTM(currx, nextx));
-					xout = _mm256_mul_ps(xout, xout);
-
-					out = _mm256_add_ps(_mm256_add_ps(curry, curry), _mm256_add_ps(RSHIFTM(curry, prevy), LSHIFTM(curry, nexty)));
-					out = _mm256_fmadd_ps(out, out, xout);
-
-					out = _mm256_mul_ps(_mm256_sqrt_ps(out), kScaleVec);
-
-					_mm256_store_ps(&dr[x - 8u], out);
-				}
-
-				xout = _mm256_sub_ps(RSHIFTM(nextx, currx), LSHIFT(nextx));
-				xout = _mm256_mul_ps(xout, xout);
-
-				out = _mm256_add_ps(_mm256_add_ps(nexty, nexty), _mm256_add_ps(RSHIFTM(nexty, curry), LSHIFT(nexty)));
-				out = _mm256_fmadd_ps(out, out, xout);
-
-				out = _mm256_mul_ps(_mm256_sqrt_ps(out), kScaleVec);
-
-				_mm256_store_ps(&dr[x - 8u], out);
+	if (fixed != nullptr) {
+		fixed(src, dst);
+		return;
+	}
 
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		} else {
-			while (pr < lr) {
-				const __m256 top = _mm256_load_ps(pr);
-				const __m256 mid = _mm256_load_ps(cr);
-				const __m256 low = _mm256_load_ps(nr);
+	engine_filter<Avx2Float, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				__m256 xout = _mm256_add_ps(_mm256_add_ps(mid, mid), _mm256_add_ps(top, low));
-				xout = _mm256_sub_ps(RSHIFT(xout), LSHIFT(xout));
-				xout = _mm256_mul_ps(xout, xout);
+void scharr_filter_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx2Float, Scharr3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				__m256 out = _mm256_sub_ps(top, low);
-				out = _mm256_add_ps(_mm256_add_ps(out, out), _mm256_add_ps(RSHIFT(out), LSHIFT(out)));
-				out = _mm256_fmadd_ps(out, out, xout);
+void sobel5_filter_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx2Float, Sobel5Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				out = _mm256_mul_ps(_mm256_sqrt_ps(out), kScaleVec);
+void sobel7_filter_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx2Float, Sobel7Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				_mm256_store_ps(dr, out);
+struct Avx2Double {
+	typedef __m256d type;
+	typedef double value_type;
+
+	static constexpr uint32_t kWidth = 4u;
+
+	static inline type load(const double* ptr) noexcept { return _mm256_load_pd(ptr); }
+	static inline void store(double* ptr, type v) noexcept { _mm256_store_pd(ptr, v); }
+	static inline type set1(double v) noexcept { return _mm256_set1_pd(v); }
+	static inline type add(type a, type b) noexcept { return _mm256_add_pd(a, b); }
+	static inline type sub(type a, type b) noexcept { return _mm256_sub_pd(a, b); }
+	static inline type mul(type a, type b) noexcept { return _mm256_mul_pd(a, b); }
+	static inline type fmadd(type a, type b, type c) noexcept { return _mm256_fmadd_pd(a, b, c); }
+	static inline type sqrt(type v) noexcept { return _mm256_sqrt_pd(v); }
+
+	static inline type first(type v) noexcept { return _mm256_permute4x64_pd(v, 0b00000000); }
+	static inline type last(type v) noexcept { return _mm256_permute4x64_pd(v, 0b11111111); }
+
+	template <uint32_t K>
+	static inline type shift_right(type curr, type prev) noexcept {
+		static_assert(K <= 2u, "shift limited to one 128 bit lane");
+		const __m256d swap = _mm256_permute2f128_pd(prev, curr, 0x21);
+		return _mm256_castsi256_pd(_mm256_alignr_epi8(_mm256_castpd_si256(curr), _mm256_castpd_si256(swap), 16 - 8 * K));
+	}
 
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		}
-	} else {
-		if (width >= 16u) {
-			const uint32_t count = 8u * (width / 8u);
-			const uint32_t lx = width - 1u;
+	template <uint32_t K>
+	static inline type shift_left(type curr, type next) noexcept {
+		static_assert(K <= 2u, "shift limited to one 128 bit lane");
+		const __m256d swap = _mm256_permute2f128_pd(curr, next, 0x21);
+		return _mm256_castsi256_pd(_mm256_alignr_epi8(_mm256_castpd_si256(swap), _mm256_castpd_si256(curr), 8 * K));
+	}
+};
 
-			while (pr < lr) {
-				__m256 top = _mm256_load_ps(pr);
-				__m256 mid = _mm256_load_ps(cr);
-				__m256 low = _mm256_load_ps(nr);
+void sobel_filter_avx2(const double* __restrict src, double* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx2Double, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				__m256 currx = _mm256_add_ps(_mm256_add_ps(mid, mid), _mm256_add_ps(top, low));
-				__m256 curry = _mm256_sub_ps(top, low);
+// F16C half float storage
+struct Avx2Half {
+	typedef uint16_t storage_type;
 
-				top = _mm256_load_ps(&pr[8u]);
-				mid = _mm256_load_ps(&cr[8u]);
-				low = _mm256_load_ps(&nr[8u]);
+	static inline __m256 load(const uint16_t* ptr) noexcept {
+		return _mm256_cvtph_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(ptr)));
+	}
 
-				__m256 nextx = _mm256_add_ps(_mm256_add_ps(mid, mid), _mm256_add_ps(top, low));
-				__m256 nexty = _mm256_sub_ps(top, low);
+	static inline void store(uint16_t* ptr, __m256 v) noexcept {
+		_mm_store_si128(reinterpret_cast<__m128i*>(ptr), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+	}
+};
 
-				__m256 xout = _mm256_sub_ps(RSHIFT(currx), LSHIFTM(currx, nextx));
-				xout = _mm256_mul_ps(xout, xout);
+// 16 bit unsigned integer storage, rounded and saturated on store
+struct Avx2UInt16 {
+	typedef uint16_t storage_type;
 
-				__m256 out = _mm256_add_ps(_mm256_add_ps(curry, curry), _mm256_add_ps(RSHIFT(curry), LSHIFTM(curry, nexty)));
-				out = _mm256_fmadd_ps(out, out, xout);
+	static inline __m256 load(const uint16_t* ptr) noexcept {
+		return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(ptr))));
+	}
 
-				out = _mm256_mul_ps(_mm256_sqrt_ps(out), kScaleVec);
+	static inline void store(uint16_t* ptr, __m256 v) noexcept {
+		const __m256i i = _mm256_cvtps_epi32(_mm256_min_ps(v, _mm256_set1_ps(65535.0f)));
+		_mm_store_si128(reinterpret_cast<__m128i*>(ptr), _mm_packus_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1)));
+	}
+};
+
+template <typename L>
+static void format_filter_avx2(const void* src, void* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatDst) noexcept {
+	const typename L::storage_type* typedSrc = static_cast<const typename L::storage_type*>(src);
+
+	switch (formatDst) {
+	case SobelFormat::kFloat16:
+		engine_filter<Avx2Float, Sobel3Kernel, L, Avx2Half>(typedSrc, static_cast<uint16_t*>(dst), width, height, bytesPerLineSrc, bytesPerLineDst);
+		break;
+	case SobelFormat::kUInt16:
+		engine_filter<Avx2Float, Sobel3Kernel, L, Avx2UInt16>(typedSrc, static_cast<uint16_t*>(dst), width, height, bytesPerLineSrc, bytesPerLineDst);
+		break;
+	default:
+		engine_filter<Avx2Float, Sobel3Kernel, L>(typedSrc, static_cast<float*>(dst), width, height, bytesPerLineSrc, bytesPerLineDst);
+		break;
+	}
+}
 
-				_mm256_store_ps(dr, out);
+void sobel_filter_format_avx2(const void* __restrict src, void* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatSrc, SobelFormat formatDst) noexcept {
+	switch (formatSrc) {
+	case SobelFormat::kFloat16:
+		format_filter_avx2<Avx2Half>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, formatDst);
+		break;
+	case SobelFormat::kUInt16:
+		format_filter_avx2<Avx2UInt16>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, formatDst);
+		break;
+	default:
+		format_filter_avx2<EngineNative<Avx2Float> >(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, formatDst);
+		break;
+	}
+}
 
-				uint32_t x = 16u;
+void sobel_edge_mask_avx2(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept {
+	engine_mask<Avx2Float, Sobel3Kernel>(src, mask, width, height, bytesPerLineSrc, bytesPerLineMask, threshold);
+}
 
-				for (; x < count; x += 8u) {
-					const __m256 prevx = currx;
-					const __m256 prevy = curry;
+void sobel_filter_stats_avx2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept {
+	engine_stats<Avx2Float, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, histogramMax, stats);
+}
 
-					currx = nextx;
-					curry = nexty;
+void sobel_rows_avx2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	SOBEL_PROBE(SobelIsa::kAvx2, SobelPath::kBand, width, lastRow - firstRow, bytesPerLineSrc, bytesPerLineDst);
 
-					top = _mm256_load_ps(&pr[x]);
-					mid = _mm256_load_ps(&cr[x]);
-					low = _mm256_load_ps(&nr[x]);
+	engine_band<Avx2Float, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+}
 
-					nextx = _mm256_add_ps(_mm256_add_ps(mid, mid), _mm256_add_ps(top, low));
-					nexty = _mm256_sub_ps(top, low);
+void sobel_rows_stream_avx2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	SOBEL_PROBE(SobelIsa::kAvx2, SobelPath::kBand, width, lastRow - firstRow, bytesPerLineSrc, bytesPerLineDst);
 
-					xout = _mm256_sub_ps(RSHIFTM(currx, prevx), LSHIFTM(currx, nextx));
-					xout = _mm256_mul_ps(xout, xout);
-
-					out = _mm256_add_ps(_mm256_add_ps(curry, curry), _mm256_add_ps(RSHIFTM(curry, prevy), LSHIFTM(curry, nexty)));
-					out = _mm256_fmadd_ps(out, out, xout);
-
-					out = _mm256_mul_ps(_mm256_sqrt_ps(out), kScaleVec);
-
-					_mm256_store_ps(&dr[x - 8u], out);
-				}
-
-				for (; x < lx; ++x) {
-					const float dx =
-						1.0f * (pr[x + 1u] - pr[x - 1u]) +
-						2.0f * (cr[x + 1u] - cr[x - 1u]) +
-						1.0f * (nr[x + 1u] - nr[x - 1u]);
-
-					const float dy =
-						1.0f * (pr[x - 1u] - nr[x - 1u]) +
-						2.0f * (pr[x] - nr[x]) +
-						1.0f * (pr[x + 1u] - nr[x + 1u]);
-
-					dr[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				{
-					const float dx =
-						1.0f * (pr[lx] - pr[lx - 1u]) +
-						2.0f * (cr[lx] - cr[lx - 1u]) +
-						1.0f * (nr[lx] - nr[lx - 1u]);
-
-					const float dy =
-						1.0f * (pr[lx - 1u] - nr[lx - 1u]) +
-						2.0f * (pr[lx] - nr[lx]) +
-						1.0f * (pr[lx] - nr[lx]);
-
-					dr[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		} else if (width >= 8u) {
-			const uint32_t lx = width - 1u;
-
-			while (pr < lr) {
-				{
-					const __m256 top = _mm256_load_ps(pr);
-					const __m256 mid = _mm256_load_ps(cr);
-					const __m256 low = _mm256_load_ps(nr);
-
-					const __m256 currx = _mm256_add_ps(_mm256_add_ps(mid, mid), _mm256_add_ps(top, low));
-					const __m256 curry = _mm256_sub_ps(top, low);
+	engine_band<Avx2Float, Sobel3Kernel, EngineStream<Avx2Float> >(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+	_mm_sfence();
+}
 
-					__m256 xout = _mm256_sub_ps(RSHIFT(currx), LSHIFT(currx));
-					xout = _mm256_mul_ps(xout, xout);
+void sobel_row_avx2(const float* const* rows, float* out, uint32_t width) noexcept {
+	engine_stream_row<Avx2Float, Sobel3Kernel>(rows, out, width);
+}
 
-					__m256 out = _mm256_add_ps(_mm256_add_ps(curry, curry), _mm256_add_ps(RSHIFT(curry), LSHIFT(curry)));
-					out = _mm256_fmadd_ps(out, out, xout);
+void sobel_canny_rows_avx2(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept {
+	engine_canny<Avx2Float, Sobel3Kernel>(src, width, height, bytesPerLineSrc, firstRow, lastRow, low, high, scratch, strong, candidates, wordsPerLine);
+}
 
-					out = _mm256_mul_ps(_mm256_sqrt_ps(out), kScaleVec);
+void sobel_downsample_avx2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	engine_downsample<Avx2Float>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+}
 
-					_mm256_store_ps(dr, out);
-				}
+void sobel_temporal_sums_avx2(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept {
+	engine_temporal_sums<Avx2Float>(src, smooth, derivative, width, height, bytesPerLineSrc, bytesPerLineSums, firstRow, lastRow);
+}
 
-				for (uint32_t x = 7u; x < lx; ++x) {
-					const float dx =
-						1.0f * (pr[x + 1u] - pr[x - 1u]) +
-						2.0f * (cr[x + 1u] - cr[x - 1u]) +
-						1.0f * (nr[x + 1u] - nr[x - 1u]);
-
-					const float dy =
-						1.0f * (pr[x - 1u] - nr[x - 1u]) +
-						2.0f * (pr[x] - nr[x]) +
-						1.0f * (pr[x + 1u] - nr[x + 1u]);
-
-					dr[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				{
-					const float dx =
-						1.0f * (pr[lx] - pr[lx - 1u]) +
-						2.0f * (cr[lx] - cr[lx - 1u]) +
-						1.0f * (nr[lx] - nr[lx - 1u]);
-
-					const float dy =
-						1.0f * (pr[lx - 1u] - nr[lx - 1u]) +
-						2.0f * (pr[lx] - nr[lx]) +
-						1.0f * (pr[lx] - nr[lx]);
-
-					dr[lx] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		}
-	}
+void sobel_temporal_rows_avx2(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept {
+	float* const outputs[4] = { output->gx, output->gy, output->gt, output->magnitude };
+	engine_temporal<Avx2Float>(source->frames, source->smooth, source->derivative, source->store, source->bytesPerLine, source->bytesPerLineSums, outputs, output->bytesPerLine, width, height, firstRow, lastRow, scratch);
 }
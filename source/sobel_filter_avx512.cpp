@@ -9,323 +9,251 @@
  * - The authors reserve the rights to change the license agreements in future versions of the software
  */
 
-#include <cassert>
-#include <cmath>
 #include <cstdint>
 
 #include <immintrin.h> // Intel AVX-512
 
 #include "sobel_filter.h"
+#include "sobel_engine.h"
+#include "sobel_internal.h"
+#include "sobel_probe.h"
+
+// AVX-512 vector operations for the generic stencil engine
+struct Avx512Float {
+	typedef __m512 type;
+	typedef float value_type;
+
+	static constexpr uint32_t kWidth = 16u;
+
+	static inline type load(const float* ptr) noexcept { return _mm512_load_ps(ptr); }
+	static inline void store(float* ptr, type v) noexcept { _mm512_store_ps(ptr, v); }
+	static inline void stream(float* ptr, type v) noexcept { _mm512_stream_ps(ptr, v); }
+	static inline type set1(float v) noexcept { return _mm512_set1_ps(v); }
+	static inline type add(type a, type b) noexcept { return _mm512_add_ps(a, b); }
+	static inline type sub(type a, type b) noexcept { return _mm512_sub_ps(a, b); }
+	static inline type mul(type a, type b) noexcept { return _mm512_mul_ps(a, b); }
+	static inline type fmadd(type a, type b, type c) noexcept { return _mm512_fmadd_ps(a, b, c); }
+	static inline type sqrt(type v) noexcept { return _mm512_sqrt_ps(v); }
+	static inline type min(type a, type b) noexcept { return _mm512_min_ps(a, b); }
+	static inline type max(type a, type b) noexcept { return _mm512_max_ps(a, b); }
+
+	// Bit per lane where a > b
+	static inline uint32_t mask_greater(type a, type b) noexcept { return static_cast<uint32_t>(_mm512_cmp_ps_mask(a, b, _CMP_GT_OQ)); }
+
+	// Truncating conversion to 32 bit integers
+	static inline void store_int(int32_t* ptr, type v) noexcept { _mm512_store_si512(ptr, _mm512_cvttps_epi32(v)); }
+
+	// Horizontal reductions
+	static inline float reduce_add(type v) noexcept { return _mm512_reduce_add_ps(v); }
+	static inline float reduce_max(type v) noexcept { return _mm512_reduce_max_ps(v); }
+
+	// Sums of adjacent lane pairs, those of a in the low half and those of b in the high half
+	static inline type pairwise_add(type a, type b) noexcept {
+		const __m512i even = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
+		const __m512i odd = _mm512_set_epi32(31, 29, 27, 25, 23, 21, 19, 17, 15, 13, 11, 9, 7, 5, 3, 1);
+		return _mm512_add_ps(_mm512_permutex2var_ps(a, even, b), _mm512_permutex2var_ps(a, odd, b));
+	}
 
-#define RSHIFT(shift) _mm512_permutexvar_ps(kRightShiftVec, shift)
-#define LSHIFT(shift) _mm512_permutexvar_ps(kLeftShiftVec, shift)
-#define RSHIFTM(shift, merge) _mm512_mask_blend_ps(0b0000000000000001, RSHIFT(shift), _mm512_permutexvar_ps(kRightMergeVec, merge))
-#define LSHIFTM(shift, merge) _mm512_mask_blend_ps(0b1000000000000000, LSHIFT(shift), _mm512_permutexvar_ps(kLeftMergeVec, merge))
+	// Broadcast the first/last lane, used to replicate the left/right border
+	static inline type first(type v) noexcept { return _mm512_permutexvar_ps(_mm512_setzero_si512(), v); }
+	static inline type last(type v) noexcept { return _mm512_permutexvar_ps(_mm512_set1_epi32(15), v); }
 
-static constexpr uint32_t kSimdWidth = 16u;
-static constexpr uint32_t kByteAlign = kSimdWidth * sizeof(float);
-static constexpr uint32_t kMaskAlign = kByteAlign - 1u;
+	// Lanes shifted K steps towards higher/lower indices, filled from the neighboring block
+	template <uint32_t K>
+	static inline type shift_right(type curr, type prev) noexcept {
+		return _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(curr), _mm512_castps_si512(prev), 16 - K));
+	}
 
-alignas(64) static constexpr uint32_t kRightShift[16] = {  0,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14 };
-alignas(64) static constexpr uint32_t kLeftShift[16] = {  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 15 };
-alignas(64) static constexpr uint32_t kRightMerge[16] = { 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15 };
-alignas(64) static constexpr uint32_t kLeftMerge[16] = {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 };
+	template <uint32_t K>
+	static inline type shift_left(type curr, type next) noexcept {
+		return _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(next), _mm512_castps_si512(curr), K));
+	}
+};
 
-static const __m512i kRightShiftVec = _mm512_load_si512(reinterpret_cast<const __m512i*>(&kRightShift[0]));
-static const __m512i kLeftShiftVec = _mm512_load_si512(reinterpret_cast<const __m512i*>(&kLeftShift[0]));
-static const __m512i kRightMergeVec = _mm512_load_si512(reinterpret_cast<const __m512i*>(&kRightMerge[0]));
-static const __m512i kLeftMergeVec = _mm512_load_si512(reinterpret_cast<const __m512i*>(&kLeftMerge[0]));
+// Masked tail access, the lanes past the row end are neither read nor written
+template <>
+struct EngineTail<Avx512Float, EngineNative<Avx512Float> > {
+	static inline __mmask16 lanes(uint32_t count) noexcept { return static_cast<__mmask16>((1u << count) - 1u); }
 
-static const float kScaleFactor = 1.0f / sqrtf(32.0f);
-static const __m512 kScaleVec = _mm512_set1_ps(kScaleFactor);
+	static inline void stage(float* block, const float* row, uint32_t count) noexcept {
+		_mm512_store_ps(block, _mm512_mask_loadu_ps(_mm512_set1_ps(row[count - 1u]), lanes(count), row));
+	}
 
-static inline const float* offset_ptr(const void* ptr, uintptr_t byteOffset) noexcept {
-#ifdef _DEBUG
-	assert((reinterpret_cast<uintptr_t>(ptr) & kMaskAlign) == 0u);
-	assert((byteOffset & kMaskAlign) == 0u);
-#endif
-	const void* offsetPtr = &static_cast<const uint8_t*>(ptr)[byteOffset];
-	return static_cast<const float*>(offsetPtr);
-}
+	static inline void store(float* row, __m512 v, uint32_t count) noexcept {
+		_mm512_mask_storeu_ps(row, lanes(count), v);
+	}
+};
 
-static inline float* offset_ptr(void* ptr, uintptr_t byteOffset) noexcept {
-#ifdef _DEBUG
-	assert((reinterpret_cast<uintptr_t>(ptr) & kMaskAlign) == 0u);
-	assert((byteOffset & kMaskAlign) == 0u);
-#endif
-	void* offsetPtr = &static_cast<uint8_t*>(ptr)[byteOffset];
-	return static_cast<float*>(offsetPtr);
+static const SobelFixedKernel kFixedKernels[] = {
+	SOBEL_FIXED_SHAPES(Avx512Float)
+};
+
+SobelFixedFn sobel_fixed_avx512(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	return sobel_fixed_lookup(kFixedKernels, width, height, bytesPerLineSrc, bytesPerLineDst);
 }
 
 void sobel_filter_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
 #ifdef _DEBUG
-	// Verify 512 bit alignment
+	// Verify 512 bit alignment here, fixed shapes do not go through engine_filter
+	static constexpr uintptr_t kMaskAlign = Avx512Float::kWidth * sizeof(float) - 1u;
 	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
 	assert((reinterpret_cast<uintptr_t>(dst) & kMaskAlign) == 0u);
 	assert((bytesPerLineSrc & kMaskAlign) == 0u);
 	assert((bytesPerLineDst & kMaskAlign) == 0u);
-	// Verify minimum SIMD width
-	assert(width >= kSimdWidth);
 #endif
+	// Production shapes with dense rows run a compile-time specialization
+	const SobelFixedFn fixed = sobel_fixed_avx512(width, height, bytesPerLineSrc, bytesPerLineDst);
+	SOBEL_PROBE(SobelIsa::kAvx512, fixed != nullptr ? SobelPath::kFixed : sobel_path(width, Avx512Float::kWidth), width, height, bytesPerLineSrc, bytesPerLineDst);
 
-	const float* pr = src;
-	const float* cr = src;
-	const float* nr = offset_ptr(src, bytesPerLineSrc);
-	const float* lr = offset_ptr(src, (height - 1u) * static_cast<uintptr_t>(bytesPerLineSrc));
-
-	float* dr = dst;
-
-	if ((width & 15u) == 0u) {
-		if (width >= 32u) {
-			while (pr < lr) {
-				__m512 top = _mm512_load_ps(pr);
-				__m512 mid = _mm512_load_ps(cr);
-				__m512 low = _mm512_load_ps(nr);
-
-				__m512 currx = _mm512_add_ps(_mm512_add_ps(mid, mid), _mm512_add_ps(top, low));
-				__m512 curry = _mm512_sub_ps(top, low);
-
-				top = _mm512_load_ps(&pr[16u]);
-				mid = _mm512_load_ps(&cr[16u]);
-				low = _mm512_load_ps(&nr[16u]);
-
-				__m512 nextx = _mm512_add_ps(_mm512_add_ps(mid, mid), _mm512_add_ps(top, low));
-				__m512 nexty = _mm512_sub_ps(top, low);
-
-				__m512 xout = _mm512_sub_ps(RSHIFT(currx), LSHIFTM(currx, nextx));
-				xout = _mm512_mul_ps(xout, xout);
-
-				__m512 out = _mm512_add_ps(_mm512_add_ps(curry, curry), _mm512_add_ps(RSHIFT(curry), LSHIFTM(curry, nexty)));
-				out = _mm512_fmadd_ps(out, out, xout);
-
-				out = _mm512_mul_ps(_mm512_sqrt_ps(out), kScaleVec);
-
-				_mm512_store_ps(dr, out);
-
-				uint32_t x = 32u;
-
-				for (; x < width; x += 16u) {
-					const __m512 prevx = currx;
-					const __m512 prevy = curry;
-
-					currx = nextx;
-					curry = nexty;
-
-					top = _mm512_load_ps(&pr[x]);
-					mid = _mm512_load_ps(&cr[x]);
-					low = _mm512_load_ps(&nr[x]);
-
-					nextx = _mm512_add_ps(_mm512_add_ps(mid, mid), _mm512_add_ps(top, low));
-					nexty = _mm512_sub_ps(top, low);
-
-					xout = _mm512_sub_ps(RSHIFTM(currx, prevx), LSHIFTM(currx, nextx));
-					xout = _mm512_mul_ps(xout, xout);
-
-					out = _mm512_add_ps(_mm512_add_ps(curry, curry), _mm512_add_ps(RSHIFTM(curry, prevy), LSHIFTM(curry, nexty)));
-					out = _mm512_fmadd_ps(out, out, xout);
-
-					out = _mm512_mul_ps(_mm512_sqrt_ps(out), kScaleVec);
-
-					_mm512_store_ps(&dr[x - 16u], out);
-				}
+	if (fixed != nullptr) {
+		fixed(src, dst);
+		return;
+	}
 
-				xout = _mm512_sub_ps(RSHIFTM(nextx, currx), LSHIFT(nextx));
-				xout = _mm512_mul_ps(xout, xout);
+	engine_filter<Avx512Float, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				out = _mm512_add_ps(_mm512_add_ps(nexty, nexty), _mm512_add_ps(RSHIFTM(nexty, curry), LSHIFT(nexty)));
-				out = _mm512_fmadd_ps(out, out, xout);
+void scharr_filter_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx512Float, Scharr3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				out = _mm512_mul_ps(_mm512_sqrt_ps(out), kScaleVec);
+void sobel5_filter_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx512Float, Sobel5Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				_mm512_store_ps(&dr[x - 16u], out);
+void sobel7_filter_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx512Float, Sobel7Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		} else {
-			while (pr < lr) {
-				const __m512 top = _mm512_load_ps(pr);
-				const __m512 mid = _mm512_load_ps(cr);
-				const __m512 low = _mm512_load_ps(nr);
+struct Avx512Double {
+	typedef __m512d type;
+	typedef double value_type;
 
-				__m512 xout = _mm512_add_ps(_mm512_add_ps(mid, mid), _mm512_add_ps(top, low));
-				xout = _mm512_sub_ps(RSHIFT(xout), LSHIFT(xout));
-				xout = _mm512_mul_ps(xout, xout);
+	static constexpr uint32_t kWidth = 8u;
 
-				__m512 out = _mm512_sub_ps(top, low);
-				out = _mm512_add_ps(_mm512_add_ps(out, out), _mm512_add_ps(RSHIFT(out), LSHIFT(out)));
-				out = _mm512_fmadd_ps(out, out, xout);
+	static inline type load(const double* ptr) noexcept { return _mm512_load_pd(ptr); }
+	static inline void store(double* ptr, type v) noexcept { _mm512_store_pd(ptr, v); }
+	static inline type set1(double v) noexcept { return _mm512_set1_pd(v); }
+	static inline type add(type a, type b) noexcept { return _mm512_add_pd(a, b); }
+	static inline type sub(type a, type b) noexcept { return _mm512_sub_pd(a, b); }
+	static inline type mul(type a, type b) noexcept { return _mm512_mul_pd(a, b); }
+	static inline type fmadd(type a, type b, type c) noexcept { return _mm512_fmadd_pd(a, b, c); }
+	static inline type sqrt(type v) noexcept { return _mm512_sqrt_pd(v); }
 
-				out = _mm512_mul_ps(_mm512_sqrt_ps(out), kScaleVec);
+	static inline type first(type v) noexcept { return _mm512_permutexvar_pd(_mm512_setzero_si512(), v); }
+	static inline type last(type v) noexcept { return _mm512_permutexvar_pd(_mm512_set1_epi64(7), v); }
 
-				_mm512_store_ps(dr, out);
+	template <uint32_t K>
+	static inline type shift_right(type curr, type prev) noexcept {
+		return _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(curr), _mm512_castpd_si512(prev), 8 - K));
+	}
 
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		}
-	} else {
-		if (width >= 32u) {
-			const uint32_t count = 16u * (width / 16u);
-			const uint32_t lx = width - 1u;
+	template <uint32_t K>
+	static inline type shift_left(type curr, type next) noexcept {
+		return _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(next), _mm512_castpd_si512(curr), K));
+	}
+};
 
-			while (pr < lr) {
-				__m512 top = _mm512_load_ps(pr);
-				__m512 mid = _mm512_load_ps(cr);
-				__m512 low = _mm512_load_ps(nr);
+void sobel_filter_avx512(const double* __restrict src, double* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx512Double, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				__m512 currx = _mm512_add_ps(_mm512_add_ps(mid, mid), _mm512_add_ps(top, low));
-				__m512 curry = _mm512_sub_ps(top, low);
+// Half float storage
+struct Avx512Half {
+	typedef uint16_t storage_type;
 
-				top = _mm512_load_ps(&pr[16u]);
-				mid = _mm512_load_ps(&cr[16u]);
-				low = _mm512_load_ps(&nr[16u]);
+	static inline __m512 load(const uint16_t* ptr) noexcept {
+		return _mm512_cvtph_ps(_mm256_load_si256(reinterpret_cast<const __m256i*>(ptr)));
+	}
 
-				__m512 nextx = _mm512_add_ps(_mm512_add_ps(mid, mid), _mm512_add_ps(top, low));
-				__m512 nexty = _mm512_sub_ps(top, low);
+	static inline void store(uint16_t* ptr, __m512 v) noexcept {
+		_mm256_store_si256(reinterpret_cast<__m256i*>(ptr), _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+	}
+};
 
-				__m512 xout = _mm512_sub_ps(RSHIFT(currx), LSHIFTM(currx, nextx));
-				xout = _mm512_mul_ps(xout, xout);
+// 16 bit unsigned integer storage, rounded and saturated on store
+struct Avx512UInt16 {
+	typedef uint16_t storage_type;
 
-				__m512 out = _mm512_add_ps(_mm512_add_ps(curry, curry), _mm512_add_ps(RSHIFT(curry), LSHIFTM(curry, nexty)));
-				out = _mm512_fmadd_ps(out, out, xout);
+	static inline __m512 load(const uint16_t* ptr) noexcept {
+		return _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(ptr))));
+	}
 
-				out = _mm512_mul_ps(_mm512_sqrt_ps(out), kScaleVec);
+	static inline void store(uint16_t* ptr, __m512 v) noexcept {
+		const __m512i i = _mm512_cvtps_epi32(_mm512_min_ps(v, _mm512_set1_ps(65535.0f)));
+		_mm256_store_si256(reinterpret_cast<__m256i*>(ptr), _mm512_cvtusepi32_epi16(i));
+	}
+};
+
+template <typename L>
+static void format_filter_avx512(const void* src, void* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatDst) noexcept {
+	const typename L::storage_type* typedSrc = static_cast<const typename L::storage_type*>(src);
+
+	switch (formatDst) {
+	case SobelFormat::kFloat16:
+		engine_filter<Avx512Float, Sobel3Kernel, L, Avx512Half>(typedSrc, static_cast<uint16_t*>(dst), width, height, bytesPerLineSrc, bytesPerLineDst);
+		break;
+	case SobelFormat::kUInt16:
+		engine_filter<Avx512Float, Sobel3Kernel, L, Avx512UInt16>(typedSrc, static_cast<uint16_t*>(dst), width, height, bytesPerLineSrc, bytesPerLineDst);
+		break;
+	default:
+		engine_filter<Avx512Float, Sobel3Kernel, L>(typedSrc, static_cast<float*>(dst), width, height, bytesPerLineSrc, bytesPerLineDst);
+		break;
+	}
+}
 
-				_mm512_store_ps(dr, out);
+void sobel_filter_format_avx512(const void* __restrict src, void* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatSrc, SobelFormat formatDst) noexcept {
+	switch (formatSrc) {
+	case SobelFormat::kFloat16:
+		format_filter_avx512<Avx512Half>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, formatDst);
+		break;
+	case SobelFormat::kUInt16:
+		format_filter_avx512<Avx512UInt16>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, formatDst);
+		break;
+	default:
+		format_filter_avx512<EngineNative<Avx512Float> >(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, formatDst);
+		break;
+	}
+}
 
-				uint32_t x = 32u;
+void sobel_edge_mask_avx512(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept {
+	engine_mask<Avx512Float, Sobel3Kernel>(src, mask, width, height, bytesPerLineSrc, bytesPerLineMask, threshold);
+}
 
-				for (; x < count; x += 16u) {
-					const __m512 prevx = currx;
-					const __m512 prevy = curry;
+void sobel_filter_stats_avx512(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept {
+	engine_stats<Avx512Float, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, histogramMax, stats);
+}
 
-					currx = nextx;
-					curry = nexty;
+void sobel_rows_avx512(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	SOBEL_PROBE(SobelIsa::kAvx512, SobelPath::kBand, width, lastRow - firstRow, bytesPerLineSrc, bytesPerLineDst);
 
-					top = _mm512_load_ps(&pr[x]);
-					mid = _mm512_load_ps(&cr[x]);
-					low = _mm512_load_ps(&nr[x]);
+	engine_band<Avx512Float, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+}
 
-					nextx = _mm512_add_ps(_mm512_add_ps(mid, mid), _mm512_add_ps(top, low));
-					nexty = _mm512_sub_ps(top, low);
+void sobel_rows_stream_avx512(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	SOBEL_PROBE(SobelIsa::kAvx512, SobelPath::kBand, width, lastRow - firstRow, bytesPerLineSrc, bytesPerLineDst);
 
-					xout = _mm512_sub_ps(RSHIFTM(currx, prevx), LSHIFTM(currx, nextx));
-					xout = _mm512_mul_ps(xout, xout);
-
-					out = _mm512_add_ps(_mm512_add_ps(curry, curry), _mm512_add_ps(RSHIFTM(curry, prevy), LSHIFTM(curry, nexty)));
-					out = _mm512_fmadd_ps(out, out, xout);
-
-					out = _mm512_mul_ps(_mm512_sqrt_ps(out), kScaleVec);
-
-					_mm512_store_ps(&dr[x - 16u], out);
-				}
-
-				for (; x < lx; ++x) {
-					const float dx =
-						1.0f * (pr[x + 1u] - pr[x - 1u]) +
-						2.0f * (cr[x + 1u] - cr[x - 1u]) +
-						1.0f * (nr[x + 1u] - nr[x - 1u]);
-
-					const float dy =
-						1.0f * (pr[x - 1u] - nr[x - 1u]) +
-						2.0f * (pr[x] - nr[x]) +
-						1.0f * (pr[x + 1u] - nr[x + 1u]);
-
-					dr[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				{
-					const float dx =
-						1.0f * (pr[lx] - pr[lx - 1u]) +
-						2.0f * (cr[lx] - cr[lx - 1u]) +
-						1.0f * (nr[lx] - nr[lx - 1u]);
-
-					const float dy =
-						1.0f * (pr[lx - 1u] - nr[lx - 1u]) +
-						2.0f * (pr[lx] - nr[lx]) +
-						1.0f * (pr[lx] - nr[lx]);
-
-					dr[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		} else if (width >= 16u) {
-			const uint32_t lx = width - 1u;
-
-			while (pr < lr) {
-				{
-					const __m512 top = _mm512_load_ps(pr);
-					const __m512 mid = _mm512_load_ps(cr);
-					const __m512 low = _mm512_load_ps(nr);
-
-					const __m512 currx = _mm512_add_ps(_mm512_add_ps(mid, mid), _mm512_add_ps(top, low));
-					const __m512 curry = _mm512_sub_ps(top, low);
+	engine_band<Avx512Float, Sobel3Kernel, EngineStream<Avx512Float> >(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+	_mm_sfence();
+}
 
-					__m512 xout = _mm512_sub_ps(RSHIFT(currx), LSHIFT(currx));
-					xout = _mm512_mul_ps(xout, xout);
+void sobel_row_avx512(const float* const* rows, float* out, uint32_t width) noexcept {
+	engine_stream_row<Avx512Float, Sobel3Kernel>(rows, out, width);
+}
 
-					__m512 out = _mm512_add_ps(_mm512_add_ps(curry, curry), _mm512_add_ps(RSHIFT(curry), LSHIFT(curry)));
-					out = _mm512_fmadd_ps(out, out, xout);
+void sobel_canny_rows_avx512(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept {
+	engine_canny<Avx512Float, Sobel3Kernel>(src, width, height, bytesPerLineSrc, firstRow, lastRow, low, high, scratch, strong, candidates, wordsPerLine);
+}
 
-					out = _mm512_mul_ps(_mm512_sqrt_ps(out), kScaleVec);
+void sobel_downsample_avx512(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	engine_downsample<Avx512Float>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+}
 
-					_mm512_store_ps(dr, out);
-				}
+void sobel_temporal_sums_avx512(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept {
+	engine_temporal_sums<Avx512Float>(src, smooth, derivative, width, height, bytesPerLineSrc, bytesPerLineSums, firstRow, lastRow);
+}
 
-				for (uint32_t x = 15u; x < lx; ++x) {
-					const float dx =
-						1.0f * (pr[x + 1u] - pr[x - 1u]) +
-						2.0f * (cr[x + 1u] - cr[x - 1u]) +
-						1.0f * (nr[x + 1u] - nr[x - 1u]);
-
-					const float dy =
-						1.0f * (pr[x - 1u] - nr[x - 1u]) +
-						2.0f * (pr[x] - nr[x]) +
-						1.0f * (pr[x + 1u] - nr[x + 1u]);
-
-					dr[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				{
-					const float dx =
-						1.0f * (pr[lx] - pr[lx - 1u]) +
-						2.0f * (cr[lx] - cr[lx - 1u]) +
-						1.0f * (nr[lx] - nr[lx - 1u]);
-
-					const float dy =
-						1.0f * (pr[lx - 1u] - nr[lx - 1u]) +
-						2.0f * (pr[lx] - nr[lx]) +
-						1.0f * (pr[lx] - nr[lx]);
-
-					dr[lx] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		}
-	}
+void sobel_temporal_rows_avx512(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept {
+	float* const outputs[4] = { output->gx, output->gy, output->gt, output->magnitude };
+	engine_temporal<Avx512Float>(source->frames, source->smooth, source->derivative, source->store, source->bytesPerLine, source->bytesPerLineSums, outputs, output->bytesPerLine, width, height, firstRow, lastRow, scratch);
 }
@@ -0,0 +1,183 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <cstdint>
+
+#include <immintrin.h> // Intel AVX-512VL
+
+#include "sobel_filter.h"
+#include "sobel_engine.h"
+#include "sobel_internal.h"
+#include "sobel_probe.h"
+
+// AVX-512VL vector operations on ymm registers. The opmask compares, masked tails
+// and two-source permutes of AVX-512 are used at 256 bits, which keeps the core out
+// of the lower frequency licence that sustained zmm arithmetic requests.
+struct Avx512VlFloat {
+	typedef __m256 type;
+	typedef float value_type;
+
+	static constexpr uint32_t kWidth = 8u;
+
+	static inline type load(const float* ptr) noexcept { return _mm256_load_ps(ptr); }
+	static inline void store(float* ptr, type v) noexcept { _mm256_store_ps(ptr, v); }
+	static inline void stream(float* ptr, type v) noexcept { _mm256_stream_ps(ptr, v); }
+	static inline type set1(float v) noexcept { return _mm256_set1_ps(v); }
+	static inline type add(type a, type b) noexcept { return _mm256_add_ps(a, b); }
+	static inline type sub(type a, type b) noexcept { return _mm256_sub_ps(a, b); }
+	static inline type mul(type a, type b) noexcept { return _mm256_mul_ps(a, b); }
+	static inline type fmadd(type a, type b, type c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+	static inline type sqrt(type v) noexcept { return _mm256_sqrt_ps(v); }
+	static inline type min(type a, type b) noexcept { return _mm256_min_ps(a, b); }
+	static inline type max(type a, type b) noexcept { return _mm256_max_ps(a, b); }
+
+	// Bit per lane where a > b
+	static inline uint32_t mask_greater(type a, type b) noexcept { return static_cast<uint32_t>(_mm256_cmp_ps_mask(a, b, _CMP_GT_OQ)); }
+
+	// Truncating conversion to 32 bit integers
+	static inline void store_int(int32_t* ptr, type v) noexcept { _mm256_store_si256(reinterpret_cast<__m256i*>(ptr), _mm256_cvttps_epi32(v)); }
+
+	// Horizontal reductions
+	static inline float reduce_add(type v) noexcept {
+		__m128 r = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		r = _mm_add_ps(r, _mm_movehl_ps(r, r));
+		return _mm_cvtss_f32(_mm_add_ss(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
+
+	static inline float reduce_max(type v) noexcept {
+		__m128 r = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		r = _mm_max_ps(r, _mm_movehl_ps(r, r));
+		return _mm_cvtss_f32(_mm_max_ss(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
+
+	// Sums of adjacent lane pairs, those of a in the low half and those of b in the high half
+	static inline type pairwise_add(type a, type b) noexcept {
+		const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+		const __m256i odd = _mm256_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15);
+		return _mm256_add_ps(_mm256_permutex2var_ps(a, even, b), _mm256_permutex2var_ps(a, odd, b));
+	}
+
+	// Broadcast the first/last lane, used to replicate the left/right border
+	static inline type first(type v) noexcept { return _mm256_permutexvar_ps(_mm256_setzero_si256(), v); }
+	static inline type last(type v) noexcept { return _mm256_permutexvar_ps(_mm256_set1_epi32(7), v); }
+
+	// Lanes shifted K steps towards higher/lower indices, filled from the neighboring block.
+	// One vpermt2ps merges both blocks across the 128 bit lane boundary: indices 8 and up
+	// select from the second source.
+	template <uint32_t K>
+	static inline type shift_right(type curr, type prev) noexcept {
+		const __m256i index = _mm256_setr_epi32(8 - K, 9 - K, 10 - K, 11 - K, 12 - K, 13 - K, 14 - K, 15 - K);
+		return _mm256_permutex2var_ps(prev, index, curr);
+	}
+
+	template <uint32_t K>
+	static inline type shift_left(type curr, type next) noexcept {
+		const __m256i index = _mm256_setr_epi32(K, 1 + K, 2 + K, 3 + K, 4 + K, 5 + K, 6 + K, 7 + K);
+		return _mm256_permutex2var_ps(curr, index, next);
+	}
+};
+
+// Masked tail access, the lanes past the row end are neither read nor written
+template <>
+struct EngineTail<Avx512VlFloat, EngineNative<Avx512VlFloat> > {
+	static inline __mmask8 lanes(uint32_t count) noexcept { return static_cast<__mmask8>((1u << count) - 1u); }
+
+	static inline void stage(float* block, const float* row, uint32_t count) noexcept {
+		_mm256_store_ps(block, _mm256_mask_loadu_ps(_mm256_set1_ps(row[count - 1u]), lanes(count), row));
+	}
+
+	static inline void store(float* row, __m256 v, uint32_t count) noexcept {
+		_mm256_mask_storeu_ps(row, lanes(count), v);
+	}
+};
+
+static const SobelFixedKernel kFixedKernels[] = {
+	SOBEL_FIXED_SHAPES(Avx512VlFloat)
+};
+
+SobelFixedFn sobel_fixed_avx512vl(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	return sobel_fixed_lookup(kFixedKernels, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
+
+void sobel_filter_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+#ifdef _DEBUG
+	// Verify 256 bit alignment here, fixed shapes do not go through engine_filter
+	static constexpr uintptr_t kMaskAlign = Avx512VlFloat::kWidth * sizeof(float) - 1u;
+	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
+	assert((reinterpret_cast<uintptr_t>(dst) & kMaskAlign) == 0u);
+	assert((bytesPerLineSrc & kMaskAlign) == 0u);
+	assert((bytesPerLineDst & kMaskAlign) == 0u);
+#endif
+	// Production shapes with dense rows run a compile-time specialization
+	const SobelFixedFn fixed = sobel_fixed_avx512vl(width, height, bytesPerLineSrc, bytesPerLineDst);
+	SOBEL_PROBE(SobelIsa::kAvx512Vl, fixed != nullptr ? SobelPath::kFixed : sobel_path(width, Avx512VlFloat::kWidth), width, height, bytesPerLineSrc, bytesPerLineDst);
+
+	if (fixed != nullptr) {
+		fixed(src, dst);
+		return;
+	}
+
+	engine_filter<Avx512VlFloat, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
+
+void scharr_filter_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx512VlFloat, Scharr3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
+
+void sobel5_filter_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx512VlFloat, Sobel5Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
+
+void sobel7_filter_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Avx512VlFloat, Sobel7Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
+
+void sobel_edge_mask_avx512vl(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept {
+	engine_mask<Avx512VlFloat, Sobel3Kernel>(src, mask, width, height, bytesPerLineSrc, bytesPerLineMask, threshold);
+}
+
+void sobel_filter_stats_avx512vl(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept {
+	engine_stats<Avx512VlFloat, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, histogramMax, stats);
+}
+
+void sobel_rows_avx512vl(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	SOBEL_PROBE(SobelIsa::kAvx512Vl, SobelPath::kBand, width, lastRow - firstRow, bytesPerLineSrc, bytesPerLineDst);
+
+	engine_band<Avx512VlFloat, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+}
+
+void sobel_rows_stream_avx512vl(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	SOBEL_PROBE(SobelIsa::kAvx512Vl, SobelPath::kBand, width, lastRow - firstRow, bytesPerLineSrc, bytesPerLineDst);
+
+	engine_band<Avx512VlFloat, Sobel3Kernel, EngineStream<Avx512VlFloat> >(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+	_mm_sfence();
+}
+
+void sobel_row_avx512vl(const float* const* rows, float* out, uint32_t width) noexcept {
+	engine_stream_row<Avx512VlFloat, Sobel3Kernel>(rows, out, width);
+}
+
+void sobel_canny_rows_avx512vl(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept {
+	engine_canny<Avx512VlFloat, Sobel3Kernel>(src, width, height, bytesPerLineSrc, firstRow, lastRow, low, high, scratch, strong, candidates, wordsPerLine);
+}
+
+void sobel_downsample_avx512vl(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	engine_downsample<Avx512VlFloat>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+}
+
+void sobel_temporal_sums_avx512vl(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept {
+	engine_temporal_sums<Avx512VlFloat>(src, smooth, derivative, width, height, bytesPerLineSrc, bytesPerLineSums, firstRow, lastRow);
+}
+
+void sobel_temporal_rows_avx512vl(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept {
+	float* const outputs[4] = { output->gx, output->gy, output->gt, output->magnitude };
+	engine_temporal<Avx512VlFloat>(source->frames, source->smooth, source->derivative, source->store, source->bytesPerLine, source->bytesPerLineSums, outputs, output->bytesPerLine, width, height, firstRow, lastRow, scratch);
+}
@@ -9,315 +9,186 @@
  * - The authors reserve the rights to change the license agreements in future versions of the software
  */
 
-#include <cassert>
-#include <cmath>
 #include <cstdint>
 
 #include <emmintrin.h> // Intel SSE2
 
 #include "sobel_filter.h"
+#include "sobel_engine.h"
+#include "sobel_internal.h"
+#include "sobel_probe.h"
+
+// SSE2 vector operations for the generic stencil engine
+struct Sse2Float {
+	typedef __m128 type;
+	typedef float value_type;
+
+	static constexpr uint32_t kWidth = 4u;
+
+	static inline type load(const float* ptr) noexcept { return _mm_load_ps(ptr); }
+	static inline void store(float* ptr, type v) noexcept { _mm_store_ps(ptr, v); }
+	static inline void stream(float* ptr, type v) noexcept { _mm_stream_ps(ptr, v); }
+	static inline type set1(float v) noexcept { return _mm_set1_ps(v); }
+	static inline type add(type a, type b) noexcept { return _mm_add_ps(a, b); }
+	static inline type sub(type a, type b) noexcept { return _mm_sub_ps(a, b); }
+	static inline type mul(type a, type b) noexcept { return _mm_mul_ps(a, b); }
+	static inline type fmadd(type a, type b, type c) noexcept { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static inline type sqrt(type v) noexcept { return _mm_sqrt_ps(v); }
+	static inline type min(type a, type b) noexcept { return _mm_min_ps(a, b); }
+	static inline type max(type a, type b) noexcept { return _mm_max_ps(a, b); }
+
+	// Bit per lane where a > b
+	static inline uint32_t mask_greater(type a, type b) noexcept { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpgt_ps(a, b))); }
+
+	// Truncating conversion to 32 bit integers
+	static inline void store_int(int32_t* ptr, type v) noexcept { _mm_store_si128(reinterpret_cast<__m128i*>(ptr), _mm_cvttps_epi32(v)); }
+
+	// Horizontal reductions
+	static inline float reduce_add(type v) noexcept {
+		v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
 
-#define RSHIFT(shift) _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(shift), 4))
-#define LSHIFT(shift) _mm_castsi128_ps(_mm_srli_si128(_mm_castps_si128(shift), 4))
-#define RSHIFTM(shift, merge) _mm_or_ps(RSHIFT(shift), _mm_castsi128_ps(_mm_srli_si128(_mm_castps_si128(merge), 12)))
-#define LSHIFTM(shift, merge) _mm_or_ps(LSHIFT(shift), _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(merge), 12)))
+	static inline float reduce_max(type v) noexcept {
+		v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+		return _mm_cvtss_f32(_mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
 
-static constexpr uint32_t kSimdWidth = 4u;
-static constexpr uint32_t kByteAlign = kSimdWidth * sizeof(float);
-static constexpr uint32_t kMaskAlign = kByteAlign - 1u;
+	// Sums of adjacent lane pairs, those of a in the low half and those of b in the high half
+	static inline type pairwise_add(type a, type b) noexcept {
+		return _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
 
-static const float kScaleFactor = 1.0f / sqrtf(32.0f);
-static const __m128 kScaleVec = _mm_set1_ps(kScaleFactor);
+	// Broadcast the first/last lane, used to replicate the left/right border
+	static inline type first(type v) noexcept { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)); }
+	static inline type last(type v) noexcept { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
 
-static inline const float* offset_ptr(const void* ptr, uintptr_t byteOffset) noexcept {
-#ifdef _DEBUG
-	assert((reinterpret_cast<uintptr_t>(ptr) & kMaskAlign) == 0u);
-	assert((byteOffset & kMaskAlign) == 0u);
-#endif
-	const void* offsetPtr = &static_cast<const uint8_t*>(ptr)[byteOffset];
-	return static_cast<const float*>(offsetPtr);
-}
+	// Lanes shifted K steps towards higher/lower indices, filled from the neighboring block
+	template <uint32_t K>
+	static inline type shift_right(type curr, type prev) noexcept {
+		return _mm_or_ps(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(curr), 4 * K)), _mm_castsi128_ps(_mm_srli_si128(_mm_castps_si128(prev), 16 - 4 * K)));
+	}
 
-static inline float* offset_ptr(void* ptr, uintptr_t byteOffset) noexcept {
-#ifdef _DEBUG
-	assert((reinterpret_cast<uintptr_t>(ptr) & kMaskAlign) == 0u);
-	assert((byteOffset & kMaskAlign) == 0u);
-#endif
-	void* offsetPtr = &static_cast<uint8_t*>(ptr)[byteOffset];
-	return static_cast<float*>(offsetPtr);
+	template <uint32_t K>
+	static inline type shift_left(type curr, type next) noexcept {
+		return _mm_or_ps(_mm_castsi128_ps(_mm_srli_si128(_mm_castps_si128(curr), 4 * K)), _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(next), 16 - 4 * K)));
+	}
+};
+
+static const SobelFixedKernel kFixedKernels[] = {
+	SOBEL_FIXED_SHAPES(Sse2Float)
+};
+
+SobelFixedFn sobel_fixed_sse2(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	return sobel_fixed_lookup(kFixedKernels, width, height, bytesPerLineSrc, bytesPerLineDst);
 }
 
 void sobel_filter_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
 #ifdef _DEBUG
-	// Verify 128 bit alignment
+	// Verify 128 bit alignment here, fixed shapes do not go through engine_filter
+	static constexpr uintptr_t kMaskAlign = Sse2Float::kWidth * sizeof(float) - 1u;
 	assert((reinterpret_cast<uintptr_t>(src) & kMaskAlign) == 0u);
 	assert((reinterpret_cast<uintptr_t>(dst) & kMaskAlign) == 0u);
 	assert((bytesPerLineSrc & kMaskAlign) == 0u);
 	assert((bytesPerLineDst & kMaskAlign) == 0u);
-	// Verify minimum SIMD width
-	assert(width >= kSimdWidth);
 #endif
+	// Production shapes with dense rows run a compile-time specialization
+	const SobelFixedFn fixed = sobel_fixed_sse2(width, height, bytesPerLineSrc, bytesPerLineDst);
+	SOBEL_PROBE(SobelIsa::kSse2, fixed != nullptr ? SobelPath::kFixed : sobel_path(width, Sse2Float::kWidth), width, height, bytesPerLineSrc, bytesPerLineDst);
 
-	const float* pr = src;
-	const float* cr = src;
-	const float* nr = offset_ptr(src, bytesPerLineSrc);
-	const float* lr = offset_ptr(src, (height - 1u) * static_cast<uintptr_t>(bytesPerLineSrc));
-
-	float* dr = dst;
-
-	if ((width & 3u) == 0u) {
-		if (width >= 8u) {
-			while (pr < lr) {
-				__m128 top = _mm_load_ps(pr);
-				__m128 mid = _mm_load_ps(cr);
-				__m128 low = _mm_load_ps(nr);
-
-				__m128 currx = _mm_add_ps(_mm_add_ps(mid, mid), _mm_add_ps(top, low));
-				__m128 curry = _mm_sub_ps(top, low);
-
-				top = _mm_load_ps(&pr[4u]);
-				mid = _mm_load_ps(&cr[4u]);
-				low = _mm_load_ps(&nr[4u]);
-
-				__m128 nextx = _mm_add_ps(_mm_add_ps(mid, mid), _mm_add_ps(top, low));
-				__m128 nexty = _mm_sub_ps(top, low);
-
-				__m128 xout = _mm_sub_ps(RSHIFT(currx), LSHIFTM(currx, nextx));
-				xout = _mm_mul_ps(xout, xout);
-
-				__m128 out = _mm_add_ps(_mm_add_ps(curry, curry), _mm_add_ps(RSHIFT(curry), LSHIFTM(curry, nexty)));
-				out = _mm_mul_ps(out, out);
-				out = _mm_add_ps(out, xout);
-
-				out = _mm_mul_ps(_mm_sqrt_ps(out), kScaleVec);
-
-				_mm_store_ps(dr, out);
-
-				uint32_t x = 8u;
-
-				for (; x < width; x += 4u) {
-					const __m128 prevx = currx;
-					const __m128 prevy = curry;
-
-					currx = nextx;
-					curry = nexty;
-
-					top = _mm_load_ps(&pr[x]);
-					mid = _mm_load_ps(&cr[x]);
-					low = _mm_load_ps(&nr[x]);
-
-					nextx = _mm_add_ps(_mm_add_ps(mid, mid), _mm_add_ps(top, low));
-					nexty = _mm_sub_ps(top, low);
-
-					xout = _mm_sub_ps(RSHIFTM(currx, prevx), LSHIFTM(currx, nextx));
-					xout = _mm_mul_ps(xout, xout);
-
-					out = _mm_add_ps(_mm_add_ps(curry, curry), _mm_add_ps(RSHIFTM(curry, prevy), LSHIFTM(curry, nexty)));
-					out = _mm_mul_ps(out, out);
-					out = _mm_add_ps(out, xout);
-
-					out = _mm_mul_ps(_mm_sqrt_ps(out), kScaleVec);
-
-					_mm_store_ps(&dr[x - 4u], out);
-				}
-
-				xout = _mm_sub_ps(RSHIFTM(nextx, currx), LSHIFT(nextx));
-				xout = _mm_mul_ps(xout, xout);
-
-				out = _mm_add_ps(_mm_add_ps(nexty, nexty), _mm_add_ps(RSHIFTM(nexty, curry), LSHIFT(nexty)));
-				out = _mm_add_ps(_mm_mul_ps(out, out), xout);
-
-				out = _mm_mul_ps(_mm_sqrt_ps(out), kScaleVec);
-
-				_mm_store_ps(&dr[x - 4u], out);
-
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		} else {
-			while (pr < lr) {
-				const __m128 top = _mm_load_ps(pr);
-				const __m128 mid = _mm_load_ps(cr);
-				const __m128 low = _mm_load_ps(nr);
-
-				__m128 xout = _mm_add_ps(_mm_add_ps(mid, mid), _mm_add_ps(top, low));
-				xout = _mm_sub_ps(RSHIFT(xout), LSHIFT(xout));
-				xout = _mm_mul_ps(xout, xout);
-
-				__m128 out = _mm_sub_ps(top, low);
-				out = _mm_add_ps(_mm_add_ps(out, out), _mm_add_ps(RSHIFT(out), LSHIFT(out)));
-				out = _mm_add_ps(_mm_mul_ps(out, out), xout);
+	if (fixed != nullptr) {
+		fixed(src, dst);
+		return;
+	}
 
-				out = _mm_mul_ps(_mm_sqrt_ps(out), kScaleVec);
+	engine_filter<Sse2Float, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				_mm_store_ps(dr, out);
+void scharr_filter_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Sse2Float, Scharr3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		}
-	} else {
-		if (width >= 8u) {
-			const uint32_t count = 4u * (width / 4u);
-			const uint32_t lx = width - 1u;
+void sobel5_filter_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Sse2Float, Sobel5Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-			while (pr < lr) {
-				__m128 top = _mm_load_ps(pr);
-				__m128 mid = _mm_load_ps(cr);
-				__m128 low = _mm_load_ps(nr);
+void sobel7_filter_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Sse2Float, Sobel7Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				__m128 currx = _mm_add_ps(_mm_add_ps(mid, mid), _mm_add_ps(top, low));
-				__m128 curry = _mm_sub_ps(top, low);
+struct Sse2Double {
+	typedef __m128d type;
+	typedef double value_type;
 
-				top = _mm_load_ps(&pr[4u]);
-				mid = _mm_load_ps(&cr[4u]);
-				low = _mm_load_ps(&nr[4u]);
+	static constexpr uint32_t kWidth = 2u;
 
-				__m128 nextx = _mm_add_ps(_mm_add_ps(mid, mid), _mm_add_ps(top, low));
-				__m128 nexty = _mm_sub_ps(top, low);
+	static inline type load(const double* ptr) noexcept { return _mm_load_pd(ptr); }
+	static inline void store(double* ptr, type v) noexcept { _mm_store_pd(ptr, v); }
+	static inline type set1(double v) noexcept { return _mm_set1_pd(v); }
+	static inline type add(type a, type b) noexcept { return _mm_add_pd(a, b); }
+	static inline type sub(type a, type b) noexcept { return _mm_sub_pd(a, b); }
+	static inline type mul(type a, type b) noexcept { return _mm_mul_pd(a, b); }
+	static inline type fmadd(type a, type b, type c) noexcept { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+	static inline type sqrt(type v) noexcept { return _mm_sqrt_pd(v); }
 
-				__m128 xout = _mm_sub_ps(RSHIFT(currx), LSHIFTM(currx, nextx));
-				xout = _mm_mul_ps(xout, xout);
+	static inline type first(type v) noexcept { return _mm_unpacklo_pd(v, v); }
+	static inline type last(type v) noexcept { return _mm_unpackhi_pd(v, v); }
 
-				__m128 out = _mm_add_ps(_mm_add_ps(curry, curry), _mm_add_ps(RSHIFT(curry), LSHIFTM(curry, nexty)));
-				out = _mm_add_ps(_mm_mul_ps(out, out), xout);
+	template <uint32_t K>
+	static inline type shift_right(type curr, type prev) noexcept {
+		static_assert(K == 1u, "two lane shift is limited to one lane");
+		return _mm_shuffle_pd(prev, curr, 0b01);
+	}
 
-				out = _mm_mul_ps(_mm_sqrt_ps(out), kScaleVec);
+	template <uint32_t K>
+	static inline type shift_left(type curr, type next) noexcept {
+		static_assert(K == 1u, "two lane shift is limited to one lane");
+		return _mm_shuffle_pd(curr, next, 0b01);
+	}
+};
 
-				_mm_store_ps(dr, out);
+void sobel_filter_sse2(const double* __restrict src, double* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	engine_filter<Sse2Double, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
 
-				uint32_t x = 8u;
+void sobel_edge_mask_sse2(const float* __restrict src, uint8_t* __restrict mask, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineMask, float threshold) noexcept {
+	engine_mask<Sse2Float, Sobel3Kernel>(src, mask, width, height, bytesPerLineSrc, bytesPerLineMask, threshold);
+}
 
-				for (; x < count; x += 4u) {
-					const __m128 prevx = currx;
-					const __m128 prevy = curry;
+void sobel_filter_stats_sse2(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, float histogramMax, SobelStats* stats) noexcept {
+	engine_stats<Sse2Float, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, histogramMax, stats);
+}
 
-					currx = nextx;
-					curry = nexty;
+void sobel_rows_sse2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	SOBEL_PROBE(SobelIsa::kSse2, SobelPath::kBand, width, lastRow - firstRow, bytesPerLineSrc, bytesPerLineDst);
 
-					top = _mm_load_ps(&pr[x]);
-					mid = _mm_load_ps(&cr[x]);
-					low = _mm_load_ps(&nr[x]);
+	engine_band<Sse2Float, Sobel3Kernel>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+}
 
-					nextx = _mm_add_ps(_mm_add_ps(mid, mid), _mm_add_ps(top, low));
-					nexty = _mm_sub_ps(top, low);
+void sobel_rows_stream_sse2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	SOBEL_PROBE(SobelIsa::kSse2, SobelPath::kBand, width, lastRow - firstRow, bytesPerLineSrc, bytesPerLineDst);
 
-					xout = _mm_sub_ps(RSHIFTM(currx, prevx), LSHIFTM(currx, nextx));
-					xout = _mm_mul_ps(xout, xout);
-
-					out = _mm_add_ps(_mm_add_ps(curry, curry), _mm_add_ps(RSHIFTM(curry, prevy), LSHIFTM(curry, nexty)));
-					out = _mm_add_ps(_mm_mul_ps(out, out), xout);
-
-					out = _mm_mul_ps(_mm_sqrt_ps(out), kScaleVec);
-
-					_mm_store_ps(&dr[x - 4u], out);
-				}
-
-				for (; x < lx; ++x) {
-					const float dx =
-						1.0f * (pr[x + 1u] - pr[x - 1u]) +
-						2.0f * (cr[x + 1u] - cr[x - 1u]) +
-						1.0f * (nr[x + 1u] - nr[x - 1u]);
-
-					const float dy =
-						1.0f * (pr[x - 1u] - nr[x - 1u]) +
-						2.0f * (pr[x] - nr[x]) +
-						1.0f * (pr[x + 1u] - nr[x + 1u]);
-
-					dr[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				{
-					const float dx =
-						1.0f * (pr[lx] - pr[lx - 1u]) +
-						2.0f * (cr[lx] - cr[lx - 1u]) +
-						1.0f * (nr[lx] - nr[lx - 1u]);
-
-					const float dy =
-						1.0f * (pr[lx - 1u] - nr[lx - 1u]) +
-						2.0f * (pr[lx] - nr[lx]) +
-						1.0f * (pr[lx] - nr[lx]);
-
-					dr[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		} else {
-			const uint32_t lx = width - 1u;
-
-			while (pr < lr) {
-				{
-					const __m128 top = _mm_load_ps(pr);
-					const __m128 mid = _mm_load_ps(cr);
-					const __m128 low = _mm_load_ps(nr);
-
-					const __m128 currx = _mm_add_ps(_mm_add_ps(mid, mid), _mm_add_ps(top, low));
-					const __m128 curry = _mm_sub_ps(top, low);
+	engine_band<Sse2Float, Sobel3Kernel, EngineStream<Sse2Float> >(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+	_mm_sfence();
+}
 
-					__m128 xout = _mm_sub_ps(RSHIFT(currx), LSHIFT(currx));
-					xout = _mm_mul_ps(xout, xout);
+void sobel_row_sse2(const float* const* rows, float* out, uint32_t width) noexcept {
+	engine_stream_row<Sse2Float, Sobel3Kernel>(rows, out, width);
+}
 
-					__m128 out = _mm_add_ps(_mm_add_ps(curry, curry), _mm_add_ps(RSHIFT(curry), LSHIFT(curry)));
-					out = _mm_add_ps(_mm_mul_ps(out, out), xout);
+void sobel_canny_rows_sse2(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept {
+	engine_canny<Sse2Float, Sobel3Kernel>(src, width, height, bytesPerLineSrc, firstRow, lastRow, low, high, scratch, strong, candidates, wordsPerLine);
+}
 
-					out = _mm_mul_ps(_mm_sqrt_ps(out), kScaleVec);
+void sobel_downsample_sse2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept {
+	engine_downsample<Sse2Float>(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, lastRow);
+}
 
-					_mm_store_ps(dr, out);
-				}
+void sobel_temporal_sums_sse2(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept {
+	engine_temporal_sums<Sse2Float>(src, smooth, derivative, width, height, bytesPerLineSrc, bytesPerLineSums, firstRow, lastRow);
+}
 
-				for (uint32_t x = 3u; x < lx; ++x) {
-					const float dx =
-						1.0f * (pr[x + 1u] - pr[x - 1u]) +
-						2.0f * (cr[x + 1u] - cr[x - 1u]) +
-						1.0f * (nr[x + 1u] - nr[x - 1u]);
-
-					const float dy =
-						1.0f * (pr[x - 1u] - nr[x - 1u]) +
-						2.0f * (pr[x] - nr[x]) +
-						1.0f * (pr[x + 1u] - nr[x + 1u]);
-
-					dr[x] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				{
-					const float dx =
-						1.0f * (pr[lx] - pr[lx - 1u]) +
-						2.0f * (cr[lx] - cr[lx - 1u]) +
-						1.0f * (nr[lx] - nr[lx - 1u]);
-
-					const float dy =
-						1.0f * (pr[lx - 1u] - nr[lx - 1u]) +
-						2.0f * (pr[lx] - nr[lx]) +
-						1.0f * (pr[lx] - nr[lx]);
-
-					dr[lx] = sqrtf(dx * dx + dy * dy) * kScaleFactor;
-				}
-
-				pr = cr;
-				cr = nr;
-				nr = offset_ptr(nr, bytesPerLineSrc);
-				if (nr > lr) {
-					nr = lr;
-				}
-				dr = offset_ptr(dr, bytesPerLineDst);
-			}
-		}
-	}
+void sobel_temporal_rows_sse2(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept {
+	float* const outputs[4] = { output->gx, output->gy, output->gt, output->magnitude };
+	engine_temporal<Sse2Float>(source->frames, source->smooth, source->derivative, source->store, source->bytesPerLine, source->bytesPerLineSums, outputs, output->bytesPerLine, width, height, firstRow, lastRow, scratch);
 }
@@ -0,0 +1,234 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "sobel_instrument.h"
+#include "sobel_probe.h"
+
+#if SOBEL_INSTRUMENTATION
+
+#include <atomic>
+#include <chrono>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static constexpr uint32_t kIsaCount = 5u;
+static constexpr uint32_t kPathCount = static_cast<uint32_t>(SobelPath::kCount);
+
+struct AtomicCounters {
+	std::atomic<uint64_t> calls;
+	std::atomic<uint64_t> paddedCalls;
+	std::atomic<uint64_t> pixels;
+	std::atomic<uint64_t> bytes;
+	std::atomic<uint64_t> nanoseconds;
+	std::atomic<uint64_t> cycles;
+	std::atomic<uint64_t> instructions;
+	std::atomic<uint64_t> llcMisses;
+};
+
+// Zero initialized as static storage
+static AtomicCounters gCounters[kIsaCount][kPathCount];
+static std::atomic<bool> gHardwareCounters;
+
+static inline uint64_t now_ns() noexcept {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+#if defined(__linux__)
+
+// Cycles, instructions and last level cache misses of the calling thread in user space, read as one group
+class PerfGroup {
+public:
+	PerfGroup() noexcept {
+		static const uint64_t kConfigs[3] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES };
+
+		for (uint32_t i = 0u; i < 3u; ++i) {
+			fds[i] = -1;
+		}
+
+		for (uint32_t i = 0u; i < 3u; ++i) {
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = kConfigs[i];
+			attr.disabled = i == 0u ? 1u : 0u;
+			attr.exclude_kernel = 1u;
+			attr.exclude_hv = 1u;
+			attr.read_format = PERF_FORMAT_GROUP;
+
+			fds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, i == 0u ? -1 : fds[0], 0ul));
+			if (fds[i] < 0) {
+				close_all();
+				return;
+			}
+		}
+
+		ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		gHardwareCounters = true;
+	}
+
+	~PerfGroup() {
+		close_all();
+	}
+
+	bool sample(uint64_t values[3]) const noexcept {
+		struct {
+			uint64_t count;
+			uint64_t values[3];
+		} group;
+
+		if (fds[0] < 0 || read(fds[0], &group, sizeof(group)) != static_cast<ssize_t>(sizeof(group)) || group.count != 3u) {
+			return false;
+		}
+
+		memcpy(values, group.values, sizeof(group.values));
+		return true;
+	}
+
+private:
+	void close_all() noexcept {
+		for (uint32_t i = 0u; i < 3u; ++i) {
+			if (fds[i] >= 0) {
+				close(fds[i]);
+				fds[i] = -1;
+			}
+		}
+	}
+
+	int fds[3];
+};
+
+static bool sample_hardware(uint64_t values[3]) noexcept {
+	static thread_local PerfGroup group;
+	return group.sample(values);
+}
+
+#else
+
+static bool sample_hardware(uint64_t*) noexcept {
+	return false;
+}
+
+#endif
+
+SobelProbe::SobelProbe(SobelIsa isa, SobelPath path, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept
+	: isa(isa), path(path), pixels(static_cast<uint64_t>(width) * height) {
+	const uint32_t bytesPerRow = width * static_cast<uint32_t>(sizeof(float));
+	padded = bytesPerLineSrc != bytesPerRow || bytesPerLineDst != bytesPerRow;
+	sampled = sample_hardware(hardware);
+	start = now_ns();
+}
+
+SobelProbe::~SobelProbe() {
+	const uint64_t elapsed = now_ns() - start;
+	AtomicCounters& counters = gCounters[static_cast<uint32_t>(isa)][static_cast<uint32_t>(path)];
+
+	uint64_t end[3];
+	if (sampled && sample_hardware(end)) {
+		counters.cycles.fetch_add(end[0] - hardware[0], std::memory_order_relaxed);
+		counters.instructions.fetch_add(end[1] - hardware[1], std::memory_order_relaxed);
+		counters.llcMisses.fetch_add(end[2] - hardware[2], std::memory_order_relaxed);
+	}
+
+	counters.calls.fetch_add(1u, std::memory_order_relaxed);
+	counters.paddedCalls.fetch_add(padded ? 1u : 0u, std::memory_order_relaxed);
+	counters.pixels.fetch_add(pixels, std::memory_order_relaxed);
+	counters.bytes.fetch_add(2u * pixels * sizeof(float), std::memory_order_relaxed);
+	counters.nanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+}
+
+bool sobel_instrument_query(SobelInstrumentStats* stats) noexcept {
+	stats->hardwareCounters = gHardwareCounters;
+
+	for (uint32_t i = 0u; i < kIsaCount; ++i) {
+		for (uint32_t p = 0u; p < kPathCount; ++p) {
+			const AtomicCounters& from = gCounters[i][p];
+			SobelCounters& to = stats->counters[i][p];
+			to.calls = from.calls.load(std::memory_order_relaxed);
+			to.paddedCalls = from.paddedCalls.load(std::memory_order_relaxed);
+			to.pixels = from.pixels.load(std::memory_order_relaxed);
+			to.bytes = from.bytes.load(std::memory_order_relaxed);
+			to.nanoseconds = from.nanoseconds.load(std::memory_order_relaxed);
+			to.cycles = from.cycles.load(std::memory_order_relaxed);
+			to.instructions = from.instructions.load(std::memory_order_relaxed);
+			to.llcMisses = from.llcMisses.load(std::memory_order_relaxed);
+		}
+	}
+
+	return true;
+}
+
+void sobel_instrument_reset() noexcept {
+	for (uint32_t i = 0u; i < kIsaCount; ++i) {
+		for (uint32_t p = 0u; p < kPathCount; ++p) {
+			AtomicCounters& counters = gCounters[i][p];
+			counters.calls = 0u;
+			counters.paddedCalls = 0u;
+			counters.pixels = 0u;
+			counters.bytes = 0u;
+			counters.nanoseconds = 0u;
+			counters.cycles = 0u;
+			counters.instructions = 0u;
+			counters.llcMisses = 0u;
+		}
+	}
+}
+
+void sobel_instrument_dump(FILE* file) noexcept {
+	static const char* const kPathNames[kPathCount] = { "scalar", "single block", "multi block", "single block+tail", "multi block+tail", "fixed shape", "row band" };
+
+	SobelInstrumentStats stats;
+	sobel_instrument_query(&stats);
+
+	fprintf(file, "%-8s %-18s %10s %10s %10s %9s %6s %12s\n", "isa", "path", "calls", "padded", "Mpix/s", "GB/s", "IPC", "LLC/kpix");
+	for (uint32_t i = 0u; i < kIsaCount; ++i) {
+		for (uint32_t p = 0u; p < kPathCount; ++p) {
+			const SobelCounters& c = stats.counters[i][p];
+			if (c.calls == 0u) {
+				continue;
+			}
+
+			const double seconds = c.nanoseconds * 1e-9;
+			fprintf(file, "%-8s %-18s %10llu %10llu %10.1f %9.2f", sobel_isa_name(static_cast<SobelIsa>(i)), kPathNames[p], static_cast<unsigned long long>(c.calls), static_cast<unsigned long long>(c.paddedCalls),
+				seconds > 0.0 ? c.pixels / seconds * 1e-6 : 0.0, seconds > 0.0 ? c.bytes / seconds * 1e-9 : 0.0);
+			if (stats.hardwareCounters && c.cycles != 0u) {
+				fprintf(file, " %6.2f %12.2f\n", static_cast<double>(c.instructions) / c.cycles, c.pixels != 0u ? c.llcMisses * 1000.0 / c.pixels : 0.0);
+			} else {
+				fprintf(file, " %6s %12s\n", "-", "-");
+			}
+		}
+	}
+}
+
+#else
+
+bool sobel_instrument_query(SobelInstrumentStats* stats) noexcept {
+	memset(stats, 0, sizeof(*stats));
+	return false;
+}
+
+void sobel_instrument_reset() noexcept {
+}
+
+void sobel_instrument_dump(FILE* file) noexcept {
+	fprintf(file, "sobel instrumentation disabled, configure with -DSOBEL_INSTRUMENTATION=ON\n");
+}
+
+#endif
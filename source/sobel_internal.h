@@ -0,0 +1,177 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "sobel_filter.h"
+#include "sobel_temporal.h"
+
+// Row range building blocks for the parallel drivers. Both take the full image
+// and write only the output rows [firstRow, lastRow), so bands of one image can
+// be processed independently with the borders still replicated at the image edges.
+
+// 3x3 Sobel magnitude rows
+typedef void (*SobelRowsFn)(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow);
+
+// 2x2 box downsampling into the (width + 1) / 2 by (height + 1) / 2 image, odd edges replicated
+typedef void (*SobelDownsampleFn)(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow);
+
+// Whole image 3x3 Sobel magnitude for one production shape with dense rows
+typedef void (*SobelFixedFn)(const float* src, float* dst);
+
+struct SobelFixedKernel {
+	uint32_t width;
+	uint32_t height;
+	SobelFixedFn filter;
+};
+
+// 3x3 Sobel magnitude of one row from the three source rows around it, already clamped.
+// Rows and out are aligned to the tier's block like whole image buffers.
+typedef void (*SobelRowFn)(const float* const* rows, float* out, uint32_t width);
+
+// Canny gradients and non-maximum suppression for a band of rows, see engine_canny
+typedef void (*SobelCannyFn)(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine);
+
+// Sources of the spatio-temporal rows: the previous, current and next frame, each
+// either read from frames or from its cached vertical sums, see engine_temporal
+struct SobelTemporalSource {
+	const float* frames[3];
+	const float* smooth[3];      // nullptr for the frames read directly
+	const float* derivative[3];
+	float* store[2];             // Smooth and derivative planes for the sums of the next frame, or nullptr
+	uint32_t bytesPerLine;
+	uint32_t bytesPerLineSums;
+};
+
+// Vertical sums of rows [firstRow, lastRow) of one frame, see engine_temporal_sums
+typedef void (*SobelTemporalSumsFn)(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow);
+
+// Spatio-temporal gradients of rows [firstRow, lastRow), scratch as for engine_temporal
+typedef void (*SobelTemporalFn)(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch);
+
+// Whole image 3x3 Sobel magnitude, the public entry point of a tier
+typedef void (*SobelFilterFn)(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst);
+
+// Specialization for a shape and strides, nullptr when there is none
+typedef SobelFixedFn (*SobelFixedLookupFn)(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst);
+
+// Whole image 3x3 Sobel magnitude between storage formats
+typedef void (*SobelFormatFn)(const void* src, void* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatSrc, SobelFormat formatDst);
+
+struct SobelKernels {
+	SobelFilterFn filter;    // Needs at least one SIMD block of width and two rows
+	uint32_t blockWidth;
+	SobelRowsFn rows;
+	SobelRowsFn rowsStream;  // Same rows written with non-temporal stores
+	SobelRowFn row;
+	SobelCannyFn canny;
+	SobelDownsampleFn downsample;
+	SobelFixedLookupFn fixed;
+	SobelFormatFn format;    // Tiers without a format kernel fall back to the scalar one
+	SobelTemporalSumsFn temporalSums;
+	SobelTemporalFn temporal;
+};
+
+const SobelKernels& sobel_kernels(SobelIsa isa) noexcept;
+
+// Next tier down in capability, kScalar stays
+static inline SobelIsa sobel_isa_lower(SobelIsa isa) noexcept {
+	switch (isa) {
+	case SobelIsa::kAvx512:
+		return SobelIsa::kAvx512Vl;
+	case SobelIsa::kAvx512Vl:
+		return SobelIsa::kAvx2;
+	case SobelIsa::kAvx2:
+		return SobelIsa::kSse2;
+	default:
+		return SobelIsa::kScalar;
+	}
+}
+
+// Highest tier the host supports at or below isa in capability
+SobelIsa sobel_resolve_isa(SobelIsa isa) noexcept;
+
+// Production resolutions specialized by every SIMD tier
+#define SOBEL_FIXED_SHAPES(V) \
+	{ 640u, 480u, engine_fixed<V, Sobel3Kernel, 640u, 480u> }, \
+	{ 1280u, 720u, engine_fixed<V, Sobel3Kernel, 1280u, 720u> }, \
+	{ 1920u, 1080u, engine_fixed<V, Sobel3Kernel, 1920u, 1080u> }, \
+	{ 3840u, 2160u, engine_fixed<V, Sobel3Kernel, 3840u, 2160u> }
+
+template <uint32_t kCount>
+static inline SobelFixedFn sobel_fixed_lookup(const SobelFixedKernel (&table)[kCount], uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	const uint32_t bytesPerRow = width * static_cast<uint32_t>(sizeof(float));
+	if (bytesPerLineSrc != bytesPerRow || bytesPerLineDst != bytesPerRow) {
+		return nullptr;
+	}
+
+	for (uint32_t i = 0u; i < kCount; ++i) {
+		if (table[i].width == width && table[i].height == height) {
+			return table[i].filter;
+		}
+	}
+	return nullptr;
+}
+
+// Processor brand string from cpuid, at most 48 characters
+void sobel_cpu_model(char model[49]) noexcept;
+
+void sobel_rows(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_rows_sse2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_rows_avx2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_rows_avx512(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_rows_avx512vl(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+
+void sobel_rows_stream_sse2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_rows_stream_avx2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_rows_stream_avx512(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_rows_stream_avx512vl(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+
+void sobel_row(const float* const* rows, float* out, uint32_t width) noexcept;
+void sobel_row_sse2(const float* const* rows, float* out, uint32_t width) noexcept;
+void sobel_row_avx2(const float* const* rows, float* out, uint32_t width) noexcept;
+void sobel_row_avx512(const float* const* rows, float* out, uint32_t width) noexcept;
+void sobel_row_avx512vl(const float* const* rows, float* out, uint32_t width) noexcept;
+
+void sobel_canny_rows(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept;
+void sobel_canny_rows_sse2(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept;
+void sobel_canny_rows_avx2(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept;
+void sobel_canny_rows_avx512(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept;
+void sobel_canny_rows_avx512vl(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t firstRow, uint32_t lastRow, float low, float high, float* scratch, uint64_t* strong, uint64_t* candidates, uint32_t wordsPerLine) noexcept;
+
+// Widens one row of a storage format to float
+void sobel_convert_row(const void* src, SobelFormat format, float* dst, uint32_t width) noexcept;
+
+SobelFixedFn sobel_fixed(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+SobelFixedFn sobel_fixed_sse2(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+SobelFixedFn sobel_fixed_avx2(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+SobelFixedFn sobel_fixed_avx512(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+SobelFixedFn sobel_fixed_avx512vl(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+
+void sobel_downsample(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_downsample_sse2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_downsample_avx2(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_downsample_avx512(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_downsample_avx512vl(const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t firstRow, uint32_t lastRow) noexcept;
+
+void sobel_temporal_sums(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_temporal_sums_sse2(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_temporal_sums_avx2(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_temporal_sums_avx512(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept;
+void sobel_temporal_sums_avx512vl(const float* src, float* smooth, float* derivative, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineSums, uint32_t firstRow, uint32_t lastRow) noexcept;
+
+void sobel_temporal_rows(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept;
+void sobel_temporal_rows_sse2(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept;
+void sobel_temporal_rows_avx2(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept;
+void sobel_temporal_rows_avx512(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept;
+void sobel_temporal_rows_avx512vl(const SobelTemporalSource* source, const SobelTemporalOutput* output, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, float* scratch) noexcept;
@@ -0,0 +1,312 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "sobel_numa.h"
+#include "sobel_internal.h"
+#include "sobel_workers.h"
+
+static constexpr uint32_t kBandRows = 64u;
+static constexpr uint32_t kReportRepetitions = 3u;  // Best of
+
+#if defined(__linux__)
+static constexpr unsigned long kMpolFNode = 1ul << 0;
+static constexpr unsigned long kMpolFAddr = 1ul << 1;
+#endif
+
+struct NumaTopology {
+	std::vector<uint32_t> nodes;                           // Operating system node ids
+	std::vector<std::vector<uint32_t> > cpus;              // Per node
+	std::vector<std::unique_ptr<SobelWorkers> > workers;   // Per node, one pinned worker per CPU
+};
+
+// Parses a sysfs list such as "0-3,8-11"
+static std::vector<uint32_t> parse_list(const char* text) noexcept {
+	std::vector<uint32_t> values;
+
+	while (*text != '\0' && *text != '\n') {
+		char* end;
+		const unsigned long first = strtoul(text, &end, 10);
+		if (end == text) {
+			break;
+		}
+
+		unsigned long last = first;
+		if (*end == '-') {
+			text = end + 1;
+			last = strtoul(text, &end, 10);
+		}
+
+		for (unsigned long value = first; value <= last; ++value) {
+			values.push_back(static_cast<uint32_t>(value));
+		}
+
+		text = *end == ',' ? end + 1 : end;
+	}
+
+	return values;
+}
+
+static bool read_list(const char* path, std::vector<uint32_t>& values) noexcept {
+	FILE* file = fopen(path, "r");
+	if (file == nullptr) {
+		return false;
+	}
+
+	char text[4096];
+	const bool ok = fgets(text, sizeof(text), file) != nullptr;
+	fclose(file);
+
+	if (ok) {
+		values = parse_list(text);
+	}
+	return ok;
+}
+
+static bool cpu_allowed(uint32_t cpu) noexcept {
+#if defined(__linux__)
+	static cpu_set_t allowed;
+	static const bool known = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+	return !known || cpu >= CPU_SETSIZE || CPU_ISSET(static_cast<int>(cpu), &allowed);
+#else
+	(void)cpu;
+	return true;
+#endif
+}
+
+static NumaTopology& numa_topology() noexcept {
+	static NumaTopology topology = [] {
+		NumaTopology t;
+		std::vector<uint32_t> online;
+
+		if (read_list("/sys/devices/system/node/online", online)) {
+			for (uint32_t node : online) {
+				char path[96];
+				snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+
+				std::vector<uint32_t> cpus;
+				read_list(path, cpus);
+				cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [](uint32_t cpu) { return !cpu_allowed(cpu); }), cpus.end());
+
+				// Memory only nodes have no CPUs to run on
+				if (!cpus.empty()) {
+					t.nodes.push_back(node);
+					t.cpus.push_back(cpus);
+				}
+			}
+		}
+
+		if (t.nodes.empty()) {
+			std::vector<uint32_t> cpus;
+			for (uint32_t cpu = 0u; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+				cpus.push_back(cpu);
+			}
+			t.nodes.push_back(0u);
+			t.cpus.push_back(cpus);
+		}
+
+		for (const std::vector<uint32_t>& cpus : t.cpus) {
+			t.workers.emplace_back(new SobelWorkers(cpus));
+		}
+		return t;
+	}();
+	return topology;
+}
+
+// Index into the topology of the node holding the page at ptr, count when unknown
+static uint32_t page_node(const NumaTopology& topology, const void* ptr) noexcept {
+#if defined(__linux__) && defined(__NR_get_mempolicy)
+	int node = -1;
+	if (syscall(__NR_get_mempolicy, &node, nullptr, 0ul, ptr, kMpolFNode | kMpolFAddr) == 0) {
+		for (uint32_t i = 0u; i < topology.nodes.size(); ++i) {
+			if (topology.nodes[i] == static_cast<uint32_t>(node)) {
+				return i;
+			}
+		}
+	}
+#else
+	(void)ptr;
+#endif
+	return static_cast<uint32_t>(topology.nodes.size());
+}
+
+// Runs each job on a worker of its node and returns once all have finished
+static void run_on_nodes(NumaTopology& topology, const std::vector<std::function<void()> >& jobs) noexcept {
+	std::mutex lock;
+	std::condition_variable finished;
+	uint32_t pending = 0u;
+
+	for (uint32_t i = 0u; i < jobs.size(); ++i) {
+		if (!jobs[i]) {
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			++pending;
+		}
+
+		const std::function<void()>* job = &jobs[i];
+		topology.workers[i]->post([job, &lock, &finished, &pending] {
+			(*job)();
+
+			std::lock_guard<std::mutex> guard(lock);
+			if (--pending == 0u) {
+				finished.notify_all();
+			}
+		});
+	}
+
+	std::unique_lock<std::mutex> guard(lock);
+	finished.wait(guard, [&pending] { return pending == 0u; });
+}
+
+uint32_t sobel_numa_nodes() noexcept {
+	return static_cast<uint32_t>(numa_topology().nodes.size());
+}
+
+// Filters the bands listed, on the node's workers when parallel
+static void node_bands(SobelWorkers& workers, SobelRowsFn rows, const std::vector<uint32_t>& bands, bool parallel, const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	const std::function<void(uint32_t)> task = [&](uint32_t i) {
+		const uint32_t firstRow = bands[i] * kBandRows;
+		rows(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, std::min(firstRow + kBandRows, height));
+	};
+
+	if (parallel) {
+		workers.run(static_cast<uint32_t>(bands.size()), task);
+	} else {
+		for (uint32_t i = 0u; i < bands.size(); ++i) {
+			task(i);
+		}
+	}
+}
+
+void sobel_filter_numa(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelIsa isa) noexcept {
+	NumaTopology& topology = numa_topology();
+	const SobelRowsFn rows = sobel_kernels(sobel_resolve_isa(isa)).rows;
+	const uint32_t nodeCount = static_cast<uint32_t>(topology.nodes.size());
+	const uint32_t bands = (height + kBandRows - 1u) / kBandRows;
+
+	std::vector<std::vector<uint32_t> > nodeBands(nodeCount);
+	for (uint32_t band = 0u; band < bands; ++band) {
+		const float* row = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(src) + static_cast<uintptr_t>(band) * kBandRows * bytesPerLineSrc);
+		uint32_t node = nodeCount == 1u ? 0u : page_node(topology, row);
+		if (node == nodeCount) {
+			node = band % nodeCount;
+		}
+		nodeBands[node].push_back(band);
+	}
+
+	std::vector<std::function<void()> > jobs(nodeCount);
+	for (uint32_t node = 0u; node < nodeCount; ++node) {
+		if (!nodeBands[node].empty()) {
+			SobelWorkers& workers = *topology.workers[node];
+			const std::vector<uint32_t>& list = nodeBands[node];
+			jobs[node] = [&workers, rows, &list, src, dst, width, height, bytesPerLineSrc, bytesPerLineDst] {
+				node_bands(workers, rows, list, true, src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+			};
+		}
+	}
+
+	run_on_nodes(topology, jobs);
+}
+
+uint32_t sobel_numa_report(uint32_t width, uint32_t height, SobelNumaNode* nodes, uint32_t capacity) noexcept {
+	NumaTopology& topology = numa_topology();
+	const SobelRowsFn rows = sobel_kernels(sobel_detect_isa()).rows;
+	const uint32_t nodeCount = static_cast<uint32_t>(topology.nodes.size());
+	const uint32_t bytesPerLine = (width * static_cast<uint32_t>(sizeof(float)) + 63u) & ~63u;
+	const size_t planeBytes = static_cast<size_t>(bytesPerLine) * height;
+	const double pixels = static_cast<double>(width) * height;
+
+	std::vector<uint32_t> bands((height + kBandRows - 1u) / kBandRows);
+	for (uint32_t band = 0u; band < bands.size(); ++band) {
+		bands[band] = band;
+	}
+
+	for (uint32_t node = 0u; node < nodeCount && node < capacity; ++node) {
+		// Left untouched until a worker of the node writes it, so the pages are placed there
+		uint8_t* buffer = static_cast<uint8_t*>(malloc(2u * planeBytes + 64u));
+		if (buffer == nullptr) {
+			return node;
+		}
+		float* src = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(buffer) + 63u) & ~static_cast<uintptr_t>(63u));
+		float* dst = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(src) + planeBytes);
+
+		std::vector<std::function<void()> > jobs(nodeCount);
+		jobs[node] = [=] {
+			for (size_t i = 0u; i < 2u * planeBytes / sizeof(float); ++i) {
+				src[i] = static_cast<float>((i * 2654435761u) >> 24);
+			}
+		};
+		run_on_nodes(topology, jobs);
+
+		// Best throughput of the workers of one node on the frame
+		const auto measure = [&](uint32_t worker, bool parallel) {
+			double best = 0.0;
+			for (uint32_t rep = 0u; rep <= kReportRepetitions; ++rep) {
+				std::vector<std::function<void()> > timed(nodeCount);
+				timed[worker] = [&] {
+					node_bands(*topology.workers[worker], rows, bands, parallel, src, dst, width, height, bytesPerLine, bytesPerLine);
+				};
+
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				run_on_nodes(topology, timed);
+				const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				if (rep != 0u && seconds > 0.0) {
+					best = std::max(best, pixels / seconds * 1e-6);
+				}
+			}
+			return best;
+		};
+
+		SobelNumaNode& report = nodes[node];
+		report.node = topology.nodes[node];
+		report.cpus = static_cast<uint32_t>(topology.cpus[node].size());
+		report.singleThread = measure(node, false);
+		report.allThreads = measure(node, true);
+		report.remote = nodeCount > 1u ? measure((node + 1u) % nodeCount, true) : 0.0;
+
+		free(buffer);
+	}
+
+	return std::min(nodeCount, capacity);
+}
+
+void sobel_numa_dump(FILE* file, uint32_t width, uint32_t height) noexcept {
+	std::vector<SobelNumaNode> nodes(sobel_numa_nodes());
+	const uint32_t count = sobel_numa_report(width, height, nodes.data(), static_cast<uint32_t>(nodes.size()));
+
+	fprintf(file, "%ux%u frame, Mpix/s\n", width, height);
+	fprintf(file, "%6s %6s %12s %12s %9s %12s\n", "node", "cpus", "one thread", "all threads", "scaling", "remote");
+	for (uint32_t i = 0u; i < count; ++i) {
+		const SobelNumaNode& n = nodes[i];
+		fprintf(file, "%6u %6u %12.1f %12.1f %8.2fx %12.1f\n", n.node, n.cpus, n.singleThread, n.allThreads, n.singleThread > 0.0 ? n.allThreads / n.singleThread : 0.0, n.remote);
+	}
+}
@@ -0,0 +1,318 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "sobel_pipeline.h"
+#include "sobel_internal.h"
+#include "sobel_workers.h"
+
+static constexpr uint32_t kMinBandRows = 32u;
+static constexpr uint64_t kParallelPixels = 1u << 16;  // Smaller images run on the caller alone
+static constexpr uintptr_t kRowAlignment = 64u;
+
+namespace {
+
+static constexpr uint32_t kChunkColumns = 512u;
+
+// Separable 3x3 stencil in chunks of columns that stay on the stack: vertical
+// combines the three rows of a column, horizontal three neighboring columns.
+// Both loops are free of edge clamping so the compiler can vectorize them.
+template <typename Vertical, typename Horizontal>
+static inline void separable_row(const float* const* rows, float* out, uint32_t width, Vertical vertical, Horizontal horizontal) noexcept {
+	const float* pr = rows[0];
+	const float* cr = rows[1];
+	const float* nr = rows[2];
+
+	alignas(64) float columns[kChunkColumns + 2u];
+
+	for (uint32_t x0 = 0u; x0 < width; x0 += kChunkColumns) {
+		const uint32_t count = std::min(kChunkColumns, width - x0);
+		const uint32_t lx = x0 != 0u ? x0 - 1u : 0u;
+		const uint32_t rx = x0 + count < width ? x0 + count : width - 1u;
+
+		// Pointer offsets keep the index arithmetic free of 32 bit wraparound, which blocks vectorization
+		const float* p = pr + x0;
+		const float* c = cr + x0;
+		const float* n = nr + x0;
+		float* o = out + x0;
+
+		columns[0] = vertical(pr[lx], cr[lx], nr[lx]);
+		for (size_t i = 0u; i < count; ++i) {
+			columns[i + 1u] = vertical(p[i], c[i], n[i]);
+		}
+		columns[count + 1u] = vertical(pr[rx], cr[rx], nr[rx]);
+
+		for (size_t i = 0u; i < count; ++i) {
+			o[i] = horizontal(columns[i], columns[i + 1u], columns[i + 2u]);
+		}
+	}
+}
+
+class BlurStage : public SobelStage {
+public:
+	uint32_t halo() const noexcept override { return 1u; }
+
+	void row(const float* const* rows, float* out, uint32_t width, uint32_t) const noexcept override {
+		separable_row(rows, out, width, [](float a, float b, float c) { return a + 2.0f * b + c; }, [](float a, float b, float c) { return (a + 2.0f * b + c) * (1.0f / 16.0f); });
+	}
+};
+
+class SobelMagnitudeStage : public SobelStage {
+public:
+	explicit SobelMagnitudeStage(SobelIsa isa) noexcept
+		: fn(sobel_kernels(sobel_resolve_isa(isa)).row) {
+	}
+
+	uint32_t halo() const noexcept override { return 1u; }
+
+	void row(const float* const* rows, float* out, uint32_t width, uint32_t) const noexcept override {
+		fn(rows, out, width);
+	}
+
+private:
+	const SobelRowFn fn;
+};
+
+class ThresholdStage : public SobelStage {
+public:
+	explicit ThresholdStage(float threshold) noexcept : threshold(threshold) {}
+
+	uint32_t halo() const noexcept override { return 0u; }
+
+	void row(const float* const* rows, float* out, uint32_t width, uint32_t) const noexcept override {
+		const float* cr = rows[0];
+		for (uint32_t x = 0u; x < width; ++x) {
+			out[x] = cr[x] > threshold ? 1.0f : 0.0f;
+		}
+	}
+
+private:
+	const float threshold;
+};
+
+// 3x3 maximum for Op = std::greater, minimum for std::less
+template <typename Op>
+class MorphologyStage : public SobelStage {
+public:
+	uint32_t halo() const noexcept override { return 1u; }
+
+	void row(const float* const* rows, float* out, uint32_t width, uint32_t) const noexcept override {
+		const auto pick = [](float a, float b, float c) {
+			const Op better;
+			const float v = better(a, b) ? a : b;
+			return better(v, c) ? v : c;
+		};
+		separable_row(rows, out, width, pick, pick);
+	}
+};
+
+// Everything a band needs that is shared by all bands of one run
+struct Sweep {
+	const std::unique_ptr<SobelStage>* stages;
+	uint32_t stageCount;
+	const uint8_t* src;
+	SobelFormat formatSrc;
+	uint32_t bytesPerLineSrc;
+	bool directSrc;  // Float rows aligned well enough to be read in place
+	uint8_t* dst;
+	uint32_t bytesPerLineDst;
+	bool directDst;  // Rows aligned well enough for the last stage to write in place
+	uint32_t width;
+	uint32_t height;
+};
+
+// Per task state. Level k is the input of stage k: level 0 holds converted
+// source rows and level k + 1 the output of stage k. Each level keeps the
+// 2 * halo + 1 rows its consumer reads in a ring indexed by row modulo size.
+class Band {
+public:
+	explicit Band(const Sweep& sweep)
+		: sweep(sweep), levels(sweep.stageCount), stride((sweep.width + 15u) & ~15u) {
+		size_t floats = stride;  // Staging row of the last stage
+		for (uint32_t k = 0u; k < sweep.stageCount; ++k) {
+			levels[k].count = 2u * sweep.stages[k]->halo() + 1u;
+			levels[k].window.resize(levels[k].count);
+			floats += static_cast<size_t>(levels[k].count) * stride;
+		}
+		storage.resize(floats + kRowAlignment / sizeof(float));
+
+		float* base = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(storage.data()) + kRowAlignment - 1u) & ~(kRowAlignment - 1u));
+		for (uint32_t k = 0u; k < sweep.stageCount; ++k) {
+			levels[k].base = base;
+			base += static_cast<size_t>(levels[k].count) * stride;
+		}
+		staging = base;
+	}
+
+	void run(uint32_t firstRow, uint32_t lastRow) noexcept {
+		const Sweep& s = sweep;
+
+		if (s.stageCount == 0u) {
+			for (uint32_t y = firstRow; y < lastRow; ++y) {
+				sobel_convert_row(s.src + static_cast<size_t>(y) * s.bytesPerLineSrc, s.formatSrc, reinterpret_cast<float*>(s.dst + static_cast<size_t>(y) * s.bytesPerLineDst), s.width);
+			}
+			return;
+		}
+
+		// Level k must start where the rows below it first read it
+		uint32_t halo = 0u;
+		for (uint32_t k = s.stageCount; k-- > 0u;) {
+			halo += s.stages[k]->halo();
+			levels[k].next = firstRow > halo ? firstRow - halo : 0u;
+		}
+
+		const uint32_t last = s.stageCount - 1u;
+		const SobelStage& stage = *s.stages[last];
+		for (uint32_t y = firstRow; y < lastRow; ++y) {
+			float* out = s.directDst ? reinterpret_cast<float*>(s.dst + static_cast<size_t>(y) * s.bytesPerLineDst) : staging;
+			stage.row(gather(last, y), out, s.width, y);
+			if (!s.directDst) {
+				memcpy(s.dst + static_cast<size_t>(y) * s.bytesPerLineDst, staging, s.width * sizeof(float));
+			}
+		}
+	}
+
+private:
+	struct Level {
+		float* base;
+		uint32_t count;
+		uint32_t next;  // First row not produced yet
+		std::vector<const float*> window;  // Rows handed to stage k
+	};
+
+	const float* level_row(uint32_t k, uint32_t y) const noexcept {
+		if (k == 0u && sweep.directSrc) {
+			return reinterpret_cast<const float*>(sweep.src + static_cast<size_t>(y) * sweep.bytesPerLineSrc);
+		}
+		return levels[k].base + static_cast<size_t>(y % levels[k].count) * stride;
+	}
+
+	// Produces level k up to row y and returns the clamped window of stage k around y
+	const float* const* gather(uint32_t k, uint32_t y) noexcept {
+		const float** rows = levels[k].window.data();
+		const int64_t halo = sweep.stages[k]->halo();
+		produce(k, std::min(static_cast<int64_t>(y) + halo, static_cast<int64_t>(sweep.height) - 1));
+		for (int64_t j = -halo; j <= halo; ++j) {
+			const int64_t ry = std::min(std::max(static_cast<int64_t>(y) + j, int64_t(0)), static_cast<int64_t>(sweep.height) - 1);
+			rows[j + halo] = level_row(k, static_cast<uint32_t>(ry));
+		}
+		return rows;
+	}
+
+	void produce(uint32_t k, int64_t upto) noexcept {
+		Level& level = levels[k];
+		for (; static_cast<int64_t>(level.next) <= upto; ++level.next) {
+			const uint32_t y = level.next;
+			float* out = levels[k].base + static_cast<size_t>(y % level.count) * stride;
+
+			if (k == 0u) {
+				if (!sweep.directSrc) {
+					sobel_convert_row(sweep.src + static_cast<size_t>(y) * sweep.bytesPerLineSrc, sweep.formatSrc, out, sweep.width);
+				}
+				continue;
+			}
+
+			const SobelStage& stage = *sweep.stages[k - 1u];
+			stage.row(gather(k - 1u, y), out, sweep.width, y);
+		}
+	}
+
+	const Sweep& sweep;
+	std::vector<Level> levels;
+	const size_t stride;  // Floats per ring row, a multiple of 64 bytes
+	std::vector<float> storage;
+	float* staging;
+};
+
+}  // namespace
+
+std::unique_ptr<SobelStage> sobel_stage_blur() {
+	return std::unique_ptr<SobelStage>(new BlurStage());
+}
+
+std::unique_ptr<SobelStage> sobel_stage_sobel(SobelIsa isa) {
+	return std::unique_ptr<SobelStage>(new SobelMagnitudeStage(isa));
+}
+
+std::unique_ptr<SobelStage> sobel_stage_threshold(float threshold) {
+	return std::unique_ptr<SobelStage>(new ThresholdStage(threshold));
+}
+
+std::unique_ptr<SobelStage> sobel_stage_dilate() {
+	return std::unique_ptr<SobelStage>(new MorphologyStage<std::greater<float> >());
+}
+
+std::unique_ptr<SobelStage> sobel_stage_erode() {
+	return std::unique_ptr<SobelStage>(new MorphologyStage<std::less<float> >());
+}
+
+SobelPipeline& SobelPipeline::add(std::unique_ptr<SobelStage> stage) {
+	stages.push_back(std::move(stage));
+	return *this;
+}
+
+uint32_t SobelPipeline::halo() const noexcept {
+	uint32_t halo = 0u;
+	for (const std::unique_ptr<SobelStage>& stage : stages) {
+		halo += stage->halo();
+	}
+	return halo;
+}
+
+void SobelPipeline::run(const void* src, SobelFormat formatSrc, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, uint32_t bandRows) const noexcept {
+	if (width == 0u || height == 0u) {
+		return;
+	}
+
+	Sweep sweep;
+	sweep.stages = stages.data();
+	sweep.stageCount = static_cast<uint32_t>(stages.size());
+	sweep.src = static_cast<const uint8_t*>(src);
+	sweep.formatSrc = formatSrc;
+	sweep.bytesPerLineSrc = bytesPerLineSrc;
+	sweep.directSrc = formatSrc == SobelFormat::kFloat32 && ((reinterpret_cast<uintptr_t>(src) | bytesPerLineSrc) & (kRowAlignment - 1u)) == 0u;
+	sweep.dst = reinterpret_cast<uint8_t*>(dst);
+	sweep.bytesPerLineDst = bytesPerLineDst;
+	sweep.directDst = ((reinterpret_cast<uintptr_t>(dst) | bytesPerLineDst) & (kRowAlignment - 1u)) == 0u;
+	sweep.width = width;
+	sweep.height = height;
+
+	SobelWorkers& workers = SobelWorkers::shared();
+	const bool parallel = static_cast<uint64_t>(width) * height >= kParallelPixels;
+	if (bandRows == 0u) {
+		bandRows = parallel ? std::max((height + workers.size() - 1u) / workers.size(), kMinBandRows) : height;
+	}
+	const uint32_t bands = (height + bandRows - 1u) / bandRows;
+	const uint32_t tasks = parallel ? std::min(workers.size(), bands) : 1u;
+
+	// Each task sweeps every tasks-th band with one set of rings
+	auto task = [&sweep, bands, bandRows, tasks](uint32_t index) {
+		Band band(sweep);
+		for (uint32_t b = index; b < bands; b += tasks) {
+			const uint32_t firstRow = b * bandRows;
+			band.run(firstRow, std::min(firstRow + bandRows, sweep.height));
+		}
+	};
+
+	if (tasks == 1u) {
+		task(0u);
+	} else {
+		workers.run(tasks, task);
+	}
+}
@@ -0,0 +1,154 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <new>
+
+#include "sobel_plan.h"
+#include "sobel_internal.h"
+#include "sobel_workers.h"
+
+static constexpr uint32_t kDefaultBandRows = 64u;
+static constexpr uint64_t kParallelPixels = 1u << 18;  // Smaller frames run on the caller alone
+
+struct SobelPlanData {
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytesPerLineSrc;
+	uint32_t bytesPerLineDst;
+	SobelFormat formatSrc;
+	SobelFormat formatDst;
+	SobelIsa isa;
+
+	// The first one set runs a whole frame, rows also runs bands
+	SobelFormatFn format;
+	SobelFixedFn fixed;
+	SobelFilterFn filter;
+	SobelRowsFn rows;
+
+	uint32_t bandRows;
+	uint32_t bands;
+	uint32_t tasks;  // 1 runs the whole frame on the caller
+};
+
+static uint32_t format_bytes(SobelFormat format) noexcept {
+	return format == SobelFormat::kFloat32 ? 4u : 2u;
+}
+
+SobelPlan sobel_plan_create(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst, SobelFormat formatSrc, SobelFormat formatDst, const SobelPlanOptions* options) noexcept {
+	if (width == 0u || height == 0u || bytesPerLineSrc < width * format_bytes(formatSrc) || bytesPerLineDst < width * format_bytes(formatDst)) {
+		return nullptr;
+	}
+
+	SobelPlanData* plan = new (std::nothrow) SobelPlanData();
+	if (plan == nullptr) {
+		return nullptr;
+	}
+
+	plan->width = width;
+	plan->height = height;
+	plan->bytesPerLineSrc = bytesPerLineSrc;
+	plan->bytesPerLineDst = bytesPerLineDst;
+	plan->formatSrc = formatSrc;
+	plan->formatDst = formatDst;
+
+	// Tiers load and store whole blocks of their width from every row
+	static constexpr uint32_t kBlockElements[] = { 1u, 4u, 8u, 16u, 8u };
+	const bool floats = formatSrc == SobelFormat::kFloat32 && formatDst == SobelFormat::kFloat32;
+	SobelIsa isa = sobel_resolve_isa(options != nullptr ? options->isa : SobelIsa::kAvx512);
+	for (;;) {
+		const uint32_t block = kBlockElements[static_cast<uint32_t>(isa)];
+		if (isa == SobelIsa::kScalar || ((bytesPerLineSrc & (block * format_bytes(formatSrc) - 1u)) == 0u && (bytesPerLineDst & (block * format_bytes(formatDst) - 1u)) == 0u)) {
+			break;
+		}
+		isa = sobel_resolve_isa(sobel_isa_lower(isa));
+	}
+	// 16 bit formats exist from AVX2 up only
+	if (!floats && isa == SobelIsa::kSse2) {
+		isa = SobelIsa::kScalar;
+	}
+	plan->isa = isa;
+
+	const SobelKernels& kernels = sobel_kernels(plan->isa);
+	if (!floats) {
+		plan->format = kernels.format;
+	} else {
+		plan->fixed = kernels.fixed(width, height, bytesPerLineSrc, bytesPerLineDst);
+		plan->filter = width >= kernels.blockWidth && height >= 2u ? kernels.filter : nullptr;
+		plan->rows = kernels.rows;
+	}
+
+	const uint32_t requested = options != nullptr ? options->threads : 0u;
+	const uint32_t threads = requested == 0u ? SobelWorkers::shared().size() : requested;
+	plan->bandRows = options != nullptr && options->bandRows != 0u ? options->bandRows : kDefaultBandRows;
+	plan->bands = (height + plan->bandRows - 1u) / plan->bandRows;
+	plan->tasks = 1u;
+
+	// Banding needs the row kernel, the other kernels run whole frames
+	if (floats && threads > 1u && static_cast<uint64_t>(width) * height >= kParallelPixels) {
+		plan->fixed = nullptr;
+		plan->filter = nullptr;
+		plan->tasks = std::min(threads, plan->bands);
+	}
+
+	return plan;
+}
+
+void sobel_plan_execute(SobelPlan plan, const void* src, void* dst) noexcept {
+	if (plan->format != nullptr) {
+		plan->format(src, dst, plan->width, plan->height, plan->bytesPerLineSrc, plan->bytesPerLineDst, plan->formatSrc, plan->formatDst);
+		return;
+	}
+
+	const float* typedSrc = static_cast<const float*>(src);
+	float* typedDst = static_cast<float*>(dst);
+
+	if (plan->fixed != nullptr) {
+		plan->fixed(typedSrc, typedDst);
+		return;
+	}
+
+	if (plan->filter != nullptr) {
+		plan->filter(typedSrc, typedDst, plan->width, plan->height, plan->bytesPerLineSrc, plan->bytesPerLineDst);
+		return;
+	}
+
+	if (plan->tasks == 1u) {
+		plan->rows(typedSrc, typedDst, plan->width, plan->height, plan->bytesPerLineSrc, plan->bytesPerLineDst, 0u, plan->height);
+		return;
+	}
+
+	// One pointer capture stays within std::function's small buffer, so nothing is allocated
+	struct Call {
+		const SobelPlanData* plan;
+		const float* src;
+		float* dst;
+	} call = { plan, typedSrc, typedDst };
+
+	SobelWorkers::shared().run(plan->tasks, [&call](uint32_t task) {
+		const SobelPlanData& p = *call.plan;
+		for (uint32_t band = task; band < p.bands; band += p.tasks) {
+			const uint32_t firstRow = band * p.bandRows;
+			p.rows(call.src, call.dst, p.width, p.height, p.bytesPerLineSrc, p.bytesPerLineDst, firstRow, std::min(firstRow + p.bandRows, p.height));
+		}
+	});
+}
+
+SobelIsa sobel_plan_isa(SobelPlan plan) noexcept {
+	return plan->isa;
+}
+
+void sobel_plan_destroy(SobelPlan plan) noexcept {
+	delete plan;
+}
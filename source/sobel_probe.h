@@ -0,0 +1,58 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "sobel_filter.h"
+#include "sobel_instrument.h"
+
+// Classifies a call to a kernel with simdWidth lanes by the branch it takes
+static inline SobelPath sobel_path(uint32_t width, uint32_t simdWidth) noexcept {
+	if (simdWidth == 1u) {
+		return SobelPath::kScalar;
+	}
+	if (width % simdWidth == 0u) {
+		return width >= 2u * simdWidth ? SobelPath::kMultiBlock : SobelPath::kSingleBlock;
+	}
+	return width >= 2u * simdWidth ? SobelPath::kMultiBlockTail : SobelPath::kSingleBlockTail;
+}
+
+#if SOBEL_INSTRUMENTATION
+
+// Samples the wall clock and the calling thread's hardware counters for one kernel call
+class SobelProbe {
+public:
+	SobelProbe(SobelIsa isa, SobelPath path, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept;
+	~SobelProbe();
+
+	SobelProbe(const SobelProbe&) = delete;
+	SobelProbe& operator=(const SobelProbe&) = delete;
+
+private:
+	SobelIsa isa;
+	SobelPath path;
+	uint64_t pixels;
+	bool padded;
+	uint64_t start;
+	uint64_t hardware[3];
+	bool sampled;
+};
+
+#define SOBEL_PROBE(isa, path, width, height, bytesPerLineSrc, bytesPerLineDst) \
+	const SobelProbe sobelProbe(isa, path, width, height, bytesPerLineSrc, bytesPerLineDst)
+
+#else
+
+#define SOBEL_PROBE(isa, path, width, height, bytesPerLineSrc, bytesPerLineDst) ((void)0)
+
+#endif
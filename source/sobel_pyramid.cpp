@@ -0,0 +1,135 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "sobel_pyramid.h"
+#include "sobel_internal.h"
+#include "sobel_workers.h"
+
+static constexpr uintptr_t kArenaAlign = 64u;
+static constexpr uint32_t kBandRows = 64u;            // Even, so a band downsamples into whole rows
+static constexpr uint64_t kParallelPixels = 1u << 16; // Smaller pyramids are built on the calling thread
+
+static inline uint32_t level_bytes_per_line(uint32_t width) noexcept {
+	return static_cast<uint32_t>((static_cast<uintptr_t>(width) * sizeof(float) + kArenaAlign - 1u) & ~(kArenaAlign - 1u));
+}
+
+size_t sobel_pyramid_size(uint32_t width, uint32_t height, uint32_t levels) noexcept {
+	size_t size = kArenaAlign - 1u;
+
+	for (uint32_t level = 0u; level < levels; ++level) {
+		const size_t plane = static_cast<size_t>(level_bytes_per_line(width)) * height;
+		size += level == 0u ? plane : 2u * plane;
+
+		width = (width + 1u) / 2u;
+		height = (height + 1u) / 2u;
+	}
+
+	return size;
+}
+
+// Magnitude rows [firstRow, lastRow) of one level, each pair of rows downsampled into next right away
+static void pyramid_band(const SobelKernels& kernels, const float* src, uint32_t bytesPerLineSrc, const SobelPyramidLevel& level, float* next, uint32_t bytesPerLineNext, uint32_t firstRow, uint32_t lastRow) noexcept {
+	for (uint32_t y = firstRow; y < lastRow; y += 2u) {
+		kernels.rows(src, level.magnitude, level.width, level.height, bytesPerLineSrc, level.bytesPerLine, y, std::min(y + 2u, lastRow));
+
+		if (next != nullptr) {
+			kernels.downsample(src, next, level.width, level.height, bytesPerLineSrc, bytesPerLineNext, y / 2u, y / 2u + 1u);
+		}
+	}
+}
+
+void sobel_pyramid(const float* src, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t levels, void* arena, SobelPyramidLevel* out, SobelIsa isa) noexcept {
+#ifdef _DEBUG
+	assert(width != 0u && height != 0u);
+	assert(arena != nullptr && out != nullptr);
+#endif
+	const SobelKernels& kernels = sobel_kernels(sobel_resolve_isa(isa));
+	uint8_t* cursor = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(arena) + kArenaAlign - 1u) & ~(kArenaAlign - 1u));
+
+	for (uint32_t level = 0u; level < levels; ++level) {
+		SobelPyramidLevel& l = out[level];
+		l.width = width;
+		l.height = height;
+		l.bytesPerLine = level_bytes_per_line(width);
+
+		const size_t plane = static_cast<size_t>(l.bytesPerLine) * height;
+		l.image = nullptr;
+		if (level != 0u) {
+			l.image = reinterpret_cast<float*>(cursor);
+			cursor += plane;
+		}
+		l.magnitude = reinterpret_cast<float*>(cursor);
+		cursor += plane;
+
+		width = (width + 1u) / 2u;
+		height = (height + 1u) / 2u;
+	}
+
+	// Bands of every level form one batch, level by level. A band waits only for the bands
+	// of the level above that downsample into its rows and their halo, which were handed
+	// out before it, so coarse levels run while the finer ones are still being filtered.
+	std::vector<uint32_t> firstBand(levels + 1u, 0u);
+	for (uint32_t level = 0u; level < levels; ++level) {
+		firstBand[level + 1u] = firstBand[level] + (out[level].height + kBandRows - 1u) / kBandRows;
+	}
+	std::vector<std::atomic<uint32_t> > done(firstBand[levels]);
+	for (std::atomic<uint32_t>& flag : done) {
+		flag.store(0u, std::memory_order_relaxed);
+	}
+
+	const auto task = [&](uint32_t band) {
+		uint32_t level = 0u;
+		while (band >= firstBand[level + 1u]) {
+			++level;
+		}
+
+		const SobelPyramidLevel& l = out[level];
+		const float* image = level == 0u ? src : l.image;
+		const uint32_t bytesPerLineImage = level == 0u ? bytesPerLineSrc : l.bytesPerLine;
+		float* next = level + 1u < levels ? out[level + 1u].image : nullptr;
+		const uint32_t bytesPerLineNext = level + 1u < levels ? out[level + 1u].bytesPerLine : 0u;
+		const uint32_t firstRow = (band - firstBand[level]) * kBandRows;
+		const uint32_t lastRow = std::min(firstRow + kBandRows, l.height);
+
+		if (level != 0u) {
+			// Image rows [firstRow - 1, lastRow] clamped, downsampled from rows 2y of the level above
+			const uint32_t first = firstBand[level - 1u] + 2u * (firstRow == 0u ? 0u : firstRow - 1u) / kBandRows;
+			const uint32_t last = firstBand[level - 1u] + 2u * (std::min(lastRow + 1u, l.height) - 1u) / kBandRows;
+			for (uint32_t b = first; b <= last; ++b) {
+				while (done[b].load(std::memory_order_acquire) == 0u) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		pyramid_band(kernels, image, bytesPerLineImage, l, next, bytesPerLineNext, firstRow, lastRow);
+		done[band].store(1u, std::memory_order_release);
+	};
+
+	SobelWorkers& workers = SobelWorkers::shared();
+
+	if (levels == 0u || static_cast<uint64_t>(out[0].width) * out[0].height < kParallelPixels || workers.size() == 1u) {
+		for (uint32_t band = 0u; band < firstBand[levels]; ++band) {
+			task(band);
+		}
+		return;
+	}
+
+	workers.run(firstBand[levels], task);
+}
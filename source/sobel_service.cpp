@@ -0,0 +1,697 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "sobel_service.h"
+#include "sobel_plan.h"
+
+const char* sobel_service_status_string(SobelServiceStatus status) noexcept {
+	switch (status) {
+	case SobelServiceStatus::kOk:
+		return "ok";
+	case SobelServiceStatus::kUnsupported:
+		return "the filter service is not supported on this platform";
+	case SobelServiceStatus::kOpenFailed:
+		return "cannot create or open the shared memory segment";
+	case SobelServiceStatus::kMapFailed:
+		return "cannot size or map the shared memory segment";
+	case SobelServiceStatus::kBadSegment:
+		return "the shared memory segment is not a filter service of this version";
+	case SobelServiceStatus::kInUse:
+		return "another server is running under this name";
+	case SobelServiceStatus::kTooLarge:
+		return "the frame is larger than the service slots";
+	case SobelServiceStatus::kTimeout:
+		return "timed out";
+	case SobelServiceStatus::kServiceDown:
+		return "the server stopped";
+	case SobelServiceStatus::kFailed:
+		return "the server could not filter the frame";
+	}
+	return "unknown";
+}
+
+#if !defined(__linux__)
+
+SobelServer sobel_server_create(const char*, const SobelServerOptions*, SobelServiceStatus* status) noexcept {
+	if (status != nullptr) {
+		*status = SobelServiceStatus::kUnsupported;
+	}
+	return nullptr;
+}
+
+SobelServiceStatus sobel_server_run(SobelServer) noexcept {
+	return SobelServiceStatus::kUnsupported;
+}
+
+void sobel_server_stop(SobelServer) noexcept {
+}
+
+void sobel_server_destroy(SobelServer) noexcept {
+}
+
+SobelClient sobel_client_connect(const char*, SobelServiceStatus* status) noexcept {
+	if (status != nullptr) {
+		*status = SobelServiceStatus::kUnsupported;
+	}
+	return nullptr;
+}
+
+SobelServiceStatus sobel_client_acquire(SobelClient, uint32_t, uint32_t, uint32_t, SobelServiceFrame*) noexcept {
+	return SobelServiceStatus::kUnsupported;
+}
+
+SobelServiceStatus sobel_client_submit(SobelClient, const SobelServiceFrame*) noexcept {
+	return SobelServiceStatus::kUnsupported;
+}
+
+SobelServiceStatus sobel_client_wait(SobelClient, const SobelServiceFrame*, uint32_t) noexcept {
+	return SobelServiceStatus::kUnsupported;
+}
+
+void sobel_client_release(SobelClient, const SobelServiceFrame*) noexcept {
+}
+
+void sobel_client_disconnect(SobelClient) noexcept {
+}
+
+#else
+
+static constexpr uint32_t kMagic = 0x4c424f53u;  // "SOBL"
+static constexpr uint32_t kVersion = 3u;
+static constexpr uint32_t kDefaultSlots = 8u;
+static constexpr uint32_t kDefaultMaxWidth = 1920u;
+static constexpr uint32_t kDefaultMaxHeight = 1080u;
+static constexpr uint32_t kPollMs = 100u;  // Longest sleep between liveness checks
+static constexpr size_t kDataAlign = 4096u;
+static constexpr uint32_t kPlanCache = 8u;  // Frame shapes the server keeps a plan for
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words are plain 32 bit atomics");
+
+// Slot life cycle. A client moves a slot from free to claiming to acquired to
+// submitted, the server from submitted to running to done, or to failed when it
+// cannot filter the frame, and the client back to free. A client releasing a running slot orphans it, and the server frees it when it
+// finishes. The state word carries the owner's pid above the state bits, so a slot
+// never holds a state without its owner and a dead owner's slot can be reclaimed
+// with a single compare exchange. Claiming covers the owner writing the rest of the
+// slot, which disconnect must not read yet.
+enum SlotState : uint32_t {
+	kFree,
+	kClaiming,
+	kAcquired,
+	kSubmitted,
+	kRunning,
+	kDone,
+	kOrphaned,
+	kFailed
+};
+
+static constexpr uint32_t kStateBits = 3u;
+static constexpr uint32_t kStateMask = (1u << kStateBits) - 1u;
+
+static_assert(kFailed <= kStateMask, "slot states fit the state bits");
+static_assert(kStateBits + 22u <= 32u, "pids up to the Linux limit of 2^22 fit above the state bits");
+
+static uint32_t slot_word(uint32_t state, int32_t pid) noexcept {
+	return static_cast<uint32_t>(pid) << kStateBits | state;
+}
+
+static uint32_t slot_state(uint32_t word) noexcept {
+	return word & kStateMask;
+}
+
+static int32_t slot_owner(uint32_t word) noexcept {
+	return static_cast<int32_t>(word >> kStateBits);
+}
+
+struct alignas(64) SegmentHeader {
+	uint32_t magic;         // Written last by the server, once the rest is initialized
+	uint32_t version;
+	uint32_t slots;
+	uint32_t maxWidth;
+	uint32_t maxHeight;
+	int32_t serverPid;
+	uint64_t frameBytes;    // Per buffer, a slot holds a source and a destination buffer
+	uint64_t dataOffset;
+	uint64_t segmentBytes;
+	std::atomic<uint32_t> running;
+	std::atomic<uint32_t> submits;   // Futex word the server sleeps on
+	std::atomic<uint32_t> releases;  // Futex word clients wait on for a free slot
+	std::atomic<uint32_t> clients;   // Client id source
+	std::atomic<uint64_t> tickets;   // Submission order
+};
+
+struct alignas(64) SegmentSlot {
+	std::atomic<uint32_t> state;  // Futex word the owning client waits on, see slot_word
+	std::atomic<uint32_t> ownerId;
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytesPerLine;
+	uint64_t ticket;
+};
+
+struct Segment {
+	uint8_t* base;
+	size_t bytes;
+
+	SegmentHeader* header() const noexcept { return reinterpret_cast<SegmentHeader*>(base); }
+	SegmentSlot* slot(uint32_t i) const noexcept { return &reinterpret_cast<SegmentSlot*>(base + sizeof(SegmentHeader))[i]; }
+
+	float* source(uint32_t i) const noexcept {
+		return reinterpret_cast<float*>(base + header()->dataOffset + 2u * i * header()->frameBytes);
+	}
+
+	float* destination(uint32_t i) const noexcept {
+		return reinterpret_cast<float*>(base + header()->dataOffset + (2u * i + 1u) * header()->frameBytes);
+	}
+};
+
+// A plan for one frame shape, lastUse orders the cache for eviction
+struct CachedPlan {
+	uint32_t width;
+	uint32_t height;
+	uint64_t lastUse;
+	SobelPlan plan;
+};
+
+struct SobelServerData {
+	char name[256];
+	Segment segment;
+	SobelPlanOptions planOptions;
+	CachedPlan plans[kPlanCache];  // Least recently used is replaced, clients pick the shapes
+	uint64_t planUses;
+	std::atomic<uint32_t> stopping;
+};
+
+struct SobelClientData {
+	Segment segment;
+	int32_t pid;
+	uint32_t id;
+};
+
+static uint32_t* futex_word(std::atomic<uint32_t>& word) noexcept {
+	return reinterpret_cast<uint32_t*>(&word);
+}
+
+// Shared (not process private) futexes, the words live in the segment
+static void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, uint32_t timeoutMs) noexcept {
+	const timespec timeout = { static_cast<time_t>(timeoutMs / 1000u), static_cast<long>(timeoutMs % 1000u) * 1000000L };
+	syscall(SYS_futex, futex_word(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t>& word, int count) noexcept {
+	syscall(SYS_futex, futex_word(word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+
+// An exited process stays signalable until its parent reaps it, so a zombie counts as
+// dead: its slots must not wait on how promptly a client's parent calls wait
+static bool process_alive(int32_t pid) noexcept {
+	if (pid <= 0 || (kill(pid, 0) != 0 && errno != EPERM)) {
+		return false;
+	}
+
+	char path[32];
+	char stat[512];
+	snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return true;
+	}
+	const ssize_t bytes = read(fd, stat, sizeof(stat) - 1u);
+	close(fd);
+	if (bytes <= 0) {
+		return true;
+	}
+
+	// "pid (comm) state ...", comm may hold parentheses itself
+	stat[bytes] = '\0';
+	const char* end = strrchr(stat, ')');
+	return end == nullptr || end[1] != ' ' || end[2] != 'Z';
+}
+
+static size_t align_up(size_t value, size_t align) noexcept {
+	return (value + align - 1u) & ~(align - 1u);
+}
+
+static uint32_t frame_bytes_per_line(uint32_t width) noexcept {
+	return (width * static_cast<uint32_t>(sizeof(float)) + 63u) & ~63u;
+}
+
+// Milliseconds left until deadline, 0 once it has passed
+static uint32_t remaining_ms(std::chrono::steady_clock::time_point deadline) noexcept {
+	const int64_t left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+	return left > 0 ? static_cast<uint32_t>(std::min<int64_t>(left, UINT32_MAX)) : 0u;
+}
+
+static void unmap(Segment& segment) noexcept {
+	if (segment.base != nullptr) {
+		munmap(segment.base, segment.bytes);
+		segment.base = nullptr;
+	}
+}
+
+// Maps an existing segment after checking its header
+static SobelServiceStatus map_segment(int fd, Segment& segment) noexcept {
+	struct stat info;
+	if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SegmentHeader)) {
+		return SobelServiceStatus::kBadSegment;
+	}
+
+	segment.bytes = static_cast<size_t>(info.st_size);
+	void* base = mmap(nullptr, segment.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED) {
+		segment.base = nullptr;
+		return SobelServiceStatus::kMapFailed;
+	}
+	segment.base = static_cast<uint8_t*>(base);
+
+	const SegmentHeader* header = segment.header();
+	if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != kMagic || header->version != kVersion || header->segmentBytes != segment.bytes) {
+		unmap(segment);
+		return SobelServiceStatus::kBadSegment;
+	}
+	return SobelServiceStatus::kOk;
+}
+
+static bool server_alive(const SegmentHeader* header) noexcept {
+	return header->running.load(std::memory_order_acquire) != 0u && process_alive(header->serverPid);
+}
+
+// Opens the name exclusively, unlinking a segment whose server is gone
+static int create_exclusive(const char* name, SobelServiceStatus& status) noexcept {
+	for (uint32_t attempt = 0u; attempt < 2u; ++attempt) {
+		const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0 || errno != EEXIST) {
+			status = fd >= 0 ? SobelServiceStatus::kOk : SobelServiceStatus::kOpenFailed;
+			return fd;
+		}
+
+		const int existing = shm_open(name, O_RDWR, 0);
+		if (existing >= 0) {
+			Segment segment = { nullptr, 0u };
+			const bool live = map_segment(existing, segment) == SobelServiceStatus::kOk && server_alive(segment.header());
+			unmap(segment);
+			close(existing);
+			if (live) {
+				status = SobelServiceStatus::kInUse;
+				return -1;
+			}
+		}
+		shm_unlink(name);
+	}
+
+	status = SobelServiceStatus::kOpenFailed;
+	return -1;
+}
+
+SobelServer sobel_server_create(const char* name, const SobelServerOptions* options, SobelServiceStatus* status) noexcept {
+	SobelServiceStatus result = SobelServiceStatus::kOk;
+	SobelServer server = nullptr;
+
+	const uint32_t slots = options != nullptr && options->slots != 0u ? options->slots : kDefaultSlots;
+	const uint32_t maxWidth = options != nullptr && options->maxWidth != 0u ? options->maxWidth : kDefaultMaxWidth;
+	const uint32_t maxHeight = options != nullptr && options->maxHeight != 0u ? options->maxHeight : kDefaultMaxHeight;
+
+	const size_t frameBytes = align_up(static_cast<size_t>(frame_bytes_per_line(maxWidth)) * maxHeight, kDataAlign);
+	const size_t dataOffset = align_up(sizeof(SegmentHeader) + slots * sizeof(SegmentSlot), kDataAlign);
+	const size_t segmentBytes = dataOffset + 2u * slots * frameBytes;
+
+	if (strlen(name) >= sizeof(server->name)) {
+		result = SobelServiceStatus::kOpenFailed;
+	} else {
+		const int fd = create_exclusive(name, result);
+		if (fd >= 0) {
+			void* base = MAP_FAILED;
+			if (ftruncate(fd, static_cast<off_t>(segmentBytes)) == 0) {
+				base = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			}
+			close(fd);
+
+			server = base != MAP_FAILED ? new (std::nothrow) SobelServerData() : nullptr;
+			if (server == nullptr) {
+				if (base != MAP_FAILED) {
+					munmap(base, segmentBytes);
+				}
+				shm_unlink(name);
+				result = SobelServiceStatus::kMapFailed;
+			} else {
+				strcpy(server->name, name);
+				server->segment.base = static_cast<uint8_t*>(base);
+				server->segment.bytes = segmentBytes;
+				server->planOptions.isa = options != nullptr ? options->isa : sobel_detect_isa();
+				server->planOptions.threads = options != nullptr ? options->threads : 0u;
+				server->planOptions.bandRows = 0u;
+				server->stopping.store(0u);
+
+				// The mapping is zero filled, which leaves every slot free
+				SegmentHeader* header = server->segment.header();
+				header->version = kVersion;
+				header->slots = slots;
+				header->maxWidth = maxWidth;
+				header->maxHeight = maxHeight;
+				header->serverPid = static_cast<int32_t>(getpid());
+				header->frameBytes = frameBytes;
+				header->dataOffset = dataOffset;
+				header->segmentBytes = segmentBytes;
+				header->running.store(1u);
+				__atomic_store_n(&header->magic, kMagic, __ATOMIC_RELEASE);
+			}
+		}
+	}
+
+	if (status != nullptr) {
+		*status = result;
+	}
+	return server;
+}
+
+// Oldest submitted slot, or the slot count when there is none
+static uint32_t next_submitted(const Segment& segment) noexcept {
+	const SegmentHeader* header = segment.header();
+	uint32_t best = header->slots;
+	uint64_t bestTicket = UINT64_MAX;
+
+	for (uint32_t i = 0u; i < header->slots; ++i) {
+		const SegmentSlot* slot = segment.slot(i);
+		if (slot_state(slot->state.load(std::memory_order_acquire)) == kSubmitted && slot->ticket < bestTicket) {
+			best = i;
+			bestTicket = slot->ticket;
+		}
+	}
+	return best;
+}
+
+// Cached plan for a frame shape, creating it in place of the least recently used one
+static SobelPlan server_plan(SobelServer server, uint32_t width, uint32_t height, uint32_t bytesPerLine) noexcept {
+	CachedPlan* entry = &server->plans[0];
+	for (CachedPlan& cached : server->plans) {
+		if (cached.lastUse != 0u && cached.width == width && cached.height == height) {
+			entry = &cached;
+			break;
+		}
+		if (cached.lastUse < entry->lastUse) {
+			entry = &cached;
+		}
+	}
+
+	if (entry->lastUse == 0u || entry->width != width || entry->height != height) {
+		sobel_plan_destroy(entry->plan);
+		entry->width = width;
+		entry->height = height;
+		entry->plan = sobel_plan_create(width, height, bytesPerLine, bytesPerLine, SobelFormat::kFloat32, SobelFormat::kFloat32, &server->planOptions);
+	}
+	entry->lastUse = ++server->planUses;
+	return entry->plan;
+}
+
+static void serve(SobelServer server, uint32_t index) noexcept {
+	const Segment& segment = server->segment;
+	const SegmentHeader* header = segment.header();
+	SegmentSlot* slot = segment.slot(index);
+
+	uint32_t expected = slot->state.load(std::memory_order_acquire);
+	const int32_t owner = slot_owner(expected);
+	if (slot_state(expected) != kSubmitted || !slot->state.compare_exchange_strong(expected, slot_word(kRunning, owner), std::memory_order_acq_rel)) {
+		return;  // Released by its client in the meantime
+	}
+
+	// The slot fields come from another process, nothing outside the slot's buffers may be touched
+	const uint32_t width = slot->width;
+	const uint32_t height = slot->height;
+	const uint32_t bytesPerLine = slot->bytesPerLine;
+	const bool valid = width != 0u && height != 0u && width <= header->maxWidth && height <= header->maxHeight && bytesPerLine == frame_bytes_per_line(width);
+
+	const SobelPlan plan = valid ? server_plan(server, width, height, bytesPerLine) : nullptr;
+	if (plan != nullptr) {
+		sobel_plan_execute(plan, segment.source(index), segment.destination(index));
+	}
+
+	expected = slot_word(kRunning, owner);
+	if (!slot->state.compare_exchange_strong(expected, slot_word(plan != nullptr ? kDone : kFailed, owner), std::memory_order_acq_rel)) {
+		slot->state.store(slot_word(kFree, 0), std::memory_order_release);
+		segment.header()->releases.fetch_add(1u, std::memory_order_release);
+		futex_wake(segment.header()->releases, INT_MAX);
+		return;
+	}
+	futex_wake(slot->state, INT_MAX);
+}
+
+SobelServiceStatus sobel_server_run(SobelServer server) noexcept {
+	SegmentHeader* header = server->segment.header();
+
+	while (server->stopping.load(std::memory_order_acquire) == 0u) {
+		const uint32_t submits = header->submits.load(std::memory_order_acquire);
+		const uint32_t index = next_submitted(server->segment);
+		if (index == header->slots) {
+			futex_wait(header->submits, submits, kPollMs);
+			continue;
+		}
+		serve(server, index);
+	}
+	return SobelServiceStatus::kOk;
+}
+
+void sobel_server_stop(SobelServer server) noexcept {
+	server->stopping.store(1u, std::memory_order_release);
+	server->segment.header()->submits.fetch_add(1u, std::memory_order_release);
+	futex_wake(server->segment.header()->submits, INT_MAX);
+}
+
+void sobel_server_destroy(SobelServer server) noexcept {
+	if (server == nullptr) {
+		return;
+	}
+
+	SegmentHeader* header = server->segment.header();
+	header->running.store(0u, std::memory_order_release);
+	for (uint32_t i = 0u; i < header->slots; ++i) {
+		futex_wake(server->segment.slot(i)->state, INT_MAX);
+	}
+	futex_wake(header->releases, INT_MAX);
+
+	for (const CachedPlan& cached : server->plans) {
+		sobel_plan_destroy(cached.plan);
+	}
+
+	unmap(server->segment);
+	shm_unlink(server->name);
+	delete server;
+}
+
+SobelClient sobel_client_connect(const char* name, SobelServiceStatus* status) noexcept {
+	SobelServiceStatus result = SobelServiceStatus::kOk;
+	SobelClient client = nullptr;
+
+	const int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0) {
+		result = SobelServiceStatus::kOpenFailed;
+	} else {
+		Segment segment = { nullptr, 0u };
+		result = map_segment(fd, segment);
+		close(fd);
+
+		if (result == SobelServiceStatus::kOk && !server_alive(segment.header())) {
+			result = SobelServiceStatus::kServiceDown;
+		}
+		if (result == SobelServiceStatus::kOk) {
+			client = new (std::nothrow) SobelClientData();
+			if (client == nullptr) {
+				result = SobelServiceStatus::kMapFailed;
+			}
+		}
+
+		if (client != nullptr) {
+			client->segment = segment;
+			client->pid = static_cast<int32_t>(getpid());
+			client->id = segment.header()->clients.fetch_add(1u, std::memory_order_relaxed) + 1u;
+		} else {
+			unmap(segment);
+		}
+	}
+
+	if (status != nullptr) {
+		*status = result;
+	}
+	return client;
+}
+
+// Frees slots left claiming, acquired, done or failed by clients whose process has
+// exited. Submitted and running slots come back as done or failed and are freed on a
+// later pass.
+static void reclaim(const Segment& segment) noexcept {
+	const SegmentHeader* header = segment.header();
+	for (uint32_t i = 0u; i < header->slots; ++i) {
+		SegmentSlot* slot = segment.slot(i);
+		uint32_t word = slot->state.load(std::memory_order_acquire);
+		const uint32_t state = slot_state(word);
+		if ((state == kClaiming || state == kAcquired || state == kDone || state == kFailed) && !process_alive(slot_owner(word))) {
+			slot->state.compare_exchange_strong(word, slot_word(kFree, 0), std::memory_order_acq_rel);
+		}
+	}
+}
+
+static bool try_acquire(SobelClient client, uint32_t width, uint32_t height, SobelServiceFrame* frame) noexcept {
+	const Segment& segment = client->segment;
+	const SegmentHeader* header = segment.header();
+
+	for (uint32_t i = 0u; i < header->slots; ++i) {
+		SegmentSlot* slot = segment.slot(i);
+		uint32_t expected = slot_word(kFree, 0);
+		if (slot->state.load(std::memory_order_relaxed) == expected && slot->state.compare_exchange_strong(expected, slot_word(kClaiming, client->pid), std::memory_order_acq_rel)) {
+			slot->ownerId.store(client->id, std::memory_order_relaxed);
+			slot->width = width;
+			slot->height = height;
+			slot->bytesPerLine = frame_bytes_per_line(width);
+			slot->state.store(slot_word(kAcquired, client->pid), std::memory_order_release);
+
+			frame->slot = i;
+			frame->width = width;
+			frame->height = height;
+			frame->bytesPerLine = slot->bytesPerLine;
+			frame->src = segment.source(i);
+			frame->dst = segment.destination(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+SobelServiceStatus sobel_client_acquire(SobelClient client, uint32_t width, uint32_t height, uint32_t timeoutMs, SobelServiceFrame* frame) noexcept {
+	SegmentHeader* header = client->segment.header();
+	if (width == 0u || height == 0u || width > header->maxWidth || height > header->maxHeight) {
+		return SobelServiceStatus::kTooLarge;
+	}
+
+	const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	for (;;) {
+		const uint32_t releases = header->releases.load(std::memory_order_acquire);
+		if (try_acquire(client, width, height, frame)) {
+			return SobelServiceStatus::kOk;
+		}
+
+		reclaim(client->segment);
+		if (try_acquire(client, width, height, frame)) {
+			return SobelServiceStatus::kOk;
+		}
+
+		if (!server_alive(header)) {
+			return SobelServiceStatus::kServiceDown;
+		}
+		const uint32_t left = remaining_ms(deadline);
+		if (left == 0u) {
+			return SobelServiceStatus::kTimeout;
+		}
+		futex_wait(header->releases, releases, std::min(left, kPollMs));
+	}
+}
+
+SobelServiceStatus sobel_client_submit(SobelClient client, const SobelServiceFrame* frame) noexcept {
+	SegmentHeader* header = client->segment.header();
+	SegmentSlot* slot = client->segment.slot(frame->slot);
+
+	if (!server_alive(header)) {
+		return SobelServiceStatus::kServiceDown;
+	}
+
+	slot->ticket = header->tickets.fetch_add(1u, std::memory_order_relaxed);
+	slot->state.store(slot_word(kSubmitted, client->pid), std::memory_order_release);
+	header->submits.fetch_add(1u, std::memory_order_release);
+	futex_wake(header->submits, 1);
+	return SobelServiceStatus::kOk;
+}
+
+SobelServiceStatus sobel_client_wait(SobelClient client, const SobelServiceFrame* frame, uint32_t timeoutMs) noexcept {
+	const SegmentHeader* header = client->segment.header();
+	SegmentSlot* slot = client->segment.slot(frame->slot);
+
+	const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	for (;;) {
+		const uint32_t word = slot->state.load(std::memory_order_acquire);
+		if (slot_state(word) == kDone) {
+			return SobelServiceStatus::kOk;
+		}
+		if (slot_state(word) == kFailed) {
+			return SobelServiceStatus::kFailed;
+		}
+		if (!server_alive(header)) {
+			return SobelServiceStatus::kServiceDown;
+		}
+
+		const uint32_t left = remaining_ms(deadline);
+		if (left == 0u) {
+			return SobelServiceStatus::kTimeout;
+		}
+		futex_wait(slot->state, word, std::min(left, kPollMs));
+	}
+}
+
+// Frees an acquired, submitted, done or failed slot of pid and orphans a running one
+static void release_slot(const Segment& segment, uint32_t index, int32_t pid) noexcept {
+	SegmentHeader* header = segment.header();
+	SegmentSlot* slot = segment.slot(index);
+
+	uint32_t word = slot->state.load(std::memory_order_acquire);
+	for (;;) {
+		const uint32_t state = slot_state(word);
+		const uint32_t next = state == kRunning ? slot_word(kOrphaned, pid) : slot_word(kFree, 0);
+		if (slot_owner(word) != pid || state == kFree || state == kClaiming || state == kOrphaned || slot->state.compare_exchange_weak(word, next, std::memory_order_acq_rel)) {
+			break;
+		}
+	}
+
+	header->releases.fetch_add(1u, std::memory_order_release);
+	futex_wake(header->releases, INT_MAX);
+}
+
+void sobel_client_release(SobelClient client, const SobelServiceFrame* frame) noexcept {
+	release_slot(client->segment, frame->slot, client->pid);
+}
+
+void sobel_client_disconnect(SobelClient client) noexcept {
+	if (client == nullptr) {
+		return;
+	}
+
+	const Segment& segment = client->segment;
+	for (uint32_t i = 0u; i < segment.header()->slots; ++i) {
+		const SegmentSlot* slot = segment.slot(i);
+		const uint32_t word = slot->state.load(std::memory_order_acquire);
+		const uint32_t state = slot_state(word);
+		if (state != kFree && state != kClaiming && state != kOrphaned && slot_owner(word) == client->pid && slot->ownerId.load(std::memory_order_relaxed) == client->id) {
+			release_slot(segment, i, client->pid);
+		}
+	}
+
+	unmap(client->segment);
+	delete client;
+}
+
+#endif
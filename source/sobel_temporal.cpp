@@ -0,0 +1,147 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "sobel_engine.h"
+#include "sobel_internal.h"
+#include "sobel_temporal.h"
+#include "sobel_workers.h"
+
+static constexpr uint32_t kMinBandRows = 32u;
+static constexpr uint64_t kParallelPixels = 1u << 16;  // Smaller frames run on the caller alone
+static constexpr uintptr_t kScratchAlignment = 64u;
+
+static inline SobelIsa temporal_isa(SobelIsa isa) noexcept {
+	return sobel_resolve_isa(isa);
+}
+
+static inline float* align_scratch(float* ptr) noexcept {
+	return reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(ptr) + kScratchAlignment - 1u) & ~(kScratchAlignment - 1u));
+}
+
+// Number of tasks the bands of a frame are shared between
+static inline uint32_t temporal_tasks(uint32_t width, uint32_t height, uint32_t& bandRows, uint32_t& bands) noexcept {
+	SobelWorkers& workers = SobelWorkers::shared();
+	const bool parallel = static_cast<uint64_t>(width) * height >= kParallelPixels;
+	bandRows = parallel ? std::max((height + workers.size() - 1u) / workers.size(), kMinBandRows) : height;
+	bands = (height + bandRows - 1u) / bandRows;
+	return parallel ? std::min(workers.size(), bands) : 1u;
+}
+
+static inline void temporal_run(uint32_t tasks, const std::function<void(uint32_t)>& task) noexcept {
+	if (tasks == 1u) {
+		task(0u);
+	} else {
+		SobelWorkers::shared().run(tasks, task);
+	}
+}
+
+void sobel_temporal(const float* prev, const float* curr, const float* next, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, const SobelTemporalOutput* output, SobelIsa isa) noexcept {
+	if (width == 0u || height == 0u) {
+		return;
+	}
+
+	const SobelKernels& kernels = sobel_kernels(temporal_isa(isa));
+	const SobelTemporalSource source = { { prev, curr, next }, { nullptr, nullptr, nullptr }, { nullptr, nullptr, nullptr }, { nullptr, nullptr }, bytesPerLineSrc, 0u };
+
+	uint32_t bandRows;
+	uint32_t bands;
+	const uint32_t tasks = temporal_tasks(width, height, bandRows, bands);
+
+	auto task = [&](uint32_t index) {
+		std::vector<float> scratch(kEngineTemporalRows * static_cast<size_t>(engine_temporal_stride(width)) + kScratchAlignment / sizeof(float));
+		float* aligned = align_scratch(scratch.data());
+
+		for (uint32_t band = index; band < bands; band += tasks) {
+			const uint32_t firstRow = band * bandRows;
+			kernels.temporal(&source, output, width, height, firstRow, std::min(firstRow + bandRows, height), aligned);
+		}
+	};
+	temporal_run(tasks, task);
+}
+
+SobelTemporal::SobelTemporal(uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, SobelIsa isa) :
+	width(width),
+	height(height),
+	bytesPerLineSrc(bytesPerLineSrc),
+	isa(temporal_isa(isa)),
+	bytesPerLineSums(engine_temporal_stride(width) * static_cast<uint32_t>(sizeof(float))),
+	scratchCount(SobelWorkers::shared().size()),
+	pushed(0u) {
+	// Six planes of sums, then one block of scratch rows per task
+	const size_t stride = engine_temporal_stride(width);
+	const size_t plane = stride * height;
+	const size_t scratchRows = kEngineTemporalRows * stride;
+	storage.resize(6u * plane + scratchCount * scratchRows + kScratchAlignment / sizeof(float));
+
+	float* base = align_scratch(storage.data());
+	for (uint32_t t = 0u; t < 3u; ++t) {
+		smooth[t] = &base[(2u * t) * plane];
+		derivative[t] = &base[(2u * t + 1u) * plane];
+	}
+	scratch = &base[6u * plane];
+}
+
+bool SobelTemporal::push(const float* frame, const SobelTemporalOutput* output) noexcept {
+	if (width == 0u || height == 0u) {
+		return false;
+	}
+
+	const SobelKernels& kernels = sobel_kernels(isa);
+	const uint32_t slot = static_cast<uint32_t>(pushed % 3u);
+	const bool ready = ++pushed >= 3u;
+
+	// The two frames before this one come from their cached sums, the new frame is
+	// reduced in the same sweep and its sums stored to slot for the next two pushes
+	SobelTemporalSource source;
+	for (uint32_t t = 0u; t < 2u; ++t) {
+		const uint32_t ring = (slot + 1u + t) % 3u;
+		source.frames[t] = nullptr;
+		source.smooth[t] = smooth[ring];
+		source.derivative[t] = derivative[ring];
+	}
+	source.frames[2] = frame;
+	source.smooth[2] = nullptr;
+	source.derivative[2] = nullptr;
+	source.store[0] = smooth[slot];
+	source.store[1] = derivative[slot];
+	source.bytesPerLine = bytesPerLineSrc;
+	source.bytesPerLineSums = bytesPerLineSums;
+
+	uint32_t bandRows;
+	uint32_t bands;
+	const uint32_t tasks = std::min(temporal_tasks(width, height, bandRows, bands), scratchCount);
+	const size_t scratchRows = kEngineTemporalRows * static_cast<size_t>(engine_temporal_stride(width));
+
+	auto task = [&](uint32_t index) {
+		float* rows = &scratch[index * scratchRows];
+
+		for (uint32_t band = index; band < bands; band += tasks) {
+			const uint32_t firstRow = band * bandRows;
+			const uint32_t lastRow = std::min(firstRow + bandRows, height);
+			if (ready) {
+				kernels.temporal(&source, output, width, height, firstRow, lastRow, rows);
+			} else {
+				kernels.temporalSums(frame, smooth[slot], derivative[slot], width, height, bytesPerLineSrc, bytesPerLineSums, firstRow, lastRow);
+			}
+		}
+	};
+	temporal_run(tasks, task);
+	return ready;
+}
+
+void SobelTemporal::reset() noexcept {
+	pushed = 0u;
+}
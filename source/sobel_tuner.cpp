@@ -0,0 +1,233 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sobel_tuner.h"
+#include "sobel_internal.h"
+#include "sobel_workers.h"
+
+static constexpr uint32_t kBandCandidates[] = { 16u, 64u, 256u };
+static constexpr uint32_t kRepetitions = 3u;  // Best of, after one warm up run
+
+struct TunerState {
+	std::mutex lock;
+	std::map<std::pair<uint32_t, uint32_t>, SobelTuning> tunings;
+	std::string cachePath;
+	std::string model;
+	bool loaded;
+
+	TunerState() : loaded(false) {
+		const char* path = getenv("SOBEL_TUNE_CACHE");
+		const char* home = getenv("HOME");
+		if (path != nullptr) {
+			cachePath = path;
+		} else if (home != nullptr) {
+			cachePath = std::string(home) + "/.sobel_tune";
+		}
+
+		char brand[49];
+		sobel_cpu_model(brand);
+		model = brand;
+		// Tabs separate the cache fields
+		std::replace(model.begin(), model.end(), '\t', ' ');
+	}
+};
+
+static TunerState& tuner_state() noexcept {
+	static TunerState state;
+	return state;
+}
+
+static uint32_t isa_alignment(SobelIsa isa) noexcept {
+	static constexpr uint32_t kAlignments[] = { sizeof(float), 16u, 32u, 64u, 32u };
+	return kAlignments[static_cast<uint32_t>(isa)];
+}
+
+// Runs the bands of one image, each of the tasks takes every tasks-th band
+static void run_tuned(const SobelTuning& tuning, const float* src, float* dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	const SobelKernels& kernels = sobel_kernels(tuning.isa);
+	const SobelRowsFn rows = tuning.streaming ? kernels.rowsStream : kernels.rows;
+	const uint32_t bands = (height + tuning.bandRows - 1u) / tuning.bandRows;
+	const uint32_t tasks = std::min(tuning.threads, bands);
+
+	SobelWorkers::shared().run(tasks, [&](uint32_t task) {
+		for (uint32_t band = task; band < bands; band += tasks) {
+			const uint32_t firstRow = band * tuning.bandRows;
+			rows(src, dst, width, height, bytesPerLineSrc, bytesPerLineDst, firstRow, std::min(firstRow + tuning.bandRows, height));
+		}
+	});
+}
+
+static SobelTuning benchmark(uint32_t width, uint32_t height) noexcept {
+	const uint32_t bytesPerLine = (width * static_cast<uint32_t>(sizeof(float)) + 63u) & ~63u;
+	const size_t count = static_cast<size_t>(bytesPerLine / sizeof(float)) * height;
+	std::vector<float> buffer(2u * count + 16u);
+	float* src = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(buffer.data()) + 63u) & ~static_cast<uintptr_t>(63u));
+	float* dst = src + count;
+
+	for (size_t i = 0u; i < count; ++i) {
+		src[i] = static_cast<float>((i * 2654435761u) >> 24);
+	}
+
+	const SobelIsa detected = sobel_detect_isa();
+	const uint32_t poolSize = SobelWorkers::shared().size();
+
+	std::vector<uint32_t> threadCandidates;
+	for (uint32_t threads = 1u; threads < poolSize; threads *= 2u) {
+		threadCandidates.push_back(threads);
+	}
+	threadCandidates.push_back(poolSize);
+
+	SobelTuning best = { detected, 64u, poolSize, false, 0.0 };
+	double bestSeconds = 0.0;
+
+	// Every tier the host runs competes, kAvx512Vl included, and the scalar tier only where nothing else is available
+	for (uint32_t isa = detected == SobelIsa::kScalar ? 0u : 1u; isa <= static_cast<uint32_t>(SobelIsa::kAvx512Vl); ++isa) {
+		if (!sobel_isa_supported(static_cast<SobelIsa>(isa))) {
+			continue;
+		}
+		for (uint32_t bandRows : kBandCandidates) {
+			for (uint32_t threads : threadCandidates) {
+				for (uint32_t streaming = 0u; streaming < (isa == 0u ? 1u : 2u); ++streaming) {
+					const SobelTuning candidate = { static_cast<SobelIsa>(isa), bandRows, threads, streaming != 0u, 0.0 };
+					double seconds = 0.0;
+
+					for (uint32_t rep = 0u; rep <= kRepetitions; ++rep) {
+						const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+						run_tuned(candidate, src, dst, width, height, bytesPerLine, bytesPerLine);
+						const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+						if (rep == 1u || (rep > 1u && elapsed < seconds)) {
+							seconds = elapsed;
+						}
+					}
+
+					if (bestSeconds == 0.0 || seconds < bestSeconds) {
+						best = candidate;
+						bestSeconds = seconds;
+					}
+				}
+			}
+		}
+	}
+
+	best.megapixelsPerSecond = bestSeconds > 0.0 ? static_cast<double>(width) * height / bestSeconds * 1e-6 : 0.0;
+	return best;
+}
+
+// Cache lines are model, width, height, isa, band rows, threads, streaming and Mpix/s separated by tabs
+static void load_cache(TunerState& state) noexcept {
+	state.loaded = true;
+	FILE* file = state.cachePath.empty() ? nullptr : fopen(state.cachePath.c_str(), "r");
+	if (file == nullptr) {
+		return;
+	}
+
+	char line[256];
+
+	while (fgets(line, sizeof(line), file) != nullptr) {
+		char* fields = strchr(line, '\t');
+		if (fields == nullptr || static_cast<size_t>(fields - line) != state.model.size() || strncmp(line, state.model.c_str(), state.model.size()) != 0) {
+			continue;
+		}
+
+		unsigned width;
+		unsigned height;
+		char isaName[16];
+		unsigned bandRows;
+		unsigned threads;
+		unsigned streaming;
+		double mpix;
+		if (sscanf(fields, "\t%u\t%u\t%15s\t%u\t%u\t%u\t%lf", &width, &height, isaName, &bandRows, &threads, &streaming, &mpix) != 7 || bandRows == 0u || threads == 0u) {
+			continue;
+		}
+
+		SobelIsa isa;
+		if (sobel_isa_parse(isaName, &isa) && sobel_isa_supported(isa)) {
+			const SobelTuning tuning = { isa, bandRows, threads, streaming != 0u, mpix };
+			state.tunings[std::make_pair(width, height)] = tuning;
+		}
+	}
+
+	fclose(file);
+}
+
+static void save_cache(const TunerState& state, uint32_t width, uint32_t height, const SobelTuning& tuning) noexcept {
+	FILE* file = state.cachePath.empty() ? nullptr : fopen(state.cachePath.c_str(), "a");
+	if (file == nullptr) {
+		return;
+	}
+
+	fprintf(file, "%s\t%u\t%u\t%s\t%u\t%u\t%u\t%.1f\n", state.model.c_str(), width, height, sobel_isa_name(tuning.isa),
+		tuning.bandRows, tuning.threads, tuning.streaming ? 1u : 0u, tuning.megapixelsPerSecond);
+	fclose(file);
+}
+
+SobelTuning sobel_tune(uint32_t width, uint32_t height) noexcept {
+	TunerState& state = tuner_state();
+	const std::pair<uint32_t, uint32_t> key(width, height);
+
+	{
+		std::lock_guard<std::mutex> guard(state.lock);
+		if (!state.loaded) {
+			load_cache(state);
+		}
+
+		const std::map<std::pair<uint32_t, uint32_t>, SobelTuning>::const_iterator it = state.tunings.find(key);
+		if (it != state.tunings.end()) {
+			return it->second;
+		}
+	}
+
+	// Benchmarked without the lock, so callers of tuned shapes never wait for it. Threads
+	// tuning the same shape at once each measure it, and the first to finish is kept.
+	const SobelTuning tuning = benchmark(width, height);
+
+	std::lock_guard<std::mutex> guard(state.lock);
+	if (!state.loaded) {
+		load_cache(state);
+	}
+
+	const std::pair<std::map<std::pair<uint32_t, uint32_t>, SobelTuning>::iterator, bool> inserted = state.tunings.insert(std::make_pair(key, tuning));
+	if (inserted.second) {
+		save_cache(state, width, height, tuning);
+	}
+	return inserted.first->second;
+}
+
+void sobel_tune_cache_path(const char* path) noexcept {
+	TunerState& state = tuner_state();
+	std::lock_guard<std::mutex> guard(state.lock);
+
+	state.cachePath = path != nullptr ? path : "";
+	state.loaded = false;
+}
+
+void sobel_filter_tuned(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) noexcept {
+	SobelTuning tuning = sobel_tune(width, height);
+
+	const uintptr_t bits = reinterpret_cast<uintptr_t>(src) | reinterpret_cast<uintptr_t>(dst) | bytesPerLineSrc | bytesPerLineDst;
+	while (tuning.isa != SobelIsa::kScalar && (bits & (isa_alignment(tuning.isa) - 1u)) != 0u) {
+		tuning.isa = sobel_resolve_isa(sobel_isa_lower(tuning.isa));
+	}
+
+	run_tuned(tuning, src, dst, width, height, bytesPerLineSrc, bytesPerLineDst);
+}
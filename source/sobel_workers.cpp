@@ -0,0 +1,157 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include "sobel_workers.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+SobelWorkers::SobelWorkers(uint32_t threadCount) : callers(1u), stopping(false) {
+	for (uint32_t i = 1u; i < threadCount; ++i) {
+		threads.emplace_back(&SobelWorkers::work, this, int64_t(-1));
+	}
+}
+
+SobelWorkers::SobelWorkers(const std::vector<uint32_t>& cpus) : callers(0u), stopping(false) {
+	for (uint32_t cpu : cpus) {
+		threads.emplace_back(&SobelWorkers::work, this, static_cast<int64_t>(cpu));
+	}
+}
+
+SobelWorkers::~SobelWorkers() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wakeup.notify_all();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+SobelWorkers& SobelWorkers::shared() noexcept {
+	static SobelWorkers workers(std::max(2u, std::thread::hardware_concurrency()));
+	return workers;
+}
+
+uint32_t SobelWorkers::size() const noexcept {
+	return std::max(static_cast<uint32_t>(threads.size()) + callers, 1u);
+}
+
+void SobelWorkers::drain(Batch& batch) noexcept {
+	for (uint32_t i = batch.next++; i < batch.count; i = batch.next++) {
+		(*batch.task)(i);
+
+		if (++batch.done == batch.count) {
+			std::lock_guard<std::mutex> guard(lock);
+			finished.notify_all();
+		}
+	}
+}
+
+void SobelWorkers::work(int64_t cpu) noexcept {
+#if defined(__linux__)
+	if (cpu >= 0 && cpu < CPU_SETSIZE) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(static_cast<int>(cpu), &set);
+		sched_setaffinity(0, sizeof(set), &set);
+	}
+#else
+	(void)cpu;
+#endif
+
+	for (;;) {
+		std::shared_ptr<Batch> batch;
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wakeup.wait(guard, [this] { return stopping || !batches.empty() || !jobs.empty(); });
+			if (!batches.empty()) {
+				batch = batches.front();
+				if (batch->next >= batch->count) {
+					// Fully claimed, the owner waits for the remaining tasks
+					batches.pop_front();
+					continue;
+				}
+			} else if (!jobs.empty()) {
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			} else {
+				return;
+			}
+		}
+
+		if (batch) {
+			drain(*batch);
+		} else {
+			// Nobody waits on a posted job, so an exception escaping it has nowhere to go.
+			// Dropping it keeps the worker alive instead of terminating the process.
+			try {
+				job();
+			} catch (...) {
+			}
+		}
+	}
+}
+
+void SobelWorkers::run(uint32_t count, const std::function<void(uint32_t)>& task) noexcept {
+	if (count == 0u) {
+		return;
+	}
+
+	if (count == 1u || threads.empty()) {
+		for (uint32_t i = 0u; i < count; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+	batch->task = &task;
+	batch->count = count;
+	batch->next = 0u;
+	batch->done = 0u;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		batches.push_back(batch);
+	}
+	wakeup.notify_all();
+
+	drain(*batch);
+
+	std::unique_lock<std::mutex> guard(lock);
+	finished.wait(guard, [&batch] { return batch->done == batch->count; });
+
+	const auto it = std::find(batches.begin(), batches.end(), batch);
+	if (it != batches.end()) {
+		batches.erase(it);
+	}
+}
+
+void SobelWorkers::post(std::function<void()> job) {
+	if (threads.empty()) {
+		job();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		jobs.push_back(std::move(job));
+	}
+	wakeup.notify_one();
+}
@@ -0,0 +1,74 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The library's worker threads. Batches of indexed tasks are shared between the
+// workers and the calling thread, which takes part in its own batch so that a
+// task may itself run a nested batch without starving the pool. Posted jobs run
+// on the workers alone, after any pending batch work.
+class SobelWorkers {
+public:
+	explicit SobelWorkers(uint32_t threadCount);
+
+	// One worker pinned to each of cpus, where the platform supports affinity. Run batches
+	// from a job posted to the pool, so the calling thread is itself one of the pinned
+	// workers. A run() from any other thread still works but that thread is not pinned.
+	explicit SobelWorkers(const std::vector<uint32_t>& cpus);
+	~SobelWorkers();
+
+	SobelWorkers(const SobelWorkers&) = delete;
+	SobelWorkers& operator=(const SobelWorkers&) = delete;
+
+	// Pool sized to the hardware concurrency with at least one worker, created on first use
+	static SobelWorkers& shared() noexcept;
+
+	// Number of threads working on a batch: the workers and the caller, or for a pinned
+	// pool the workers alone since the caller is one of them
+	uint32_t size() const noexcept;
+
+	// Runs task(i) for every i in [0, count) and returns when all calls have finished
+	void run(uint32_t count, const std::function<void(uint32_t)>& task) noexcept;
+
+	// Queues job for a worker and returns immediately, pending jobs finish before the pool is destroyed.
+	// job must not throw: an exception escaping it is caught and dropped.
+	void post(std::function<void()> job);
+
+private:
+	struct Batch {
+		const std::function<void(uint32_t)>* task;
+		uint32_t count;
+		std::atomic<uint32_t> next;
+		std::atomic<uint32_t> done;
+	};
+
+	void work(int64_t cpu) noexcept;
+	void drain(Batch& batch) noexcept;
+
+	std::mutex lock;
+	std::condition_variable wakeup;
+	std::condition_variable finished;
+	std::deque<std::shared_ptr<Batch> > batches;
+	std::deque<std::function<void()> > jobs;
+	std::vector<std::thread> threads;
+	uint32_t callers;  // Threads outside the pool counted by size()
+	bool stopping;
+};
@@ -0,0 +1,184 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "sobel_filter.h"
+
+// Shared helpers of the feature tests. Every test is one executable that returns
+// test_result(), checks print the first failures and keep counting the rest.
+
+static uint32_t gTestFailures = 0u;
+
+#define TEST_CHECK(condition, ...) \
+	do { \
+		if (!(condition)) { \
+			if (++gTestFailures <= 20u) { \
+				fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+				fprintf(stderr, __VA_ARGS__); \
+				fputc('\n', stderr); \
+			} \
+		} \
+	} while (false)
+
+static inline int test_result() noexcept {
+	if (gTestFailures != 0u) {
+		fprintf(stderr, "%u checks failed\n", gTestFailures);
+		return 1;
+	}
+	return 0;
+}
+
+// Byte written to every padding byte, checked again after a call
+static constexpr uint8_t kTestGuard = 0xA5u;
+
+// Image with 64 byte aligned rows. padding adds that many bytes past the 64 byte
+// rounded row, so odd strides exercise the bytesPerLine arithmetic of the kernels.
+template <typename T>
+class TestImage {
+public:
+	TestImage(uint32_t width, uint32_t height, uint32_t padding = 0u)
+		: width(width), height(height), bytesPerLine((width * static_cast<uint32_t>(sizeof(T)) + 63u) / 64u * 64u + padding) {
+		data = static_cast<uint8_t*>(aligned_alloc(64u, size()));
+		if (data == nullptr) {
+			fprintf(stderr, "out of memory for a %ux%u image\n", width, height);
+			exit(2);
+		}
+		memset(data, kTestGuard, size());
+	}
+
+	~TestImage() {
+		free(data);
+	}
+
+	TestImage(const TestImage&) = delete;
+	TestImage& operator=(const TestImage&) = delete;
+
+	size_t size() const noexcept {
+		return (static_cast<size_t>(bytesPerLine) * height + 63u) / 64u * 64u;
+	}
+
+	T* pixels() noexcept {
+		return reinterpret_cast<T*>(data);
+	}
+
+	const T* pixels() const noexcept {
+		return reinterpret_cast<const T*>(data);
+	}
+
+	T* row(uint32_t y) noexcept {
+		return reinterpret_cast<T*>(data + static_cast<size_t>(y) * bytesPerLine);
+	}
+
+	const T* row(uint32_t y) const noexcept {
+		return reinterpret_cast<const T*>(data + static_cast<size_t>(y) * bytesPerLine);
+	}
+
+	// Deterministic pseudo random pixels in [0, scale)
+	void fill(uint32_t seed, double scale = 1.0) noexcept {
+		uint32_t state = seed * 2654435761u + 1u;
+		for (uint32_t y = 0u; y < height; ++y) {
+			for (uint32_t x = 0u; x < width; ++x) {
+				state = state * 1664525u + 1013904223u;
+				row(y)[x] = static_cast<T>((state >> 8) * (scale / 16777216.0));
+			}
+		}
+	}
+
+	// True when no byte past width in any row, nor past the last row, was written
+	bool guard_intact() const noexcept {
+		const size_t rowBytes = static_cast<size_t>(width) * sizeof(T);
+		for (size_t i = 0u; i < size(); ++i) {
+			const size_t y = i / bytesPerLine;
+			if ((y >= height || i % bytesPerLine >= rowBytes) && data[i] != kTestGuard) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const uint32_t width;
+	const uint32_t height;
+	const uint32_t bytesPerLine;
+
+private:
+	uint8_t* data;
+};
+
+struct TestShape {
+	uint32_t width;
+	uint32_t height;
+};
+
+// Odd and tiny shapes around every SIMD block width, plus a few wider ones
+static const TestShape kTestShapes[] = {
+	{ 1u, 1u }, { 1u, 7u }, { 7u, 1u }, { 2u, 2u }, { 3u, 3u }, { 5u, 4u }, { 4u, 9u },
+	{ 8u, 3u }, { 9u, 5u }, { 15u, 2u }, { 16u, 6u }, { 17u, 3u }, { 23u, 7u }, { 31u, 5u },
+	{ 32u, 4u }, { 33u, 9u }, { 47u, 11u }, { 64u, 3u }, { 65u, 13u }, { 129u, 17u }, { 257u, 5u }
+};
+
+// Row paddings applied to every shape: dense, one odd float, half a cache line and one
+// odd cache line. A tier only takes the strides test_stride_ok allows.
+static const uint32_t kTestPaddings[] = { 0u, 4u, 32u, 68u };
+
+// Tiers the host can run, the scalar reference first
+static inline std::vector<SobelIsa> test_isas() {
+	std::vector<SobelIsa> isas;
+	for (uint32_t isa = 0u; isa <= static_cast<uint32_t>(SobelIsa::kAvx512Vl); ++isa) {
+		if (sobel_isa_supported(static_cast<SobelIsa>(isa))) {
+			isas.push_back(static_cast<SobelIsa>(isa));
+		}
+	}
+	return isas;
+}
+
+// True when rows bytesPerLine apart meet the alignment the tier's entry points assert
+static inline bool test_stride_ok(SobelIsa isa, uint32_t bytesPerLine, uint32_t elementBytes = sizeof(float)) noexcept {
+	static const uint32_t kVectorBytes[] = { 0u, 16u, 32u, 64u, 32u };
+	return bytesPerLine % std::max(kVectorBytes[static_cast<uint32_t>(isa)], elementBytes) == 0u;
+}
+
+// Normalized 3x3 Sobel magnitude at (x, y) with clamped borders, in double precision
+template <typename T>
+static inline double test_sobel(const TestImage<T>& image, uint32_t x, uint32_t y) noexcept {
+	double p[3][3];
+	for (int32_t j = -1; j <= 1; ++j) {
+		for (int32_t i = -1; i <= 1; ++i) {
+			const int64_t sx = std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>(x) + i, 0), image.width - 1);
+			const int64_t sy = std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>(y) + j, 0), image.height - 1);
+			p[j + 1][i + 1] = static_cast<double>(image.row(static_cast<uint32_t>(sy))[sx]);
+		}
+	}
+	const double dx = (p[0][2] - p[0][0]) + 2.0 * (p[1][2] - p[1][0]) + (p[2][2] - p[2][0]);
+	const double dy = (p[2][0] - p[0][0]) + 2.0 * (p[2][1] - p[0][1]) + (p[2][2] - p[0][2]);
+	return std::sqrt((dx * dx + dy * dy) / 32.0);
+}
+
+// Largest absolute difference to the double reference, over the image
+template <typename T>
+static inline double test_sobel_error(const TestImage<T>& image, const TestImage<T>& magnitude) noexcept {
+	double error = 0.0;
+	for (uint32_t y = 0u; y < image.height; ++y) {
+		for (uint32_t x = 0u; x < image.width; ++x) {
+			const double difference = std::fabs(static_cast<double>(magnitude.row(y)[x]) - test_sobel(image, x, y));
+			error = difference == difference ? std::max(error, difference) : HUGE_VAL;
+		}
+	}
+	return error;
+}
@@ -0,0 +1,85 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <atomic>
+#include <memory>
+
+#include "sobel_test.h"
+#include "sobel_async.h"
+
+// Queues of every tier filter all odd shapes and padded strides, through futures and
+// completion callbacks, with a callback that throws in between. Every frame has to
+// match the double reference once complete, and no more than maxInFlight frames may
+// be in flight at any time.
+
+static constexpr uint32_t kMaxInFlight = 2u;
+
+int main() {
+	for (SobelIsa isa : test_isas()) {
+		std::vector<std::unique_ptr<TestImage<float> > > sources;
+		std::vector<std::unique_ptr<TestImage<float> > > results;
+		std::vector<std::future<void> > futures;
+		std::atomic<uint32_t> callbacks(0u);
+		std::atomic<uint32_t> overfull(0u);
+		uint32_t expectedCallbacks = 0u;
+
+		{
+			SobelQueue queue(kMaxInFlight, isa);
+			for (const TestShape& shape : kTestShapes) {
+				for (uint32_t padding : kTestPaddings) {
+					sources.emplace_back(new TestImage<float>(shape.width, shape.height, padding));
+					results.emplace_back(new TestImage<float>(shape.width, shape.height, padding));
+					TestImage<float>& src = *sources.back();
+					TestImage<float>& dst = *results.back();
+					src.fill(shape.width * 19u + shape.height + padding);
+					if (!test_stride_ok(isa, src.bytesPerLine)) {
+						sobel_filter(src.pixels(), dst.pixels(), shape.width, shape.height, src.bytesPerLine, dst.bytesPerLine);
+						continue;
+					}
+
+					const size_t frame = results.size();
+					if (frame % 3u == 0u) {
+						futures.push_back(queue.submit(src.pixels(), dst.pixels(), shape.width, shape.height, src.bytesPerLine, dst.bytesPerLine));
+					} else {
+						++expectedCallbacks;
+						queue.submit(src.pixels(), dst.pixels(), shape.width, shape.height, src.bytesPerLine, dst.bytesPerLine, [&queue, &callbacks, &overfull, frame]() {
+							callbacks.fetch_add(1u);
+							if (queue.in_flight() > kMaxInFlight) {
+								overfull.fetch_add(1u);
+							}
+							if (frame % 3u == 2u) {
+								throw 1;  // Dropped by the queue, the frame still completes
+							}
+						});
+					}
+				}
+			}
+
+			for (std::future<void>& future : futures) {
+				future.get();
+			}
+			queue.wait();
+			TEST_CHECK(queue.in_flight() == 0u, "%s has %u frames in flight after wait", sobel_isa_name(isa), queue.in_flight());
+		}
+
+		TEST_CHECK(callbacks.load() == expectedCallbacks, "%s ran %u of %u callbacks", sobel_isa_name(isa), callbacks.load(), expectedCallbacks);
+		TEST_CHECK(overfull.load() == 0u, "%s had more than %u frames in flight %u times", sobel_isa_name(isa), kMaxInFlight, overfull.load());
+
+		for (size_t i = 0u; i < results.size(); ++i) {
+			const TestImage<float>& src = *sources[i];
+			const double error = test_sobel_error(src, *results[i]);
+			TEST_CHECK(error <= 1e-5, "%s %ux%u stride %u differs from the reference by %g", sobel_isa_name(isa), src.width, src.height, src.bytesPerLine, error);
+			TEST_CHECK(results[i]->guard_intact(), "%s %ux%u stride %u wrote past the rows", sobel_isa_name(isa), src.width, src.height, src.bytesPerLine);
+		}
+	}
+
+	return test_result();
+}
@@ -0,0 +1,121 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <string>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "sobel_test.h"
+#include "sobel_bench_stats.h"
+
+// The statistics sobel_bench decides regressions with: Mann-Whitney p-values of
+// identical, shifted and tied samples against values worked out by hand, outlier
+// rejection including a MAD of 0, and a baseline surviving a record and load.
+
+static void test_mann_whitney() {
+	const std::vector<double> a = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0 };
+	std::vector<double> slower(a);
+	std::vector<double> faster(a);
+	for (size_t i = 0u; i < a.size(); ++i) {
+		slower[i] += 10.0;
+		faster[i] -= 10.0;
+	}
+
+	double p = mann_whitney_p(a, a);
+	TEST_CHECK(p == 0.5, "identical samples give p %g, expected 0.5", p);
+	p = mann_whitney_p(a, slower);
+	TEST_CHECK(std::fabs(p - 0.00087256) < 1e-7, "slower samples give p %g, expected 0.00087256", p);
+	p = mann_whitney_p(a, faster);
+	TEST_CHECK(std::fabs(p - 0.99912744) < 1e-7, "faster samples give p %g, expected 0.99912744", p);
+
+	// U of 14 out of 16, runs of 2, 4 and 2 tied values
+	const std::vector<double> tiedA = { 1.0, 1.0, 2.0, 2.0 };
+	const std::vector<double> tiedB = { 2.0, 2.0, 3.0, 3.0 };
+	p = mann_whitney_p(tiedA, tiedB);
+	TEST_CHECK(std::fabs(p - 0.03068441) < 1e-7, "tied samples give p %g, expected 0.03068441", p);
+
+	const std::vector<double> constant(5u, 3.0);
+	p = mann_whitney_p(constant, constant);
+	TEST_CHECK(p == 1.0, "samples all tied give p %g, expected 1", p);
+}
+
+static void test_outliers() {
+	Result result;
+	const std::vector<double> spread = { 1.0, 1.1, 0.9, 1.05, 0.95, 1.02, 9.0 };
+	reject_outliers(spread, result);
+	TEST_CHECK(result.samples.size() == 6u && std::fabs(result.median - 1.01) < 1e-12 && std::fabs(result.mad - 0.05) < 1e-12, "kept %zu samples with median %g and MAD %g, expected 6, 1.01 and 0.05", result.samples.size(), result.median, result.mad);
+
+	// With a MAD of 0 only the times equal to the median stay
+	const std::vector<double> quantized = { 2.0, 3.0, 2.0, 2.0, 9.0, 2.0, 2.0 };
+	reject_outliers(quantized, result);
+	TEST_CHECK(result.samples.size() == 5u && result.median == 2.0 && result.mad == 0.0, "kept %zu samples with median %g and MAD %g, expected 5, 2 and 0", result.samples.size(), result.median, result.mad);
+
+	const std::vector<double> constant(4u, 5.0);
+	reject_outliers(constant, result);
+	TEST_CHECK(result.samples.size() == 4u && result.median == 5.0 && result.mad == 0.0, "constant times kept %zu samples with median %g and MAD %g", result.samples.size(), result.median, result.mad);
+}
+
+static void test_baseline() {
+#if defined(__linux__)
+	const char* temp = getenv("TMPDIR");
+	std::string path = std::string(temp != nullptr ? temp : "/tmp") + "/sobel_bench_XXXXXX";
+	const int fd = mkstemp(&path[0]);
+	TEST_CHECK(fd >= 0, "cannot create a file from %s", path.c_str());
+	if (fd < 0) {
+		return;
+	}
+	close(fd);
+
+	const Host host = { "Some CPU @ 3.00GHz", "avx512", "performance" };
+	std::vector<Result> results(2u);
+	results[0].kernel = "sobel_filter_avx2";
+	results[0].width = 640u;
+	results[0].height = 480u;
+	results[0].samples = { 1.25e-4, 1.5e-4, 1.125e-4 };
+	results[1].kernel = "sobel_plan_execute";
+	results[1].width = 3840u;
+	results[1].height = 2160u;
+	results[1].samples = { 3.0e-3, 2.75e-3, 3.25e-3, 3.5e-3 };
+	for (Result& r : results) {
+		r.median = median_of(r.samples);
+		r.mad = mad_of(r.samples, r.median);
+	}
+
+	TEST_CHECK(record(path.c_str(), host, results), "cannot record %s", path.c_str());
+	Host loadedHost;
+	std::vector<Result> loaded;
+	TEST_CHECK(load(path.c_str(), loadedHost, loaded), "cannot load %s", path.c_str());
+	TEST_CHECK(loadedHost.cpu == host.cpu && loadedHost.isa == host.isa && loadedHost.governor == host.governor, "host loaded as \"%s\", %s, %s", loadedHost.cpu.c_str(), loadedHost.isa.c_str(), loadedHost.governor.c_str());
+	TEST_CHECK(loaded.size() == results.size(), "%zu cases loaded, expected %zu", loaded.size(), results.size());
+
+	for (size_t i = 0u; i < std::min(loaded.size(), results.size()); ++i) {
+		const Result& r = results[i];
+		const Result& l = loaded[i];
+		bool same = l.kernel == r.kernel && l.width == r.width && l.height == r.height && l.samples.size() == r.samples.size();
+		same = same && std::fabs(l.median - r.median) <= 1e-9 * r.median && std::fabs(l.mad - r.mad) <= 1e-9 * r.median;
+		for (size_t j = 0u; same && j < r.samples.size(); ++j) {
+			same = std::fabs(l.samples[j] - r.samples[j]) <= 1e-9 * r.samples[j];
+		}
+		TEST_CHECK(same, "case %zu loaded as %s %ux%u with median %g and %zu samples", i, l.kernel.c_str(), l.width, l.height, l.median, l.samples.size());
+	}
+
+	unlink(path.c_str());
+#endif
+}
+
+int main() {
+	test_mann_whitney();
+	test_outliers();
+	test_baseline();
+	return test_result();
+}
@@ -0,0 +1,132 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+#include "sobel_canny.h"
+
+// Canny edges of every tier against the scalar edges bit for bit on odd shapes, padded
+// strides and odd mask strides. The scalar edges are checked against the double
+// reference: every edge is above low and 8-connected through edges to one above high.
+// A vertical step gives exactly the column left of it.
+
+static const float kThresholds[][2] = { { 0.05f, 0.3f }, { 0.2f, 0.6f }, { 0.3f, 0.3f }, { 10.0f, 20.0f } };
+
+static bool test_bit(const uint8_t* row, uint32_t x) noexcept {
+	return (row[x / 8u] >> (x % 8u) & 1u) != 0u;
+}
+
+// Edges that are below low, or not 8-connected through edges to one above high
+static uint32_t bad_edges(const TestImage<float>& src, const TestImage<uint8_t>& edges, float low, float high) {
+	const double tolerance = 1e-5;
+	std::vector<uint8_t> reached(static_cast<size_t>(src.width) * src.height, 0u);
+	std::vector<uint32_t> stack;
+	uint32_t bad = 0u;
+
+	for (uint32_t y = 0u; y < src.height; ++y) {
+		for (uint32_t x = 0u; x < src.width; ++x) {
+			if (!test_bit(edges.row(y), x)) {
+				continue;
+			}
+			const double magnitude = test_sobel(src, x, y);
+			bad += magnitude > low - tolerance ? 0u : 1u;
+			if (magnitude > high - tolerance) {
+				reached[static_cast<size_t>(y) * src.width + x] = 1u;
+				stack.push_back(y * src.width + x);
+			}
+		}
+	}
+
+	while (!stack.empty()) {
+		const uint32_t x = stack.back() % src.width;
+		const uint32_t y = stack.back() / src.width;
+		stack.pop_back();
+		for (int32_t j = -1; j <= 1; ++j) {
+			for (int32_t i = -1; i <= 1; ++i) {
+				const int64_t nx = static_cast<int64_t>(x) + i;
+				const int64_t ny = static_cast<int64_t>(y) + j;
+				if (nx >= 0 && ny >= 0 && nx < src.width && ny < src.height && test_bit(edges.row(static_cast<uint32_t>(ny)), static_cast<uint32_t>(nx)) && reached[ny * src.width + nx] == 0u) {
+					reached[ny * src.width + nx] = 1u;
+					stack.push_back(static_cast<uint32_t>(ny * src.width + nx));
+				}
+			}
+		}
+	}
+
+	for (uint32_t y = 0u; y < src.height; ++y) {
+		for (uint32_t x = 0u; x < src.width; ++x) {
+			bad += test_bit(edges.row(y), x) && reached[static_cast<size_t>(y) * src.width + x] == 0u ? 1u : 0u;
+		}
+	}
+	return bad;
+}
+
+int main() {
+	for (const TestShape& shape : kTestShapes) {
+		const uint32_t maskBytes = (shape.width + 7u) / 8u;
+
+		for (uint32_t padding : kTestPaddings) {
+			TestImage<float> src(shape.width, shape.height, padding);
+			src.fill(shape.width * 59u + shape.height);
+
+			for (const float* thresholds : kThresholds) {
+				TestImage<uint8_t> reference(maskBytes, shape.height, 3u);
+				sobel_canny(src.pixels(), reference.pixels(), shape.width, shape.height, src.bytesPerLine, reference.bytesPerLine, thresholds[0], thresholds[1], SobelIsa::kScalar);
+				const uint32_t bad = bad_edges(src, reference, thresholds[0], thresholds[1]);
+				TEST_CHECK(bad == 0u, "scalar %ux%u+%u thresholds %g %g has %u unfounded edges", shape.width, shape.height, padding, thresholds[0], thresholds[1], bad);
+
+				for (SobelIsa isa : test_isas()) {
+					if (!test_stride_ok(isa, src.bytesPerLine)) {
+						continue;
+					}
+
+					TestImage<uint8_t> edges(maskBytes, shape.height, 3u);
+					sobel_canny(src.pixels(), edges.pixels(), shape.width, shape.height, src.bytesPerLine, edges.bytesPerLine, thresholds[0], thresholds[1], isa);
+
+					bool same = true;
+					for (uint32_t y = 0u; y < shape.height; ++y) {
+						same = same && memcmp(edges.row(y), reference.row(y), maskBytes) == 0;
+					}
+					TEST_CHECK(same, "%s %ux%u+%u thresholds %g %g differs from the scalar edges", sobel_isa_name(isa), shape.width, shape.height, padding, thresholds[0], thresholds[1]);
+					TEST_CHECK(edges.guard_intact(), "%s %ux%u+%u thresholds %g %g wrote past the mask rows", sobel_isa_name(isa), shape.width, shape.height, padding, thresholds[0], thresholds[1]);
+				}
+			}
+
+			if (shape.width < 2u) {
+				continue;
+			}
+
+			// Vertical step between columns width / 2 - 1 and width / 2
+			TestImage<float> step(shape.width, shape.height, padding);
+			for (uint32_t y = 0u; y < shape.height; ++y) {
+				for (uint32_t x = 0u; x < shape.width; ++x) {
+					step.row(y)[x] = x < shape.width / 2u ? 0.0f : 1.0f;
+				}
+			}
+			for (SobelIsa isa : test_isas()) {
+				if (!test_stride_ok(isa, step.bytesPerLine)) {
+					continue;
+				}
+
+				TestImage<uint8_t> edges(maskBytes, shape.height, 3u);
+				sobel_canny(step.pixels(), edges.pixels(), shape.width, shape.height, step.bytesPerLine, edges.bytesPerLine, 0.1f, 0.3f, isa);
+				uint32_t wrong = 0u;
+				for (uint32_t y = 0u; y < shape.height; ++y) {
+					for (uint32_t x = 0u; x < shape.width; ++x) {
+						wrong += test_bit(edges.row(y), x) != (x == shape.width / 2u - 1u) ? 1u : 0u;
+					}
+				}
+				TEST_CHECK(wrong == 0u, "%s %ux%u+%u step has %u wrong edge bits", sobel_isa_name(isa), shape.width, shape.height, padding, wrong);
+			}
+		}
+	}
+
+	return test_result();
+}
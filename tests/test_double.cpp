@@ -0,0 +1,48 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+
+// Double precision filters of every tier against the double reference, which they
+// have to match to double rounding rather than float rounding
+
+typedef void (*TestFilterDouble)(const double* __restrict, double* __restrict, uint32_t, uint32_t, uint32_t, uint32_t);
+
+// Indexed by SobelIsa, the 256 bit AVX-512 tier has no double precision variant
+static const TestFilterDouble kFilters[] = { sobel_filter, sobel_filter_sse2, sobel_filter_avx2, sobel_filter_avx512, nullptr };
+
+int main() {
+	for (const TestShape& shape : kTestShapes) {
+		for (uint32_t padding : kTestPaddings) {
+			if (padding % sizeof(double) != 0u) {
+				continue;
+			}
+			TestImage<double> src(shape.width, shape.height, padding);
+			src.fill(shape.width * 17u + shape.height);
+
+			for (SobelIsa isa : test_isas()) {
+				const TestFilterDouble filter = kFilters[static_cast<uint32_t>(isa)];
+				if (filter == nullptr || !test_stride_ok(isa, src.bytesPerLine, sizeof(double))) {
+					continue;
+				}
+
+				TestImage<double> dst(shape.width, shape.height, padding);
+				filter(src.pixels(), dst.pixels(), shape.width, shape.height, src.bytesPerLine, dst.bytesPerLine);
+
+				const double error = test_sobel_error(src, dst);
+				TEST_CHECK(error <= 1e-12, "%s %ux%u+%u differs from the reference by %g", sobel_isa_name(isa), shape.width, shape.height, padding, error);
+				TEST_CHECK(dst.guard_intact(), "%s %ux%u+%u wrote past the rows", sobel_isa_name(isa), shape.width, shape.height, padding);
+			}
+		}
+	}
+
+	return test_result();
+}
@@ -0,0 +1,235 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <string>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "sobel_test.h"
+#include "sobel_file.h"
+
+// Raw, little and big endian PFM and 8 and 16 bit PGM files of odd shapes through
+// every tier and several band heights, against the double reference of the decoded
+// input. An output naming the input through the same path, a hard link or a symbolic
+// link is refused and leaves the input intact, and malformed inputs are reported.
+
+#if defined(__linux__)
+
+static const uint32_t kBandRows[] = { 0u, 1u, 2u, 5u };
+
+enum TestFile : uint32_t {
+	kTestRaw,
+	kTestPfmLittle,
+	kTestPfmBig,
+	kTestPgm8,
+	kTestPgm16
+};
+
+static const char* const kFileNames[] = { "raw", "pfm le", "pfm be", "pgm 8", "pgm 16" };
+
+static std::string gDirectory;
+
+static std::string test_path(const char* name) {
+	return gDirectory + "/" + name;
+}
+
+static bool write_file(const std::string& path, const std::string& bytes) {
+	FILE* file = fopen(path.c_str(), "wb");
+	const bool written = file != nullptr && fwrite(bytes.data(), 1u, bytes.size(), file) == bytes.size();
+	return file != nullptr && fclose(file) == 0 && written;
+}
+
+static std::string read_file(const std::string& path) {
+	std::string bytes;
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file != nullptr) {
+		char buffer[4096];
+		size_t count;
+		while ((count = fread(buffer, 1u, sizeof(buffer), file)) != 0u) {
+			bytes.append(buffer, count);
+		}
+		fclose(file);
+	}
+	return bytes;
+}
+
+static void append_bytes(std::string& bytes, const void* value, size_t size, bool reverse) {
+	const char* data = static_cast<const char*>(value);
+	for (size_t i = 0u; i < size; ++i) {
+		bytes.push_back(data[reverse ? size - 1u - i : i]);
+	}
+}
+
+// Encodes image in the file format, quantizing it for PGM so the reference sees the stored samples
+static std::string encode(TestFile kind, TestImage<float>& image) {
+	char header[64] = "";
+	const uint32_t maxValue = kind == kTestPgm8 ? 255u : 65535u;
+	if (kind == kTestPfmLittle || kind == kTestPfmBig) {
+		snprintf(header, sizeof(header), "Pf\n%u %u\n%s\n", image.width, image.height, kind == kTestPfmLittle ? "-1.0" : "1.0");
+	} else if (kind != kTestRaw) {
+		snprintf(header, sizeof(header), "P5\n# odd shape\n%u %u\n%u\n", image.width, image.height, maxValue);
+	}
+
+	std::string bytes(header);
+	for (uint32_t y = 0u; y < image.height; ++y) {
+		for (uint32_t x = 0u; x < image.width; ++x) {
+			float& pixel = image.row(y)[x];
+			if (kind == kTestPgm8) {
+				pixel = std::floor(pixel * maxValue);
+				bytes.push_back(static_cast<char>(static_cast<uint8_t>(pixel)));
+			} else if (kind == kTestPgm16) {
+				pixel = std::floor(pixel * maxValue);
+				const uint16_t sample = static_cast<uint16_t>(pixel);
+				append_bytes(bytes, &sample, sizeof(sample), true);
+			} else {
+				append_bytes(bytes, &pixel, sizeof(pixel), kind == kTestPfmBig);
+			}
+		}
+	}
+	return bytes;
+}
+
+// Largest error of the decoded output relative to what the format allows, above 1 fails
+static double output_error(TestFile kind, const TestImage<float>& image, const std::string& bytes) {
+	char header[64] = "";
+	const uint32_t maxValue = kind == kTestPgm8 ? 255u : 65535u;
+	if (kind == kTestPfmLittle || kind == kTestPfmBig) {
+		snprintf(header, sizeof(header), "Pf\n%u %u\n-1.0\n", image.width, image.height);
+	} else if (kind != kTestRaw) {
+		snprintf(header, sizeof(header), "P5\n%u %u\n%u\n", image.width, image.height, maxValue);
+	}
+	const size_t headerBytes = strlen(header);
+	const size_t sampleBytes = kind == kTestPgm8 ? 1u : kind == kTestPgm16 ? 2u : 4u;
+	if (bytes.compare(0u, headerBytes, header) != 0 || bytes.size() != headerBytes + sampleBytes * image.width * image.height) {
+		return HUGE_VAL;
+	}
+
+	double error = 0.0;
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(bytes.data()) + headerBytes;
+	for (uint32_t y = 0u; y < image.height; ++y) {
+		for (uint32_t x = 0u; x < image.width; ++x) {
+			const uint8_t* sample = data + (static_cast<size_t>(y) * image.width + x) * sampleBytes;
+			const double reference = test_sobel(image, x, y);
+			double difference;
+			if (kind == kTestPgm8 || kind == kTestPgm16) {
+				const uint32_t value = kind == kTestPgm8 ? sample[0] : (static_cast<uint32_t>(sample[0]) << 8 | sample[1]);
+				difference = std::fabs(value - std::min(reference, static_cast<double>(maxValue)));
+			} else {
+				float value;
+				memcpy(&value, sample, sizeof(value));
+				difference = std::fabs(value - reference) / (std::max(reference, 1.0) * 1e-5);
+			}
+			error = difference == difference ? std::max(error, difference) : HUGE_VAL;
+		}
+	}
+	return error;
+}
+
+static void test_formats() {
+	const std::string input = test_path("input");
+	const std::string output = test_path("output");
+
+	for (const TestShape& shape : kTestShapes) {
+		for (uint32_t kind = kTestRaw; kind <= kTestPgm16; ++kind) {
+			TestImage<float> image(shape.width, shape.height);
+			image.fill(shape.width * 37u + shape.height + kind);
+			TEST_CHECK(write_file(input, encode(static_cast<TestFile>(kind), image)), "cannot write %s", input.c_str());
+
+			const SobelFileFormat format = kind == kTestRaw ? SobelFileFormat::kRaw : kind <= kTestPfmBig ? SobelFileFormat::kPfm : SobelFileFormat::kPgm;
+			TEST_CHECK(sobel_file_format(input.c_str()) == format, "%s %ux%u detected as format %u", kFileNames[kind], shape.width, shape.height, static_cast<uint32_t>(sobel_file_format(input.c_str())));
+
+			for (SobelIsa isa : test_isas()) {
+				for (uint32_t bandRows : kBandRows) {
+					const SobelFileStatus status = sobel_filter_file(input.c_str(), output.c_str(), format, shape.width, shape.height, bandRows, isa);
+					TEST_CHECK(status == SobelFileStatus::kOk, "%s %s %ux%u in %u row bands: %s", sobel_isa_name(isa), kFileNames[kind], shape.width, shape.height, bandRows, sobel_file_status_string(status));
+
+					const double error = output_error(static_cast<TestFile>(kind), image, read_file(output));
+					TEST_CHECK(error <= 1.0, "%s %s %ux%u in %u row bands off by %g of the allowed error", sobel_isa_name(isa), kFileNames[kind], shape.width, shape.height, bandRows, error);
+				}
+			}
+		}
+	}
+}
+
+static void test_same_file() {
+	const std::string input = test_path("same.pfm");
+	const std::string hardLink = test_path("hard.pfm");
+	const std::string symbolicLink = test_path("symbolic.pfm");
+	const std::string dotted = gDirectory + "/./same.pfm";
+
+	TestImage<float> image(9u, 5u);
+	image.fill(5u);
+	const std::string bytes = encode(kTestPfmLittle, image);
+	TEST_CHECK(write_file(input, bytes), "cannot write %s", input.c_str());
+	TEST_CHECK(link(input.c_str(), hardLink.c_str()) == 0 && symlink(input.c_str(), symbolicLink.c_str()) == 0, "cannot link %s", input.c_str());
+
+	const std::string* outputs[] = { &input, &hardLink, &symbolicLink, &dotted };
+	for (const std::string* output : outputs) {
+		const SobelFileStatus status = sobel_filter_file(input.c_str(), output->c_str(), SobelFileFormat::kPfm, 0u, 0u, 0u, sobel_detect_isa());
+		TEST_CHECK(status == SobelFileStatus::kSameFile, "output %s over the input gave: %s", output->c_str(), sobel_file_status_string(status));
+		TEST_CHECK(read_file(input) == bytes, "output %s changed the input", output->c_str());
+	}
+
+	unlink(symbolicLink.c_str());
+	unlink(hardLink.c_str());
+	unlink(input.c_str());
+}
+
+static void test_errors() {
+	const std::string input = test_path("bad");
+	const std::string output = test_path("bad.out");
+	const SobelIsa isa = sobel_detect_isa();
+
+	SobelFileStatus status = sobel_filter_file(test_path("missing").c_str(), output.c_str(), SobelFileFormat::kRaw, 4u, 4u, 0u, isa);
+	TEST_CHECK(status == SobelFileStatus::kOpenFailed, "missing input gave: %s", sobel_file_status_string(status));
+
+	// Data too short for the dimensions, a zero maximum value and a negative height
+	const char* const headers[] = { "Pf\n4 4\n-1.0\n\x01\x02", "P5\n4 4\n0\n0123456789abcdef", "P5\n4 -4\n255\n0123456789abcdef" };
+	for (const char* header : headers) {
+		TEST_CHECK(write_file(input, header), "cannot write %s", input.c_str());
+		status = sobel_filter_file(input.c_str(), output.c_str(), sobel_file_format(input.c_str()), 0u, 0u, 0u, isa);
+		TEST_CHECK(status == SobelFileStatus::kBadHeader, "header \"%s\" gave: %s", header, sobel_file_status_string(status));
+	}
+	status = sobel_filter_file(input.c_str(), output.c_str(), SobelFileFormat::kRaw, 64u, 64u, 0u, isa);
+	TEST_CHECK(status == SobelFileStatus::kBadHeader, "short raw file gave: %s", sobel_file_status_string(status));
+
+	unlink(output.c_str());
+	unlink(input.c_str());
+}
+
+int main() {
+	const char* temp = getenv("TMPDIR");
+	std::string pattern = std::string(temp != nullptr ? temp : "/tmp") + "/sobel_test_XXXXXX";
+	if (mkdtemp(&pattern[0]) == nullptr) {
+		fprintf(stderr, "cannot create a directory from %s\n", pattern.c_str());
+		return 2;
+	}
+	gDirectory = pattern;
+
+	test_formats();
+	test_same_file();
+	test_errors();
+
+	unlink(test_path("input").c_str());
+	unlink(test_path("output").c_str());
+	rmdir(gDirectory.c_str());
+	return test_result();
+}
+
+#else
+
+int main() {
+	return test_result();
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+
+// The 3x3 Sobel filter of every tier against the double reference, and the Scharr,
+// 5x5 and 7x7 stencils of every tier against their scalar version, on odd shapes and
+// the padded strides each tier takes. No tier may write past the row width. Tier
+// names parse back to their tier.
+
+typedef void (*TestFilter)(const float* __restrict, float* __restrict, uint32_t, uint32_t, uint32_t, uint32_t);
+
+struct TestStencil {
+	const char* name;
+	TestFilter tiers[5];  // Indexed by SobelIsa
+};
+
+static const TestStencil kStencils[] = {
+	{ "sobel", { sobel_filter, sobel_filter_sse2, sobel_filter_avx2, sobel_filter_avx512, sobel_filter_avx512vl } },
+	{ "scharr", { scharr_filter, scharr_filter_sse2, scharr_filter_avx2, scharr_filter_avx512, scharr_filter_avx512vl } },
+	{ "sobel5", { sobel5_filter, sobel5_filter_sse2, sobel5_filter_avx2, sobel5_filter_avx512, sobel5_filter_avx512vl } },
+	{ "sobel7", { sobel7_filter, sobel7_filter_sse2, sobel7_filter_avx2, sobel7_filter_avx512, sobel7_filter_avx512vl } }
+};
+
+static void test_isa_names() {
+	for (uint32_t i = 0u; i <= static_cast<uint32_t>(SobelIsa::kAvx512Vl); ++i) {
+		SobelIsa isa = SobelIsa::kScalar;
+		TEST_CHECK(sobel_isa_parse(sobel_isa_name(static_cast<SobelIsa>(i)), &isa) && isa == static_cast<SobelIsa>(i), "tier %u named %s parses to %s", i, sobel_isa_name(static_cast<SobelIsa>(i)), sobel_isa_name(isa));
+	}
+
+	const char* const unknown[] = { "", "avx", "AVX2", "avx512 ", "unknown" };
+	for (const char* name : unknown) {
+		SobelIsa isa = SobelIsa::kSse2;
+		TEST_CHECK(!sobel_isa_parse(name, &isa) && isa == SobelIsa::kSse2, "\"%s\" parsed as %s", name, sobel_isa_name(isa));
+	}
+	TEST_CHECK(strcmp(sobel_isa_name(static_cast<SobelIsa>(5u)), "unknown") == 0, "tier 5 named %s", sobel_isa_name(static_cast<SobelIsa>(5u)));
+}
+
+int main() {
+	test_isa_names();
+
+	for (const TestShape& shape : kTestShapes) {
+		for (uint32_t padding : kTestPaddings) {
+			TestImage<float> src(shape.width, shape.height, padding);
+			src.fill(shape.width * 31u + shape.height);
+
+			for (const TestStencil& stencil : kStencils) {
+				TestImage<float> reference(shape.width, shape.height, padding);
+				stencil.tiers[0](src.pixels(), reference.pixels(), shape.width, shape.height, src.bytesPerLine, reference.bytesPerLine);
+
+				for (SobelIsa isa : test_isas()) {
+					if (!test_stride_ok(isa, src.bytesPerLine)) {
+						continue;
+					}
+					TestImage<float> dst(shape.width, shape.height, padding);
+					stencil.tiers[static_cast<uint32_t>(isa)](src.pixels(), dst.pixels(), shape.width, shape.height, src.bytesPerLine, dst.bytesPerLine);
+
+					float error = 0.0f;
+					for (uint32_t y = 0u; y < shape.height; ++y) {
+						for (uint32_t x = 0u; x < shape.width; ++x) {
+							const float difference = std::fabs(dst.row(y)[x] - reference.row(y)[x]) / std::max(1.0f, reference.row(y)[x]);
+							error = difference == difference ? std::max(error, difference) : HUGE_VALF;
+						}
+					}
+					TEST_CHECK(error <= 1e-5f, "%s %s %ux%u+%u differs from scalar by %g", stencil.name, sobel_isa_name(isa), shape.width, shape.height, padding, error);
+					TEST_CHECK(dst.guard_intact(), "%s %s %ux%u+%u wrote past the rows", stencil.name, sobel_isa_name(isa), shape.width, shape.height, padding);
+
+					if (stencil.tiers[0] == kStencils[0].tiers[0]) {
+						const double reference3 = test_sobel_error(src, dst);
+						TEST_CHECK(reference3 <= 1e-5, "sobel %s %ux%u+%u differs from the reference by %g", sobel_isa_name(isa), shape.width, shape.height, padding, reference3);
+					}
+				}
+			}
+		}
+	}
+
+	return test_result();
+}
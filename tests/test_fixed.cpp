@@ -0,0 +1,58 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+#include "sobel_internal.h"
+
+// Compile-time specialized shapes give the same bits as the generic engine of their
+// tier, and match the scalar reference to within float rounding
+
+static const TestShape kFixedShapes[] = { { 640u, 480u }, { 1280u, 720u }, { 1920u, 1080u }, { 3840u, 2160u } };
+
+int main() {
+	for (const TestShape& shape : kFixedShapes) {
+		TestImage<float> src(shape.width, shape.height);
+		TestImage<float> reference(shape.width, shape.height);
+		src.fill(shape.width);
+		sobel_filter(src.pixels(), reference.pixels(), shape.width, shape.height, src.bytesPerLine, reference.bytesPerLine);
+
+		for (SobelIsa isa : test_isas()) {
+			if (isa == SobelIsa::kScalar) {
+				continue;
+			}
+			const SobelKernels& kernels = sobel_kernels(isa);
+			TEST_CHECK(kernels.fixed(shape.width, shape.height, src.bytesPerLine, src.bytesPerLine) != nullptr, "%s %ux%u has no fixed kernel", sobel_isa_name(isa), shape.width, shape.height);
+
+			TestImage<float> fixed(shape.width, shape.height);
+			TestImage<float> generic(shape.width, shape.height);
+			kernels.filter(src.pixels(), fixed.pixels(), shape.width, shape.height, src.bytesPerLine, fixed.bytesPerLine);
+			kernels.rows(src.pixels(), generic.pixels(), shape.width, shape.height, src.bytesPerLine, generic.bytesPerLine, 0u, shape.height);
+
+			TEST_CHECK(memcmp(fixed.pixels(), generic.pixels(), fixed.size()) == 0, "%s %ux%u fixed differs from the generic path", sobel_isa_name(isa), shape.width, shape.height);
+
+			float error = 0.0f;
+			for (uint32_t y = 0u; y < shape.height; ++y) {
+				for (uint32_t x = 0u; x < shape.width; ++x) {
+					error = std::max(error, std::fabs(fixed.row(y)[x] - reference.row(y)[x]));
+				}
+			}
+			TEST_CHECK(error <= 1e-5f, "%s %ux%u differs from scalar by %g", sobel_isa_name(isa), shape.width, shape.height, error);
+		}
+	}
+
+	// A padded stride is not a production shape and takes the generic path
+	TestImage<float> src(640u, 480u, 64u);
+	for (SobelIsa isa : test_isas()) {
+		TEST_CHECK(sobel_kernels(isa).fixed(src.width, src.height, src.bytesPerLine, src.bytesPerLine) == nullptr, "%s padded 640x480 took the fixed kernel", sobel_isa_name(isa));
+	}
+
+	return test_result();
+}
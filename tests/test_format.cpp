@@ -0,0 +1,110 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+
+// Every source and destination storage format pair of every tier with a format kernel
+// against the double reference on the widened source, on odd shapes and padded strides.
+// Float16 results are within half rounding, UInt16 results within one of the rounded
+// and saturated reference.
+
+typedef void (*TestFormatFilter)(const void* __restrict, void* __restrict, uint32_t, uint32_t, uint32_t, uint32_t, SobelFormat, SobelFormat);
+
+// Indexed by SobelIsa, the SSE2 and 256 bit AVX-512 tiers share the scalar and AVX2 kernels
+static const TestFormatFilter kFilters[] = { sobel_filter_format, nullptr, sobel_filter_format_avx2, sobel_filter_format_avx512, nullptr };
+
+static const SobelFormat kFormats[] = { SobelFormat::kFloat32, SobelFormat::kFloat16, SobelFormat::kUInt16 };
+static const char* const kFormatNames[] = { "f32", "f16", "u16" };
+
+static float test_half_to_float(uint16_t value) noexcept {
+	const int32_t exponent = (value >> 10) & 0x1F;
+	const float mantissa = static_cast<float>(value & 0x3FFu);
+	return exponent == 0 ? std::ldexp(mantissa, -24) : std::ldexp(1024.0f + mantissa, exponent - 25);
+}
+
+// Pixel x of a row in the given storage format, as float
+static float test_load(const void* row, uint32_t x, SobelFormat format) noexcept {
+	switch (format) {
+	case SobelFormat::kFloat16:
+		return test_half_to_float(static_cast<const uint16_t*>(row)[x]);
+	case SobelFormat::kUInt16:
+		return static_cast<float>(static_cast<const uint16_t*>(row)[x]);
+	default:
+		return static_cast<const float*>(row)[x];
+	}
+}
+
+// 16 bit rows hold the same lanes as float rows in half the bytes
+static bool test_format_stride_ok(SobelIsa isa, uint32_t bytesPerLine, SobelFormat format) noexcept {
+	return format == SobelFormat::kFloat32 ? test_stride_ok(isa, bytesPerLine) : test_stride_ok(isa, 2u * bytesPerLine, 2u * sizeof(uint16_t));
+}
+
+int main() {
+	for (const TestShape& shape : kTestShapes) {
+		for (uint32_t padding : kTestPaddings) {
+			// One source per format: floats in [0, 1), halves in [0, 1), integers in [0, 60000)
+			TestImage<float> src32(shape.width, shape.height, padding);
+			TestImage<uint16_t> src16(shape.width, shape.height, padding);
+			TestImage<uint16_t> srcU16(shape.width, shape.height, padding);
+			src32.fill(shape.width + shape.height);
+			src16.fill(shape.width * 3u + shape.height, 15360.0);
+			srcU16.fill(shape.width * 5u + shape.height, 60000.0);
+
+			for (uint32_t formatSrc = 0u; formatSrc < 3u; ++formatSrc) {
+				const void* source = formatSrc == 0u ? static_cast<const void*>(src32.pixels()) : formatSrc == 1u ? static_cast<const void*>(src16.pixels()) : static_cast<const void*>(srcU16.pixels());
+				const uint32_t bytesPerLineSrc = formatSrc == 0u ? src32.bytesPerLine : src16.bytesPerLine;
+
+				TestImage<float> widened(shape.width, shape.height);
+				for (uint32_t y = 0u; y < shape.height; ++y) {
+					for (uint32_t x = 0u; x < shape.width; ++x) {
+						widened.row(y)[x] = test_load(static_cast<const uint8_t*>(source) + static_cast<size_t>(y) * bytesPerLineSrc, x, kFormats[formatSrc]);
+					}
+				}
+
+				for (uint32_t formatDst = 0u; formatDst < 3u; ++formatDst) {
+					for (SobelIsa isa : test_isas()) {
+						const TestFormatFilter filter = kFilters[static_cast<uint32_t>(isa)];
+						TestImage<float> dst32(shape.width, shape.height, padding);
+						TestImage<uint16_t> dst16(shape.width, shape.height, padding);
+						void* target = formatDst == 0u ? static_cast<void*>(dst32.pixels()) : static_cast<void*>(dst16.pixels());
+						const uint32_t bytesPerLineDst = formatDst == 0u ? dst32.bytesPerLine : dst16.bytesPerLine;
+						if (filter == nullptr || !test_format_stride_ok(isa, bytesPerLineSrc, kFormats[formatSrc]) || !test_format_stride_ok(isa, bytesPerLineDst, kFormats[formatDst])) {
+							continue;
+						}
+
+						filter(source, target, shape.width, shape.height, bytesPerLineSrc, bytesPerLineDst, kFormats[formatSrc], kFormats[formatDst]);
+
+						double error = 0.0;
+						for (uint32_t y = 0u; y < shape.height; ++y) {
+							for (uint32_t x = 0u; x < shape.width; ++x) {
+								const double reference = test_sobel(widened, x, y);
+								const double value = test_load(static_cast<const uint8_t*>(target) + static_cast<size_t>(y) * bytesPerLineDst, x, kFormats[formatDst]);
+								double difference;
+								if (kFormats[formatDst] == SobelFormat::kUInt16) {
+									difference = std::fabs(value - std::min(reference, 65535.0));
+								} else if (kFormats[formatDst] == SobelFormat::kFloat16) {
+									difference = std::fabs(value - reference) / (std::max(reference, 6.2e-5) * 9.8e-4);
+								} else {
+									difference = std::fabs(value - reference) / (std::max(reference, 1.0) * 1e-5);
+								}
+								error = difference == difference ? std::max(error, difference) : HUGE_VAL;
+							}
+						}
+						TEST_CHECK(error <= 1.0, "%s %s to %s %ux%u+%u off by %g of the allowed error", sobel_isa_name(isa), kFormatNames[formatSrc], kFormatNames[formatDst], shape.width, shape.height, padding, error);
+						TEST_CHECK(formatDst == 0u ? dst32.guard_intact() : dst16.guard_intact(), "%s %s to %s %ux%u+%u wrote past the rows", sobel_isa_name(isa), kFormatNames[formatSrc], kFormatNames[formatDst], shape.width, shape.height, padding);
+					}
+				}
+			}
+		}
+	}
+
+	return test_result();
+}
@@ -0,0 +1,162 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <string>
+
+#include "sobel_test.h"
+#include "sobel_instrument.h"
+#include "sobel_internal.h"
+
+// The probes of the 3x3 float kernels. Every call of every tier has to land in the
+// counters of its tier and branch with its pixels, bytes and padded strides, dump
+// has to list it and reset has to clear it. Built without SOBEL_INSTRUMENTATION the
+// entry points are stubs that report nothing and leave the kernels untouched.
+
+typedef void (*TestFilter)(const float* __restrict, float* __restrict, uint32_t, uint32_t, uint32_t, uint32_t);
+
+// Indexed by SobelIsa
+static const TestFilter kFilters[] = { sobel_filter, sobel_filter_sse2, sobel_filter_avx2, sobel_filter_avx512, sobel_filter_avx512vl };
+
+// Floats per SIMD block, indexed by SobelIsa
+static const uint32_t kBlockWidths[] = { 1u, 4u, 8u, 16u, 8u };
+
+static constexpr uint32_t kPaths = static_cast<uint32_t>(SobelPath::kCount);
+static constexpr uint32_t kIsas = sizeof(kFilters) / sizeof(kFilters[0]);
+
+static bool test_zero(const SobelInstrumentStats& stats) noexcept {
+	for (uint32_t i = 0u; i < kIsas; ++i) {
+		for (uint32_t p = 0u; p < kPaths; ++p) {
+			const SobelCounters& c = stats.counters[i][p];
+			if (c.calls != 0u || c.paddedCalls != 0u || c.pixels != 0u || c.bytes != 0u || c.nanoseconds != 0u || c.cycles != 0u || c.instructions != 0u || c.llcMisses != 0u) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Everything sobel_instrument_dump prints
+static std::string test_dump() {
+	std::string text;
+	FILE* file = tmpfile();
+	if (file == nullptr) {
+		return text;
+	}
+	sobel_instrument_dump(file);
+	rewind(file);
+	char line[256];
+	while (fgets(line, sizeof(line), file) != nullptr) {
+		text += line;
+	}
+	fclose(file);
+	return text;
+}
+
+// Filters a width by height image on a tier, adding what its probe should record to counters
+static void test_filter(SobelIsa isa, uint32_t width, uint32_t height, uint32_t padding, SobelCounters& counters) {
+	TestImage<float> src(width, height, padding);
+	TestImage<float> dst(width, height, padding);
+	src.fill(width + height);
+	kFilters[static_cast<uint32_t>(isa)](src.pixels(), dst.pixels(), width, height, src.bytesPerLine, dst.bytesPerLine);
+
+	++counters.calls;
+	counters.paddedCalls += src.bytesPerLine != width * sizeof(float) ? 1u : 0u;
+	counters.pixels += static_cast<uint64_t>(width) * height;
+	counters.bytes += 2u * static_cast<uint64_t>(width) * height * sizeof(float);
+}
+
+int main() {
+	SobelInstrumentStats stats;
+
+#if SOBEL_INSTRUMENTATION
+	static const char* const kPathNames[kPaths] = { "scalar", "single block", "multi block", "single block+tail", "multi block+tail", "fixed", "row band" };
+
+	sobel_instrument_reset();
+	TEST_CHECK(sobel_instrument_query(&stats), "query reports the probes compiled out");
+	TEST_CHECK(test_zero(stats), "counters not cleared by reset");
+
+	// One call per branch of every tier, dense and padded
+	SobelCounters expected[kIsas][kPaths];
+	memset(expected, 0, sizeof(expected));
+	for (SobelIsa isa : test_isas()) {
+		// The scalar filter takes no single column images
+		const uint32_t block = std::max(kBlockWidths[static_cast<uint32_t>(isa)], 2u);
+		const uint32_t widths[] = { block, 2u * block, block + 1u, 2u * block + 1u, 64u };
+		for (uint32_t width : widths) {
+			for (uint32_t padding : { 0u, 64u }) {
+				SobelPath path = SobelPath::kScalar;
+				if (isa != SobelIsa::kScalar) {
+					const bool multi = width >= 2u * block;
+					path = width % block == 0u ? (multi ? SobelPath::kMultiBlock : SobelPath::kSingleBlock) : (multi ? SobelPath::kMultiBlockTail : SobelPath::kSingleBlockTail);
+				}
+				test_filter(isa, width, 3u + width % 5u, padding, expected[static_cast<uint32_t>(isa)][static_cast<uint32_t>(path)]);
+			}
+		}
+
+		// A production shape takes the fixed kernel, unless its rows are padded
+		if (isa != SobelIsa::kScalar) {
+			test_filter(isa, 640u, 480u, 0u, expected[static_cast<uint32_t>(isa)][static_cast<uint32_t>(SobelPath::kFixed)]);
+			test_filter(isa, 640u, 480u, 64u, expected[static_cast<uint32_t>(isa)][static_cast<uint32_t>(SobelPath::kMultiBlock)]);
+		}
+
+		// Rows 2 to 6 of a padded image as one band, the way the threaded drivers split it
+		TestImage<float> src(37u, 9u);
+		TestImage<float> dst(37u, 9u);
+		src.fill(37u);
+		sobel_kernels(isa).rows(src.pixels(), dst.pixels(), src.width, src.height, src.bytesPerLine, dst.bytesPerLine, 2u, 7u);
+		SobelCounters& band = expected[static_cast<uint32_t>(isa)][static_cast<uint32_t>(SobelPath::kBand)];
+		++band.calls;
+		++band.paddedCalls;
+		band.pixels += 5u * 37u;
+		band.bytes += 2u * 5u * 37u * sizeof(float);
+	}
+
+	TEST_CHECK(sobel_instrument_query(&stats), "query reports the probes compiled out");
+	for (uint32_t i = 0u; i < kIsas; ++i) {
+		for (uint32_t p = 0u; p < kPaths; ++p) {
+			const SobelCounters& c = stats.counters[i][p];
+			const SobelCounters& e = expected[i][p];
+			const char* name = sobel_isa_name(static_cast<SobelIsa>(i));
+			TEST_CHECK(c.calls == e.calls, "%s %s counted %llu calls, expected %llu", name, kPathNames[p], static_cast<unsigned long long>(c.calls), static_cast<unsigned long long>(e.calls));
+			TEST_CHECK(c.paddedCalls == e.paddedCalls, "%s %s counted %llu padded calls, expected %llu", name, kPathNames[p], static_cast<unsigned long long>(c.paddedCalls), static_cast<unsigned long long>(e.paddedCalls));
+			TEST_CHECK(c.pixels == e.pixels, "%s %s counted %llu pixels, expected %llu", name, kPathNames[p], static_cast<unsigned long long>(c.pixels), static_cast<unsigned long long>(e.pixels));
+			TEST_CHECK(c.bytes == e.bytes, "%s %s counted %llu bytes, expected %llu", name, kPathNames[p], static_cast<unsigned long long>(c.bytes), static_cast<unsigned long long>(e.bytes));
+			TEST_CHECK(stats.hardwareCounters || (c.cycles == 0u && c.instructions == 0u && c.llcMisses == 0u), "%s %s has hardware counts without perf", name, kPathNames[p]);
+		}
+	}
+
+	// A line per tier and branch that ran, under the header
+	const std::string dump = test_dump();
+	for (SobelIsa isa : test_isas()) {
+		const std::string name = std::string(sobel_isa_name(isa)) + " ";
+		TEST_CHECK(dump.find("\n" + name) != std::string::npos, "dump has no line for %s:\n%s", sobel_isa_name(isa), dump.c_str());
+	}
+	TEST_CHECK(dump.find("multi block+tail") != std::string::npos && dump.find("row band") != std::string::npos && (test_isas().size() == 1u || dump.find("fixed") != std::string::npos), "dump misses a branch:\n%s", dump.c_str());
+
+	sobel_instrument_reset();
+	TEST_CHECK(sobel_instrument_query(&stats) && test_zero(stats), "counters not cleared by reset");
+	const std::string empty = test_dump();
+	TEST_CHECK(std::count(empty.begin(), empty.end(), '\n') == 1, "dump after reset is not just the header:\n%s", empty.c_str());
+#else
+	// Stubs: nothing is recorded, the stats are cleared and dump says why
+	SobelCounters counters;
+	memset(&counters, 0, sizeof(counters));
+	test_filter(SobelIsa::kScalar, 64u, 5u, 0u, counters);
+	sobel_instrument_reset();
+	memset(&stats, 0xFF, sizeof(stats));
+	TEST_CHECK(!sobel_instrument_query(&stats), "query claims probes in a build without them");
+	TEST_CHECK(!stats.hardwareCounters && test_zero(stats), "query left counters set in a build without probes");
+	const std::string dump = test_dump();
+	TEST_CHECK(dump.find("disabled") != std::string::npos && std::count(dump.begin(), dump.end(), '\n') == 1, "dump of a build without probes:\n%s", dump.c_str());
+#endif
+
+	return test_result();
+}
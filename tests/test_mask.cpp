@@ -0,0 +1,74 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+
+// Edge masks of every tier against the scalar mask bit for bit, and the scalar mask
+// against the double reference away from the threshold, on odd shapes, padded source
+// strides and odd mask strides. Bits past the width stay clear, a negative threshold
+// sets every bit.
+
+typedef void (*TestMaskFilter)(const float* __restrict, uint8_t* __restrict, uint32_t, uint32_t, uint32_t, uint32_t, float);
+
+// Indexed by SobelIsa
+static const TestMaskFilter kFilters[] = { sobel_edge_mask, sobel_edge_mask_sse2, sobel_edge_mask_avx2, sobel_edge_mask_avx512, sobel_edge_mask_avx512vl };
+
+static const float kThresholds[] = { -1.0f, 0.0f, 0.1f, 0.3f, 0.6f, 10.0f };
+
+static bool test_bit(const uint8_t* row, uint32_t x) noexcept {
+	return (row[x / 8u] >> (x % 8u) & 1u) != 0u;
+}
+
+int main() {
+	for (const TestShape& shape : kTestShapes) {
+		const uint32_t maskBytes = (shape.width + 7u) / 8u;
+
+		for (uint32_t padding : kTestPaddings) {
+			TestImage<float> src(shape.width, shape.height, padding);
+			src.fill(shape.width * 7u + shape.height);
+
+			for (float threshold : kThresholds) {
+				TestImage<uint8_t> reference(maskBytes, shape.height, 3u);
+				sobel_edge_mask(src.pixels(), reference.pixels(), shape.width, shape.height, src.bytesPerLine, reference.bytesPerLine, threshold);
+
+				uint32_t wrong = 0u;
+				for (uint32_t y = 0u; y < shape.height; ++y) {
+					for (uint32_t x = 0u; x < maskBytes * 8u; ++x) {
+						const double magnitude = x < shape.width ? test_sobel(src, x, y) : 0.0;
+						const bool expected = x < shape.width && (threshold < 0.0f || magnitude > threshold);
+						if (test_bit(reference.row(y), x) != expected && (x >= shape.width || std::fabs(magnitude - threshold) > 1e-5)) {
+							++wrong;
+						}
+					}
+				}
+				TEST_CHECK(wrong == 0u, "scalar %ux%u+%u threshold %g has %u wrong bits", shape.width, shape.height, padding, threshold, wrong);
+
+				for (SobelIsa isa : test_isas()) {
+					if (!test_stride_ok(isa, src.bytesPerLine)) {
+						continue;
+					}
+
+					TestImage<uint8_t> mask(maskBytes, shape.height, 3u);
+					kFilters[static_cast<uint32_t>(isa)](src.pixels(), mask.pixels(), shape.width, shape.height, src.bytesPerLine, mask.bytesPerLine, threshold);
+
+					bool same = true;
+					for (uint32_t y = 0u; y < shape.height; ++y) {
+						same = same && memcmp(mask.row(y), reference.row(y), maskBytes) == 0;
+					}
+					TEST_CHECK(same, "%s %ux%u+%u threshold %g differs from the scalar mask", sobel_isa_name(isa), shape.width, shape.height, padding, threshold);
+					TEST_CHECK(mask.guard_intact(), "%s %ux%u+%u threshold %g wrote past the mask rows", sobel_isa_name(isa), shape.width, shape.height, padding, threshold);
+				}
+			}
+		}
+	}
+
+	return test_result();
+}
@@ -0,0 +1,59 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+#include "sobel_numa.h"
+
+// The NUMA filter of every tier against the double reference on odd shapes, padded
+// strides and frames of many row bands, and a throughput report for every node.
+
+// Taller than several row bands, with an odd width
+static const TestShape kTallShapes[] = { { 67u, 301u }, { 333u, 129u } };
+
+static void test_numa_shape(uint32_t width, uint32_t height) {
+	for (uint32_t padding : kTestPaddings) {
+		TestImage<float> src(width, height, padding);
+		src.fill(width * 29u + height);
+
+		for (SobelIsa isa : test_isas()) {
+			if (!test_stride_ok(isa, src.bytesPerLine)) {
+				continue;
+			}
+
+			TestImage<float> dst(width, height, padding);
+			sobel_filter_numa(src.pixels(), dst.pixels(), width, height, src.bytesPerLine, dst.bytesPerLine, isa);
+			const double error = test_sobel_error(src, dst);
+			TEST_CHECK(error <= 1e-5, "%s %ux%u+%u differs from the reference by %g", sobel_isa_name(isa), width, height, padding, error);
+			TEST_CHECK(dst.guard_intact(), "%s %ux%u+%u wrote past the rows", sobel_isa_name(isa), width, height, padding);
+		}
+	}
+}
+
+int main() {
+	const uint32_t nodes = sobel_numa_nodes();
+	TEST_CHECK(nodes != 0u, "no NUMA node");
+
+	for (const TestShape& shape : kTestShapes) {
+		test_numa_shape(shape.width, shape.height);
+	}
+	for (const TestShape& shape : kTallShapes) {
+		test_numa_shape(shape.width, shape.height);
+	}
+
+	std::vector<SobelNumaNode> report(nodes);
+	const uint32_t reported = sobel_numa_report(64u, 64u, report.data(), nodes);
+	TEST_CHECK(reported == nodes, "report covers %u of %u nodes", reported, nodes);
+	for (uint32_t i = 0u; i < std::min(reported, nodes); ++i) {
+		TEST_CHECK(report[i].cpus != 0u && report[i].singleThread > 0.0 && report[i].allThreads > 0.0, "node %u: %u cpus, %g and %g Mpix/s", report[i].node, report[i].cpus, report[i].singleThread, report[i].allThreads);
+	}
+
+	return test_result();
+}
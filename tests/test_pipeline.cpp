@@ -0,0 +1,159 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+#include "sobel_pipeline.h"
+
+// Every stage alone against a frame at a time reference, the Sobel stage at every
+// tier, then a five stage chain in several band heights against the same stages run
+// one frame pass each, on odd shapes and padded strides. The empty chain converts
+// 16 bit sources exactly.
+
+static const uint32_t kBandRows[] = { 0u, 1u, 3u };
+
+enum TestStage : uint32_t {
+	kTestBlur,
+	kTestThreshold,
+	kTestDilate,
+	kTestErode
+};
+
+static const char* const kStageNames[] = { "blur", "threshold", "dilate", "erode" };
+static constexpr float kThreshold = 0.2f;
+
+static std::unique_ptr<SobelStage> make_stage(TestStage stage) {
+	switch (stage) {
+	case kTestBlur:
+		return sobel_stage_blur();
+	case kTestThreshold:
+		return sobel_stage_threshold(kThreshold);
+	case kTestDilate:
+		return sobel_stage_dilate();
+	default:
+		return sobel_stage_erode();
+	}
+}
+
+// Stage output at (x, y) with clamped borders, in double precision
+static double stage_reference(TestStage stage, const TestImage<float>& image, uint32_t x, uint32_t y) noexcept {
+	static const double kWeights[] = { 1.0, 2.0, 1.0 };
+	const float center = image.row(y)[x];
+	double result = stage == kTestBlur ? 0.0 : center;
+	for (int32_t j = -1; j <= 1; ++j) {
+		for (int32_t i = -1; i <= 1; ++i) {
+			const int64_t sx = std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>(x) + i, 0), image.width - 1);
+			const int64_t sy = std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>(y) + j, 0), image.height - 1);
+			const double p = image.row(static_cast<uint32_t>(sy))[sx];
+			if (stage == kTestBlur) {
+				result += kWeights[j + 1] * kWeights[i + 1] * p / 16.0;
+			} else if (stage == kTestDilate) {
+				result = std::max(result, p);
+			} else if (stage == kTestErode) {
+				result = std::min(result, p);
+			}
+		}
+	}
+	return stage == kTestThreshold ? (center > kThreshold ? 1.0 : 0.0) : result;
+}
+
+static void test_stages(const TestImage<float>& src, uint32_t padding) {
+	for (uint32_t stage = kTestBlur; stage <= kTestErode; ++stage) {
+		SobelPipeline pipeline;
+		pipeline.add(make_stage(static_cast<TestStage>(stage)));
+		TEST_CHECK(pipeline.halo() == (stage == kTestThreshold ? 0u : 1u), "%s halo %u", kStageNames[stage], pipeline.halo());
+
+		TestImage<float> dst(src.width, src.height, padding);
+		pipeline.run(src.pixels(), SobelFormat::kFloat32, dst.pixels(), src.width, src.height, src.bytesPerLine, dst.bytesPerLine);
+
+		double error = 0.0;
+		for (uint32_t y = 0u; y < src.height; ++y) {
+			for (uint32_t x = 0u; x < src.width; ++x) {
+				error = std::max(error, std::fabs(dst.row(y)[x] - stage_reference(static_cast<TestStage>(stage), src, x, y)));
+			}
+		}
+		TEST_CHECK(error <= 1e-6, "%s %ux%u+%u differs from the reference by %g", kStageNames[stage], src.width, src.height, padding, error);
+		TEST_CHECK(dst.guard_intact(), "%s %ux%u+%u wrote past the rows", kStageNames[stage], src.width, src.height, padding);
+	}
+
+	for (SobelIsa isa : test_isas()) {
+		SobelPipeline pipeline;
+		pipeline.add(sobel_stage_sobel(isa));
+		TestImage<float> dst(src.width, src.height, padding);
+		pipeline.run(src.pixels(), SobelFormat::kFloat32, dst.pixels(), src.width, src.height, src.bytesPerLine, dst.bytesPerLine);
+
+		const double error = test_sobel_error(src, dst);
+		TEST_CHECK(error <= 1e-5, "sobel %s %ux%u+%u differs from the reference by %g", sobel_isa_name(isa), src.width, src.height, padding, error);
+		TEST_CHECK(dst.guard_intact(), "sobel %s %ux%u+%u wrote past the rows", sobel_isa_name(isa), src.width, src.height, padding);
+	}
+}
+
+// Blur, Sobel, threshold, dilate and erode fused against one frame pass per stage
+static void test_chain(const TestImage<float>& src, uint32_t padding) {
+	const SobelIsa isa = sobel_detect_isa();
+	std::unique_ptr<TestImage<float> > passes(new TestImage<float>(src.width, src.height, padding));
+	memcpy(passes->pixels(), src.pixels(), src.size());
+	for (uint32_t stage = 0u; stage < 5u; ++stage) {
+		SobelPipeline single;
+		single.add(stage == 0u ? sobel_stage_blur() : stage == 1u ? sobel_stage_sobel(isa) : make_stage(static_cast<TestStage>(stage - 1u)));
+		std::unique_ptr<TestImage<float> > next(new TestImage<float>(src.width, src.height, padding));
+		single.run(passes->pixels(), SobelFormat::kFloat32, next->pixels(), src.width, src.height, passes->bytesPerLine, next->bytesPerLine);
+		passes.swap(next);
+	}
+
+	SobelPipeline chain;
+	chain.add(sobel_stage_blur()).add(sobel_stage_sobel(isa)).add(sobel_stage_threshold(kThreshold)).add(sobel_stage_dilate()).add(sobel_stage_erode());
+	TEST_CHECK(chain.halo() == 4u, "chain halo %u", chain.halo());
+
+	for (uint32_t bandRows : kBandRows) {
+		TestImage<float> dst(src.width, src.height, padding);
+		chain.run(src.pixels(), SobelFormat::kFloat32, dst.pixels(), src.width, src.height, src.bytesPerLine, dst.bytesPerLine, bandRows);
+
+		bool same = true;
+		for (uint32_t y = 0u; y < src.height; ++y) {
+			same = same && memcmp(dst.row(y), passes->row(y), src.width * sizeof(float)) == 0;
+		}
+		TEST_CHECK(same, "chain %ux%u+%u in %u row bands differs from a pass per stage", src.width, src.height, padding, bandRows);
+		TEST_CHECK(dst.guard_intact(), "chain %ux%u+%u in %u row bands wrote past the rows", src.width, src.height, padding, bandRows);
+	}
+}
+
+static void test_conversion(uint32_t width, uint32_t height, uint32_t padding) {
+	TestImage<uint16_t> src(width, height, padding);
+	src.fill(width * 47u + height, 65536.0);
+
+	SobelPipeline empty;
+	TestImage<float> dst(width, height, padding);
+	empty.run(src.pixels(), SobelFormat::kUInt16, dst.pixels(), width, height, src.bytesPerLine, dst.bytesPerLine);
+
+	bool same = true;
+	for (uint32_t y = 0u; y < height; ++y) {
+		for (uint32_t x = 0u; x < width; ++x) {
+			same = same && dst.row(y)[x] == static_cast<float>(src.row(y)[x]);
+		}
+	}
+	TEST_CHECK(same, "16 bit %ux%u+%u converted wrongly", width, height, padding);
+	TEST_CHECK(dst.guard_intact(), "16 bit %ux%u+%u wrote past the rows", width, height, padding);
+}
+
+int main() {
+	for (const TestShape& shape : kTestShapes) {
+		for (uint32_t padding : kTestPaddings) {
+			TestImage<float> src(shape.width, shape.height, padding);
+			src.fill(shape.width * 53u + shape.height);
+
+			test_stages(src, padding);
+			test_chain(src, padding);
+			test_conversion(shape.width, shape.height, padding);
+		}
+	}
+
+	return test_result();
+}
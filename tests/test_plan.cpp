@@ -0,0 +1,90 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <thread>
+
+#include "sobel_test.h"
+#include "sobel_plan.h"
+
+// Plans requested at every tier, single and multi threaded, with default and short
+// row bands, on odd shapes and padded strides. The plan has to settle on a tier the
+// strides fit and match the double reference, also for a 16 bit source and when two
+// threads execute it at once. Empty images and short strides give no plan.
+
+static const SobelPlanOptions kOptions[] = { { SobelIsa::kScalar, 1u, 0u }, { SobelIsa::kScalar, 0u, 2u }, { SobelIsa::kScalar, 0u, 0u } };
+
+int main() {
+	for (const TestShape& shape : kTestShapes) {
+		for (uint32_t padding : kTestPaddings) {
+			TestImage<float> src(shape.width, shape.height, padding);
+			TestImage<uint16_t> src16(shape.width, shape.height, padding);
+			TestImage<float> widened(shape.width, shape.height);
+			src.fill(shape.width * 41u + shape.height);
+			src16.fill(shape.width * 43u + shape.height, 60000.0);
+			for (uint32_t y = 0u; y < shape.height; ++y) {
+				for (uint32_t x = 0u; x < shape.width; ++x) {
+					widened.row(y)[x] = static_cast<float>(src16.row(y)[x]);
+				}
+			}
+
+			for (SobelIsa isa : test_isas()) {
+				for (SobelPlanOptions options : kOptions) {
+					options.isa = isa;
+					SobelPlan plan = sobel_plan_create(shape.width, shape.height, src.bytesPerLine, src.bytesPerLine, SobelFormat::kFloat32, SobelFormat::kFloat32, &options);
+					TEST_CHECK(plan != nullptr, "%s %ux%u+%u has no plan", sobel_isa_name(isa), shape.width, shape.height, padding);
+					if (plan == nullptr) {
+						continue;
+					}
+
+					const SobelIsa planIsa = sobel_plan_isa(plan);
+					TEST_CHECK(sobel_isa_supported(planIsa) && test_stride_ok(planIsa, src.bytesPerLine), "%s %ux%u+%u planned %s", sobel_isa_name(isa), shape.width, shape.height, padding, sobel_isa_name(planIsa));
+
+					TestImage<float> first(shape.width, shape.height, padding);
+					TestImage<float> second(shape.width, shape.height, padding);
+					std::thread other([&]() { sobel_plan_execute(plan, src.pixels(), second.pixels()); });
+					sobel_plan_execute(plan, src.pixels(), first.pixels());
+					other.join();
+
+					const double error = test_sobel_error(src, first);
+					TEST_CHECK(error <= 1e-5, "%s %ux%u+%u %u threads %u rows differs from the reference by %g", sobel_isa_name(isa), shape.width, shape.height, padding, options.threads, options.bandRows, error);
+					TEST_CHECK(memcmp(first.pixels(), second.pixels(), first.size()) == 0, "%s %ux%u+%u concurrent executions differ", sobel_isa_name(isa), shape.width, shape.height, padding);
+					TEST_CHECK(first.guard_intact() && second.guard_intact(), "%s %ux%u+%u wrote past the rows", sobel_isa_name(isa), shape.width, shape.height, padding);
+					sobel_plan_destroy(plan);
+				}
+
+				const SobelPlanOptions options = { isa, 0u, 0u };
+				TestImage<float> dst(shape.width, shape.height, padding);
+				SobelPlan plan = sobel_plan_create(shape.width, shape.height, src16.bytesPerLine, dst.bytesPerLine, SobelFormat::kUInt16, SobelFormat::kFloat32, &options);
+				TEST_CHECK(plan != nullptr, "%s %ux%u+%u has no 16 bit plan", sobel_isa_name(isa), shape.width, shape.height, padding);
+				if (plan != nullptr) {
+					sobel_plan_execute(plan, src16.pixels(), dst.pixels());
+					double error = 0.0;
+					for (uint32_t y = 0u; y < shape.height; ++y) {
+						for (uint32_t x = 0u; x < shape.width; ++x) {
+							const double reference = test_sobel(widened, x, y);
+							error = std::max(error, std::fabs(dst.row(y)[x] - reference) / std::max(reference, 1.0));
+						}
+					}
+					TEST_CHECK(error <= 1e-5, "%s %ux%u+%u 16 bit source differs from the reference by %g", sobel_isa_name(isa), shape.width, shape.height, padding, error);
+					TEST_CHECK(dst.guard_intact(), "%s %ux%u+%u 16 bit source wrote past the rows", sobel_isa_name(isa), shape.width, shape.height, padding);
+					sobel_plan_destroy(plan);
+				}
+			}
+		}
+	}
+
+	const SobelPlanOptions options = { sobel_detect_isa(), 0u, 0u };
+	TEST_CHECK(sobel_plan_create(0u, 8u, 64u, 64u, SobelFormat::kFloat32, SobelFormat::kFloat32, &options) == nullptr, "empty image planned");
+	TEST_CHECK(sobel_plan_create(17u, 8u, 64u, 128u, SobelFormat::kFloat32, SobelFormat::kFloat32, &options) == nullptr, "short source stride planned");
+	TEST_CHECK(sobel_plan_create(17u, 8u, 128u, 32u, SobelFormat::kFloat32, SobelFormat::kFloat32, &options) == nullptr, "short destination stride planned");
+
+	return test_result();
+}
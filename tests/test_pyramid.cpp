@@ -0,0 +1,93 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+#include "sobel_pyramid.h"
+
+// Pyramids of every tier on odd shapes and padded strides: each level has to be the
+// 2x2 box average of the level above with odd edges averaged with themselves, and its
+// magnitude the double reference of that level. The large shapes go through the
+// wavefront of bands on the worker threads, with levels several bands high.
+
+static constexpr uint32_t kLevels = 5u;
+
+static const TestShape kWavefrontShapes[] = { { 517u, 389u }, { 1024u, 131u } };
+
+static void test_pyramid(const TestShape& shape) {
+	for (uint32_t padding : kTestPaddings) {
+		TestImage<float> src(shape.width, shape.height, padding);
+		src.fill(shape.width * 13u + shape.height);
+		std::vector<uint8_t> arena(sobel_pyramid_size(shape.width, shape.height, kLevels));
+
+		for (SobelIsa isa : test_isas()) {
+			if (!test_stride_ok(isa, src.bytesPerLine)) {
+				continue;
+			}
+
+			SobelPyramidLevel levels[kLevels];
+			sobel_pyramid(src.pixels(), shape.width, shape.height, src.bytesPerLine, kLevels, arena.data(), levels, isa);
+
+			uint32_t width = shape.width;
+			uint32_t height = shape.height;
+			for (uint32_t k = 0u; k < kLevels; ++k) {
+				const SobelPyramidLevel& level = levels[k];
+				TEST_CHECK(level.width == width && level.height == height, "%s %ux%u+%u level %u is %ux%u, expected %ux%u", sobel_isa_name(isa), shape.width, shape.height, padding, k, level.width, level.height, width, height);
+				TEST_CHECK(level.bytesPerLine % 64u == 0u && level.bytesPerLine >= width * sizeof(float), "%s %ux%u+%u level %u stride %u", sobel_isa_name(isa), shape.width, shape.height, padding, k, level.bytesPerLine);
+				if (level.width != width || level.height != height) {
+					break;
+				}
+
+				// The level in test images, for the reference
+				TestImage<float> image(width, height);
+				TestImage<float> magnitude(width, height);
+				for (uint32_t y = 0u; y < height; ++y) {
+					const float* imageRow = k == 0u ? src.row(y) : reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(level.image) + static_cast<size_t>(y) * level.bytesPerLine);
+					memcpy(image.row(y), imageRow, width * sizeof(float));
+					memcpy(magnitude.row(y), reinterpret_cast<const uint8_t*>(level.magnitude) + static_cast<size_t>(y) * level.bytesPerLine, width * sizeof(float));
+				}
+
+				if (k != 0u) {
+					const SobelPyramidLevel& upper = levels[k - 1u];
+					const float* upperImage = k == 1u ? src.pixels() : upper.image;
+					const uint32_t upperBytesPerLine = k == 1u ? src.bytesPerLine : upper.bytesPerLine;
+					double error = 0.0;
+					for (uint32_t y = 0u; y < height; ++y) {
+						const float* a = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(upperImage) + static_cast<size_t>(2u * y) * upperBytesPerLine);
+						const float* b = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(upperImage) + static_cast<size_t>(std::min(2u * y + 1u, upper.height - 1u)) * upperBytesPerLine);
+						for (uint32_t x = 0u; x < width; ++x) {
+							const uint32_t x1 = std::min(2u * x + 1u, upper.width - 1u);
+							const double expected = 0.25 * (static_cast<double>(a[2u * x]) + a[x1] + b[2u * x] + b[x1]);
+							error = std::max(error, std::fabs(image.row(y)[x] - expected));
+						}
+					}
+					TEST_CHECK(error <= 1e-6, "%s %ux%u+%u level %u image differs by %g", sobel_isa_name(isa), shape.width, shape.height, padding, k, error);
+				}
+
+				const double error = test_sobel_error(image, magnitude);
+				TEST_CHECK(error <= 1e-5, "%s %ux%u+%u level %u magnitude differs by %g", sobel_isa_name(isa), shape.width, shape.height, padding, k, error);
+
+				width = (width + 1u) / 2u;
+				height = (height + 1u) / 2u;
+			}
+		}
+	}
+}
+
+int main() {
+	for (const TestShape& shape : kTestShapes) {
+		test_pyramid(shape);
+	}
+	for (const TestShape& shape : kWavefrontShapes) {
+		test_pyramid(shape);
+	}
+
+	return test_result();
+}
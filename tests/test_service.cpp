@@ -0,0 +1,221 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <thread>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "sobel_test.h"
+#include "sobel_service.h"
+
+// Client processes hammer a small slot table with frames of every test shape, more
+// shapes than the server caches plans for. Some clients exit holding an acquired or
+// submitted slot and one is killed at an arbitrary point; afterwards every slot has
+// to be reclaimable and each result has to match the reference. A frame whose slot
+// a broken client overwrote has to fail rather than complete.
+
+#if defined(__linux__)
+
+static constexpr uint32_t kSlots = 4u;
+static constexpr uint32_t kClients = 8u;
+static constexpr uint32_t kFrames = 60u;
+static constexpr uint32_t kTimeoutMs = 10000u;
+
+// Runs kFrames frames, leaving early without releasing when told to
+static int client_main(const char* name, uint32_t index) {
+	SobelServiceStatus status;
+	SobelClient client = sobel_client_connect(name, &status);
+	TEST_CHECK(client != nullptr, "client %u cannot connect: %s", index, sobel_service_status_string(status));
+	if (client == nullptr) {
+		return test_result();
+	}
+
+	const uint32_t shapes = static_cast<uint32_t>(sizeof(kTestShapes) / sizeof(kTestShapes[0]));
+	for (uint32_t frameIndex = 0u; frameIndex < kFrames; ++frameIndex) {
+		const TestShape& shape = kTestShapes[(index * 5u + frameIndex) % shapes];
+		TestImage<float> src(shape.width, shape.height);
+		src.fill(index * kFrames + frameIndex);
+
+		SobelServiceFrame frame;
+		status = sobel_client_acquire(client, shape.width, shape.height, kTimeoutMs, &frame);
+		TEST_CHECK(status == SobelServiceStatus::kOk, "client %u frame %u acquire: %s", index, frameIndex, sobel_service_status_string(status));
+		if (status != SobelServiceStatus::kOk) {
+			break;
+		}
+		if (index % 3u == 2u && frameIndex == 7u) {
+			_exit(test_result());  // Dies holding an acquired slot
+		}
+
+		for (uint32_t y = 0u; y < shape.height; ++y) {
+			memcpy(reinterpret_cast<uint8_t*>(frame.src) + static_cast<size_t>(y) * frame.bytesPerLine, src.row(y), shape.width * sizeof(float));
+		}
+		status = sobel_client_submit(client, &frame);
+		TEST_CHECK(status == SobelServiceStatus::kOk, "client %u frame %u submit: %s", index, frameIndex, sobel_service_status_string(status));
+		if (index % 3u == 1u && frameIndex == 5u) {
+			_exit(test_result());  // Dies with a submitted slot
+		}
+
+		status = sobel_client_wait(client, &frame, kTimeoutMs);
+		TEST_CHECK(status == SobelServiceStatus::kOk, "client %u frame %u wait: %s", index, frameIndex, sobel_service_status_string(status));
+		if (status == SobelServiceStatus::kOk) {
+			double error = 0.0;
+			for (uint32_t y = 0u; y < shape.height; ++y) {
+				const float* dst = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(frame.dst) + static_cast<size_t>(y) * frame.bytesPerLine);
+				for (uint32_t x = 0u; x < shape.width; ++x) {
+					error = std::max(error, std::fabs(dst[x] - test_sobel(src, x, y)));
+				}
+			}
+			TEST_CHECK(error <= 1e-5, "client %u frame %u %ux%u differs by %g", index, frameIndex, shape.width, shape.height, error);
+		}
+		sobel_client_release(client, &frame);
+	}
+
+	sobel_client_disconnect(client);
+	return test_result();
+}
+
+// Overwrites the width stored in the slot of frame, as a broken client could, by
+// finding the slot's width, height and stride words in the segment
+static bool corrupt_slot(const char* name, const SobelServiceFrame& frame, uint32_t width) {
+	const int fd = shm_open(name, O_RDWR, 0);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) != 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+	const size_t size = static_cast<size_t>(info.st_size);
+	void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		return false;
+	}
+
+	uint32_t* words = static_cast<uint32_t*>(base);
+	bool found = false;
+	for (size_t i = 0u; i + 2u < size / sizeof(uint32_t) && !found; ++i) {
+		if (words[i] == frame.width && words[i + 1u] == frame.height && words[i + 2u] == frame.bytesPerLine) {
+			words[i] = width;
+			found = true;
+		}
+	}
+	munmap(base, size);
+	return found;
+}
+
+int main() {
+	char name[64];
+	snprintf(name, sizeof(name), "/sobel_test_%d", static_cast<int>(getpid()));
+
+	SobelServerOptions options = { kSlots, 257u, 17u, sobel_detect_isa(), 2u };
+	SobelServiceStatus status;
+	SobelServer server = sobel_server_create(name, &options, &status);
+	TEST_CHECK(server != nullptr, "cannot create the server: %s", sobel_service_status_string(status));
+	if (server == nullptr) {
+		return test_result();
+	}
+
+	// Clients fork before the server thread starts, so no child inherits its locks
+	pid_t clients[kClients];
+	for (uint32_t i = 0u; i < kClients; ++i) {
+		clients[i] = fork();
+		if (clients[i] == 0) {
+			_exit(client_main(name, i));
+		}
+		TEST_CHECK(clients[i] > 0, "fork failed");
+	}
+
+	std::thread serving([server]() { sobel_server_run(server); });
+
+	usleep(20000);
+	if (clients[0] > 0) {
+		kill(clients[0], SIGKILL);
+	}
+	for (uint32_t i = 0u; i < kClients; ++i) {
+		int exitStatus = 0;
+		if (clients[i] > 0 && waitpid(clients[i], &exitStatus, 0) == clients[i] && i != 0u) {
+			TEST_CHECK(WIFEXITED(exitStatus) && WEXITSTATUS(exitStatus) == 0, "client %u failed", i);
+		}
+	}
+
+	// Every slot a dead client held comes back
+	SobelClient first = sobel_client_connect(name, &status);
+	SobelClient second = sobel_client_connect(name, &status);
+	TEST_CHECK(first != nullptr && second != nullptr, "cannot connect after the clients: %s", sobel_service_status_string(status));
+	if (first != nullptr && second != nullptr) {
+		SobelServiceFrame frames[kSlots];
+		for (uint32_t i = 0u; i < kSlots; ++i) {
+			status = sobel_client_acquire(first, 3u, 3u, kTimeoutMs, &frames[i]);
+			TEST_CHECK(status == SobelServiceStatus::kOk, "slot %u not reclaimed: %s", i, sobel_service_status_string(status));
+		}
+
+		// Disconnecting one client of a process keeps the slots of the other
+		SobelServiceFrame frame;
+		sobel_client_release(first, &frames[0]);
+		status = sobel_client_acquire(second, 3u, 3u, kTimeoutMs, &frame);
+		TEST_CHECK(status == SobelServiceStatus::kOk, "released slot not acquired: %s", sobel_service_status_string(status));
+		sobel_client_disconnect(first);
+		first = nullptr;
+
+		SobelClient third = sobel_client_connect(name, &status);
+		SobelServiceFrame frees[kSlots];
+		uint32_t freed = 0u;
+		while (third != nullptr && freed < kSlots && sobel_client_acquire(third, 3u, 3u, 0u, &frees[freed]) == SobelServiceStatus::kOk) {
+			++freed;
+		}
+		TEST_CHECK(freed == kSlots - 1u, "%u slots free after a disconnect, expected %u", freed, kSlots - 1u);
+		sobel_client_disconnect(third);
+
+		sobel_client_release(second, &frame);
+	}
+	sobel_client_disconnect(first);
+	sobel_client_disconnect(second);
+
+	// The server refuses a slot whose frame no longer fits it
+	SobelClient broken = sobel_client_connect(name, &status);
+	TEST_CHECK(broken != nullptr, "cannot connect the broken client: %s", sobel_service_status_string(status));
+	if (broken != nullptr) {
+		SobelServiceFrame frame;
+		status = sobel_client_acquire(broken, 13u, 11u, kTimeoutMs, &frame);
+		TEST_CHECK(status == SobelServiceStatus::kOk, "broken client acquire: %s", sobel_service_status_string(status));
+		if (status == SobelServiceStatus::kOk) {
+			TEST_CHECK(corrupt_slot(name, frame, options.maxWidth + 1u), "slot of the 13x11 frame not found in the segment");
+			status = sobel_client_submit(broken, &frame);
+			if (status == SobelServiceStatus::kOk) {
+				status = sobel_client_wait(broken, &frame, kTimeoutMs);
+			}
+			TEST_CHECK(status == SobelServiceStatus::kFailed, "frame of a corrupt slot gave: %s", sobel_service_status_string(status));
+			sobel_client_release(broken, &frame);
+		}
+	}
+	sobel_client_disconnect(broken);
+
+	sobel_server_stop(server);
+	serving.join();
+	sobel_server_destroy(server);
+	return test_result();
+}
+
+#else
+
+int main() {
+	return test_result();
+}
+
+#endif
@@ -0,0 +1,83 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include "sobel_test.h"
+
+// Gradient statistics of every tier against statistics of the double reference, with
+// and without a destination, on odd shapes and padded strides. Pixels within rounding
+// of a bin edge may land in either bin. A histogramMax that is zero, negative or NaN
+// puts every pixel into the last bin.
+
+typedef void (*TestStatsFilter)(const float* __restrict, float* __restrict, uint32_t, uint32_t, uint32_t, uint32_t, float, SobelStats*);
+
+// Indexed by SobelIsa
+static const TestStatsFilter kFilters[] = { sobel_filter_stats, sobel_filter_stats_sse2, sobel_filter_stats_avx2, sobel_filter_stats_avx512, sobel_filter_stats_avx512vl };
+
+static const float kHistogramMaxima[] = { 1.0f, 0.25f, 0.0f, -1.0f, NAN };
+
+int main() {
+	for (const TestShape& shape : kTestShapes) {
+		for (uint32_t padding : kTestPaddings) {
+			TestImage<float> src(shape.width, shape.height, padding);
+			src.fill(shape.width * 11u + shape.height);
+
+			for (float histogramMax : kHistogramMaxima) {
+				// Statistics of the double reference, counting the pixels next to a bin edge
+				const bool binned = histogramMax > 0.0f;
+				SobelStats expected;
+				memset(&expected, 0, sizeof(expected));
+				uint64_t edgePixels = 0u;
+				for (uint32_t y = 0u; y < shape.height; ++y) {
+					for (uint32_t x = 0u; x < shape.width; ++x) {
+						const double magnitude = test_sobel(src, x, y);
+						const double bin = binned ? magnitude * 256.0 / histogramMax : 255.0;
+						expected.focus += magnitude * magnitude;
+						expected.maximum = std::max(expected.maximum, static_cast<float>(magnitude));
+						++expected.histogram[bin < 255.0 ? static_cast<uint32_t>(bin) : 255u];
+						edgePixels += binned && bin < 256.0 && std::fabs(bin - std::nearbyint(bin)) < 1e-3 ? 1u : 0u;
+					}
+				}
+
+				for (SobelIsa isa : test_isas()) {
+					if (!test_stride_ok(isa, src.bytesPerLine)) {
+						continue;
+					}
+
+					TestImage<float> dst(shape.width, shape.height, padding);
+					SobelStats withDst;
+					SobelStats statsOnly;
+					kFilters[static_cast<uint32_t>(isa)](src.pixels(), dst.pixels(), shape.width, shape.height, src.bytesPerLine, dst.bytesPerLine, histogramMax, &withDst);
+					kFilters[static_cast<uint32_t>(isa)](src.pixels(), nullptr, shape.width, shape.height, src.bytesPerLine, 0u, histogramMax, &statsOnly);
+
+					const double error = test_sobel_error(src, dst);
+					TEST_CHECK(error <= 1e-5, "%s %ux%u+%u max %g magnitude differs by %g", sobel_isa_name(isa), shape.width, shape.height, padding, histogramMax, error);
+					TEST_CHECK(dst.guard_intact(), "%s %ux%u+%u max %g wrote past the rows", sobel_isa_name(isa), shape.width, shape.height, padding, histogramMax);
+					TEST_CHECK(withDst.focus == statsOnly.focus && withDst.maximum == statsOnly.maximum && memcmp(withDst.histogram, statsOnly.histogram, sizeof(withDst.histogram)) == 0, "%s %ux%u+%u max %g differs without a destination", sobel_isa_name(isa), shape.width, shape.height, padding, histogramMax);
+
+					TEST_CHECK(std::fabs(withDst.focus - expected.focus) <= 1e-5 * std::max(1.0, expected.focus), "%s %ux%u+%u focus %g, expected %g", sobel_isa_name(isa), shape.width, shape.height, padding, withDst.focus, expected.focus);
+					TEST_CHECK(std::fabs(withDst.maximum - expected.maximum) <= 1e-5f, "%s %ux%u+%u maximum %g, expected %g", sobel_isa_name(isa), shape.width, shape.height, padding, withDst.maximum, expected.maximum);
+
+					uint64_t total = 0u;
+					uint64_t moved = 0u;
+					for (uint32_t bin = 0u; bin < 256u; ++bin) {
+						total += withDst.histogram[bin];
+						moved += withDst.histogram[bin] > expected.histogram[bin] ? withDst.histogram[bin] - expected.histogram[bin] : expected.histogram[bin] - withDst.histogram[bin];
+					}
+					TEST_CHECK(total == static_cast<uint64_t>(shape.width) * shape.height, "%s %ux%u+%u max %g histogram holds %llu pixels", sobel_isa_name(isa), shape.width, shape.height, padding, histogramMax, static_cast<unsigned long long>(total));
+					TEST_CHECK(moved <= 2u * edgePixels, "%s %ux%u+%u max %g histogram differs in %llu counts", sobel_isa_name(isa), shape.width, shape.height, padding, histogramMax, static_cast<unsigned long long>(moved));
+					TEST_CHECK(binned || withDst.histogram[255] == total, "%s %ux%u+%u max %g left pixels outside the last bin", sobel_isa_name(isa), shape.width, shape.height, padding, histogramMax);
+				}
+			}
+		}
+	}
+
+	return test_result();
+}
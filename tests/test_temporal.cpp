@@ -0,0 +1,132 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <memory>
+
+#include "sobel_test.h"
+#include "sobel_temporal.h"
+
+// Spatio-temporal gradients of every tier against a double reference on odd shapes
+// and padded strides, with all outputs and with the magnitude alone. The frame ring
+// has to give the same bits as the single call from a reused frame buffer, start
+// over after a reset, and write nothing for the first two frames.
+
+static constexpr uint32_t kFrames = 5u;
+
+// gx, gy, gt and the magnitude of curr at (x, y) in double precision
+static void temporal_reference(const TestImage<float>* const* frames, uint32_t x, uint32_t y, double* gradient) noexcept {
+	static const double kSmooth[] = { 1.0, 2.0, 1.0 };
+	static const double kDerivative[] = { -1.0, 0.0, 1.0 };
+	const TestImage<float>& curr = *frames[1];
+	gradient[0] = gradient[1] = gradient[2] = 0.0;
+
+	for (uint32_t t = 0u; t < 3u; ++t) {
+		for (int32_t j = -1; j <= 1; ++j) {
+			for (int32_t i = -1; i <= 1; ++i) {
+				const int64_t sx = std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>(x) + i, 0), curr.width - 1);
+				const int64_t sy = std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>(y) + j, 0), curr.height - 1);
+				const double p = frames[t]->row(static_cast<uint32_t>(sy))[sx] / 16.0;
+				gradient[0] += kSmooth[t] * kSmooth[j + 1] * kDerivative[i + 1] * p;
+				gradient[1] += kSmooth[t] * kDerivative[j + 1] * kSmooth[i + 1] * p;
+				gradient[2] += kDerivative[t] * kSmooth[j + 1] * kSmooth[i + 1] * p;
+			}
+		}
+	}
+	gradient[3] = std::sqrt((gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2]) / 3.0);
+}
+
+struct TestOutputs {
+	TestOutputs(uint32_t width, uint32_t height, uint32_t padding) {
+		for (std::unique_ptr<TestImage<float> >& image : images) {
+			image.reset(new TestImage<float>(width, height, padding));
+		}
+		output = { images[0]->pixels(), images[1]->pixels(), images[2]->pixels(), images[3]->pixels(), images[0]->bytesPerLine };
+	}
+
+	bool same(const TestOutputs& other) const noexcept {
+		bool equal = true;
+		for (uint32_t k = 0u; k < 4u; ++k) {
+			equal = equal && memcmp(images[k]->pixels(), other.images[k]->pixels(), images[k]->size()) == 0;
+		}
+		return equal;
+	}
+
+	std::unique_ptr<TestImage<float> > images[4];  // gx, gy, gt and magnitude
+	SobelTemporalOutput output;
+};
+
+static const char* const kOutputNames[] = { "gx", "gy", "gt", "magnitude" };
+
+int main() {
+	for (const TestShape& shape : kTestShapes) {
+		for (uint32_t padding : kTestPaddings) {
+			std::unique_ptr<TestImage<float> > frames[kFrames];
+			for (uint32_t t = 0u; t < kFrames; ++t) {
+				frames[t].reset(new TestImage<float>(shape.width, shape.height, padding));
+				frames[t]->fill(shape.width * 61u + shape.height * 7u + t);
+			}
+			const TestImage<float>* const triple[] = { frames[0].get(), frames[1].get(), frames[2].get() };
+
+			for (SobelIsa isa : test_isas()) {
+				if (!test_stride_ok(isa, frames[0]->bytesPerLine)) {
+					continue;
+				}
+
+				TestOutputs all(shape.width, shape.height, padding);
+				sobel_temporal(frames[0]->pixels(), frames[1]->pixels(), frames[2]->pixels(), shape.width, shape.height, frames[0]->bytesPerLine, &all.output, isa);
+
+				double error[4] = { 0.0, 0.0, 0.0, 0.0 };
+				for (uint32_t y = 0u; y < shape.height; ++y) {
+					for (uint32_t x = 0u; x < shape.width; ++x) {
+						double gradient[4];
+						temporal_reference(triple, x, y, gradient);
+						for (uint32_t k = 0u; k < 4u; ++k) {
+							error[k] = std::max(error[k], std::fabs(all.images[k]->row(y)[x] - gradient[k]));
+						}
+					}
+				}
+				for (uint32_t k = 0u; k < 4u; ++k) {
+					TEST_CHECK(error[k] <= 1e-5, "%s %ux%u+%u %s differs from the reference by %g", sobel_isa_name(isa), shape.width, shape.height, padding, kOutputNames[k], error[k]);
+					TEST_CHECK(all.images[k]->guard_intact(), "%s %ux%u+%u %s wrote past the rows", sobel_isa_name(isa), shape.width, shape.height, padding, kOutputNames[k]);
+				}
+
+				TestImage<float> magnitude(shape.width, shape.height, padding);
+				const SobelTemporalOutput magnitudeOnly = { nullptr, nullptr, nullptr, magnitude.pixels(), magnitude.bytesPerLine };
+				sobel_temporal(frames[0]->pixels(), frames[1]->pixels(), frames[2]->pixels(), shape.width, shape.height, frames[0]->bytesPerLine, &magnitudeOnly, isa);
+				TEST_CHECK(memcmp(magnitude.pixels(), all.images[3]->pixels(), magnitude.size()) == 0, "%s %ux%u+%u magnitude alone differs", sobel_isa_name(isa), shape.width, shape.height, padding);
+
+				// Every frame goes through one reused buffer, twice with a reset in between
+				SobelTemporal stream(shape.width, shape.height, frames[0]->bytesPerLine, isa);
+				TestImage<float> buffer(shape.width, shape.height, padding);
+				for (uint32_t run = 0u; run < 2u; ++run) {
+					for (uint32_t t = 0u; t < kFrames; ++t) {
+						memcpy(buffer.pixels(), frames[t]->pixels(), buffer.size());
+						TestOutputs pushed(shape.width, shape.height, padding);
+						const bool written = stream.push(buffer.pixels(), &pushed.output);
+						TEST_CHECK(written == (t >= 2u), "%s %ux%u+%u push %u of run %u returned %d", sobel_isa_name(isa), shape.width, shape.height, padding, t, run, written ? 1 : 0);
+						if (t < 2u) {
+							TestOutputs untouched(shape.width, shape.height, padding);
+							TEST_CHECK(pushed.same(untouched), "%s %ux%u+%u push %u wrote an output", sobel_isa_name(isa), shape.width, shape.height, padding, t);
+							continue;
+						}
+
+						TestOutputs single(shape.width, shape.height, padding);
+						sobel_temporal(frames[t - 2u]->pixels(), frames[t - 1u]->pixels(), frames[t]->pixels(), shape.width, shape.height, frames[0]->bytesPerLine, &single.output, isa);
+						TEST_CHECK(pushed.same(single), "%s %ux%u+%u push %u of run %u differs from the single call", sobel_isa_name(isa), shape.width, shape.height, padding, t, run);
+					}
+					stream.reset();
+				}
+			}
+		}
+	}
+
+	return test_result();
+}
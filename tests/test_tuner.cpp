@@ -0,0 +1,84 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <thread>
+
+#include "sobel_test.h"
+#include "sobel_internal.h"
+#include "sobel_tuner.h"
+
+// Non-temporal row bands of every tier give the same bits as the cached stores, and
+// the tuned filter matches the double reference on odd shapes and padded strides,
+// stepping down from tuned tiers the strides do not fit. Threads tuning the same new
+// shape at once all get the tuning that was kept.
+
+static constexpr uint32_t kBandRows = 3u;
+static constexpr uint32_t kTuningThreads = 4u;
+
+static void test_concurrent_tuning() {
+	SobelTuning tunings[kTuningThreads];
+	std::vector<std::thread> threads;
+	for (uint32_t i = 0u; i < kTuningThreads; ++i) {
+		threads.emplace_back([&tunings, i] { tunings[i] = sobel_tune(301u, 37u); });
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	const SobelTuning kept = sobel_tune(301u, 37u);
+	for (uint32_t i = 0u; i < kTuningThreads; ++i) {
+		const SobelTuning& tuning = tunings[i];
+		TEST_CHECK(tuning.isa == kept.isa && tuning.bandRows == kept.bandRows && tuning.threads == kept.threads && tuning.streaming == kept.streaming && tuning.megapixelsPerSecond == kept.megapixelsPerSecond, "thread %u tuned 301x37 to %s, %u rows, %u threads instead of the kept %s, %u rows, %u threads", i, sobel_isa_name(tuning.isa), tuning.bandRows, tuning.threads, sobel_isa_name(kept.isa), kept.bandRows, kept.threads);
+	}
+}
+
+int main() {
+	sobel_tune_cache_path(nullptr);
+
+	for (const TestShape& shape : kTestShapes) {
+		const SobelTuning tuning = sobel_tune(shape.width, shape.height);
+		TEST_CHECK(sobel_isa_supported(tuning.isa) && tuning.bandRows != 0u && tuning.threads != 0u, "%ux%u tuned to %s, %u rows, %u threads", shape.width, shape.height, sobel_isa_name(tuning.isa), tuning.bandRows, tuning.threads);
+
+		for (uint32_t padding : kTestPaddings) {
+			TestImage<float> src(shape.width, shape.height, padding);
+			src.fill(shape.width * 23u + shape.height);
+
+			TestImage<float> tuned(shape.width, shape.height, padding);
+			sobel_filter_tuned(src.pixels(), tuned.pixels(), shape.width, shape.height, src.bytesPerLine, tuned.bytesPerLine);
+			const double error = test_sobel_error(src, tuned);
+			TEST_CHECK(error <= 1e-5, "tuned %ux%u+%u differs from the reference by %g", shape.width, shape.height, padding, error);
+			TEST_CHECK(tuned.guard_intact(), "tuned %ux%u+%u wrote past the rows", shape.width, shape.height, padding);
+
+			for (SobelIsa isa : test_isas()) {
+				if (!test_stride_ok(isa, src.bytesPerLine)) {
+					continue;
+				}
+
+				const SobelKernels& kernels = sobel_kernels(isa);
+				TestImage<float> cached(shape.width, shape.height, padding);
+				TestImage<float> streamed(shape.width, shape.height, padding);
+				for (uint32_t firstRow = 0u; firstRow < shape.height; firstRow += kBandRows) {
+					const uint32_t lastRow = std::min(firstRow + kBandRows, shape.height);
+					kernels.rows(src.pixels(), cached.pixels(), shape.width, shape.height, src.bytesPerLine, cached.bytesPerLine, firstRow, lastRow);
+					kernels.rowsStream(src.pixels(), streamed.pixels(), shape.width, shape.height, src.bytesPerLine, streamed.bytesPerLine, firstRow, lastRow);
+				}
+
+				TEST_CHECK(memcmp(cached.pixels(), streamed.pixels(), cached.size()) == 0, "%s %ux%u+%u streamed bands differ from cached ones", sobel_isa_name(isa), shape.width, shape.height, padding);
+				const double bandError = test_sobel_error(src, cached);
+				TEST_CHECK(bandError <= 1e-5, "%s %ux%u+%u bands differ from the reference by %g", sobel_isa_name(isa), shape.width, shape.height, padding, bandError);
+				TEST_CHECK(streamed.guard_intact(), "%s %ux%u+%u streamed past the rows", sobel_isa_name(isa), shape.width, shape.height, padding);
+			}
+		}
+	}
+
+	test_concurrent_tuning();
+	return test_result();
+}
@@ -0,0 +1,366 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sobel_bench_stats.h"
+#include "sobel_filter.h"
+#include "sobel_plan.h"
+
+// Benchmarks the Sobel kernels on a set of image sizes, records the results with
+// the host they ran on as a baseline, and compares later runs against it. Each
+// case is timed as a number of samples of at least kSampleSeconds, samples further
+// than three median absolute deviations from the median are dropped, and a
+// case regresses when its median is slower than the baseline by more than the
+// threshold and a one-sided Mann-Whitney U test rejects "not slower" at kAlpha.
+
+static constexpr double kSampleSeconds = 0.002;
+static constexpr double kAlpha = 0.05;
+static constexpr uint32_t kDefaultSamples = 31u;
+static constexpr double kDefaultThreshold = 5.0;
+
+enum ExitCode {
+	kExitOk = 0,
+	kExitRegression = 1,
+	kExitError = 2
+};
+
+typedef void (*KernelFn)(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst);
+
+struct Kernel {
+	const char* name;
+	KernelFn fn;
+	SobelIsa isa;
+};
+
+// A single thread plan on the best tier, created on the first call for a shape and
+// reused after that, the way a caller filtering a stream of frames would hold it
+static void plan_execute(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) {
+	static SobelPlan plan = nullptr;
+	static uint32_t shape[4] = {};
+	if (plan == nullptr || shape[0] != width || shape[1] != height || shape[2] != bytesPerLineSrc || shape[3] != bytesPerLineDst) {
+		sobel_plan_destroy(plan);
+		const SobelPlanOptions options = { sobel_detect_isa(), 1u, 0u };
+		plan = sobel_plan_create(width, height, bytesPerLineSrc, bytesPerLineDst, SobelFormat::kFloat32, SobelFormat::kFloat32, &options);
+		shape[0] = width;
+		shape[1] = height;
+		shape[2] = bytesPerLineSrc;
+		shape[3] = bytesPerLineDst;
+	}
+	sobel_plan_execute(plan, src, dst);
+}
+
+// The same plan created and destroyed around every call, what planning once saves
+static void plan_create_execute(const float* __restrict src, float* __restrict dst, uint32_t width, uint32_t height, uint32_t bytesPerLineSrc, uint32_t bytesPerLineDst) {
+	const SobelPlanOptions options = { sobel_detect_isa(), 1u, 0u };
+	SobelPlan plan = sobel_plan_create(width, height, bytesPerLineSrc, bytesPerLineDst, SobelFormat::kFloat32, SobelFormat::kFloat32, &options);
+	sobel_plan_execute(plan, src, dst);
+	sobel_plan_destroy(plan);
+}
+
+static const Kernel kKernels[] = {
+	{ "sobel_filter", sobel_filter, SobelIsa::kScalar },
+	{ "sobel_filter_sse2", sobel_filter_sse2, SobelIsa::kSse2 },
+	{ "sobel_filter_avx2", sobel_filter_avx2, SobelIsa::kAvx2 },
+	{ "sobel_filter_avx512vl", sobel_filter_avx512vl, SobelIsa::kAvx512Vl },
+	{ "sobel_filter_avx512", sobel_filter_avx512, SobelIsa::kAvx512 },
+	{ "scharr_filter_avx2", scharr_filter_avx2, SobelIsa::kAvx2 },
+	{ "scharr_filter_avx512vl", scharr_filter_avx512vl, SobelIsa::kAvx512Vl },
+	{ "scharr_filter_avx512", scharr_filter_avx512, SobelIsa::kAvx512 },
+	{ "sobel5_filter_avx2", sobel5_filter_avx2, SobelIsa::kAvx2 },
+	{ "sobel5_filter_avx512vl", sobel5_filter_avx512vl, SobelIsa::kAvx512Vl },
+	{ "sobel5_filter_avx512", sobel5_filter_avx512, SobelIsa::kAvx512 },
+	{ "sobel_plan_execute", plan_execute, SobelIsa::kScalar },
+	{ "sobel_plan_create_execute", plan_create_execute, SobelIsa::kScalar },
+};
+
+static void usage() noexcept {
+	fprintf(stderr,
+		"usage: sobel_bench [options]\n"
+		"  --sizes WxH[,WxH...]    image sizes, default 640x480,1920x1080,3840x2160\n"
+		"  --kernels NAME[,...]    kernels to time, default the sobel_filter tiers the CPU supports\n"
+		"  --samples N             timed samples per case, default %u\n"
+		"  --record FILE           write the results and host as a baseline\n"
+		"  --compare FILE          compare against a baseline, exit 1 on a regression\n"
+		"  --threshold PERCENT     slowdown allowed by --compare, default %.0f\n"
+		"  --list                  print the kernel names\n",
+		kDefaultSamples, kDefaultThreshold);
+}
+
+static std::string read_line(const char* path) {
+	std::string line;
+	FILE* file = fopen(path, "r");
+	if (file != nullptr) {
+		char buffer[256];
+		if (fgets(buffer, sizeof(buffer), file) != nullptr) {
+			line = buffer;
+			line.erase(line.find_last_not_of(" \t\r\n") + 1u);
+		}
+		fclose(file);
+	}
+	return line.empty() ? "unknown" : line;
+}
+
+static Host current_host() {
+	Host host;
+	host.cpu = "unknown";
+
+	FILE* cpuinfo = fopen("/proc/cpuinfo", "r");
+	if (cpuinfo != nullptr) {
+		char line[512];
+		while (fgets(line, sizeof(line), cpuinfo) != nullptr) {
+			if (strncmp(line, "model name", 10) == 0) {
+				const char* colon = strchr(line, ':');
+				if (colon != nullptr) {
+					host.cpu = colon + 1;
+					host.cpu.erase(0u, host.cpu.find_first_not_of(" \t"));
+					host.cpu.erase(host.cpu.find_last_not_of(" \t\r\n") + 1u);
+				}
+				break;
+			}
+		}
+		fclose(cpuinfo);
+	}
+
+	host.isa = sobel_isa_name(sobel_detect_isa());
+	host.governor = read_line("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
+	return host;
+}
+
+// False when the images do not fit in memory
+static bool run_case(const Kernel& kernel, uint32_t width, uint32_t height, uint32_t samples, Result& result) {
+	const uint32_t bytesPerLine = (width * static_cast<uint32_t>(sizeof(float)) + 63u) & ~63u;
+	const size_t bytes = static_cast<size_t>(bytesPerLine) * height;
+	float* src = static_cast<float*>(aligned_alloc(64u, bytes));
+	float* dst = static_cast<float*>(aligned_alloc(64u, bytes));
+	if (src == nullptr || dst == nullptr) {
+		free(src);
+		free(dst);
+		return false;
+	}
+
+	srand(1u);
+	for (size_t i = 0u; i < bytes / sizeof(float); ++i) {
+		src[i] = static_cast<float>(rand() % 256);
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	const auto time = [&](uint32_t calls) {
+		const Clock::time_point start = Clock::now();
+		for (uint32_t i = 0u; i < calls; ++i) {
+			kernel.fn(src, dst, width, height, bytesPerLine, bytesPerLine);
+		}
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	};
+
+	// Warm up, then grow the calls per sample until a sample is long enough to time
+	uint32_t calls = 1u;
+	while (time(calls) < kSampleSeconds && calls < (1u << 20)) {
+		calls *= 2u;
+	}
+
+	std::vector<double> times(samples);
+	for (uint32_t i = 0u; i < samples; ++i) {
+		times[i] = time(calls) / calls;
+	}
+
+	free(src);
+	free(dst);
+
+	result.kernel = kernel.name;
+	result.width = width;
+	result.height = height;
+
+	reject_outliers(times, result);
+	return true;
+}
+
+static bool parse_sizes(const char* text, std::vector<std::pair<uint32_t, uint32_t> >& sizes) {
+	sizes.clear();
+	while (*text != '\0') {
+		char* end;
+		const unsigned long width = strtoul(text, &end, 10);
+		if (*end != 'x') {
+			return false;
+		}
+		const unsigned long height = strtoul(end + 1, &end, 10);
+		if (width == 0u || height == 0u || (*end != ',' && *end != '\0')) {
+			return false;
+		}
+		sizes.push_back(std::make_pair(static_cast<uint32_t>(width), static_cast<uint32_t>(height)));
+		text = (*end == ',') ? end + 1 : end;
+	}
+	return !sizes.empty();
+}
+
+static bool parse_kernels(const char* text, std::vector<const Kernel*>& kernels) {
+	kernels.clear();
+	std::string list(text);
+	size_t start = 0u;
+	for (;;) {
+		const size_t comma = list.find(',', start);
+		const std::string name = list.substr(start, comma - start);
+		const Kernel* found = nullptr;
+		for (const Kernel& kernel : kKernels) {
+			if (name == kernel.name) {
+				found = &kernel;
+			}
+		}
+		if (found == nullptr || !sobel_isa_supported(found->isa)) {
+			fprintf(stderr, "sobel_bench: unknown or unsupported kernel %s\n", name.c_str());
+			return false;
+		}
+		kernels.push_back(found);
+		if (comma == std::string::npos) {
+			return true;
+		}
+		start = comma + 1u;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::pair<uint32_t, uint32_t> > sizes;
+	parse_sizes("640x480,1920x1080,3840x2160", sizes);
+
+	std::vector<const Kernel*> kernels;
+	for (const Kernel& kernel : kKernels) {
+		if (strncmp(kernel.name, "sobel_filter", 12) == 0 && sobel_isa_supported(kernel.isa)) {
+			kernels.push_back(&kernel);
+		}
+	}
+
+	uint32_t samples = kDefaultSamples;
+	double threshold = kDefaultThreshold;
+	const char* recordPath = nullptr;
+	const char* comparePath = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+			if (!parse_sizes(argv[++i], sizes)) {
+				fprintf(stderr, "sobel_bench: bad size list %s\n", argv[i]);
+				return kExitError;
+			}
+		} else if (strcmp(argv[i], "--kernels") == 0 && i + 1 < argc) {
+			if (!parse_kernels(argv[++i], kernels)) {
+				return kExitError;
+			}
+		} else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+			samples = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			recordPath = argv[++i];
+		} else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+			comparePath = argv[++i];
+		} else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+			threshold = strtod(argv[++i], nullptr);
+		} else if (strcmp(argv[i], "--list") == 0) {
+			for (const Kernel& kernel : kKernels) {
+				printf("%s%s\n", kernel.name, sobel_isa_supported(kernel.isa) ? "" : " (unsupported)");
+			}
+			return kExitOk;
+		} else {
+			usage();
+			return kExitError;
+		}
+	}
+
+	if (samples < 5u || threshold < 0.0) {
+		fprintf(stderr, "sobel_bench: need at least 5 samples and a threshold of 0 or more\n");
+		return kExitError;
+	}
+
+	const Host host = current_host();
+	Host baselineHost;
+	std::vector<Result> baseline;
+	if (comparePath != nullptr) {
+		if (!load(comparePath, baselineHost, baseline)) {
+			fprintf(stderr, "sobel_bench: cannot read baseline %s\n", comparePath);
+			return kExitError;
+		}
+		if (baselineHost.cpu != host.cpu) {
+			fprintf(stderr, "sobel_bench: baseline was recorded on \"%s\", this is \"%s\"\n", baselineHost.cpu.c_str(), host.cpu.c_str());
+			return kExitError;
+		}
+		// Another tier runs different code for the same kernel names, the timings do not compare
+		if (baselineHost.isa != host.isa) {
+			fprintf(stderr, "sobel_bench: baseline was recorded with isa %s, this is %s\n", baselineHost.isa.c_str(), host.isa.c_str());
+			return kExitError;
+		}
+		if (baselineHost.governor != host.governor) {
+			fprintf(stderr, "sobel_bench: warning: frequency governor was %s, now %s\n", baselineHost.governor.c_str(), host.governor.c_str());
+		}
+	}
+
+	printf("cpu %s, isa %s, governor %s\n", host.cpu.c_str(), host.isa.c_str(), host.governor.c_str());
+	if (host.governor != "performance" && host.governor != "unknown") {
+		printf("note: the %s governor adds frequency noise, performance is more repeatable\n", host.governor.c_str());
+	}
+	printf("%-26s %11s %11s %7s %6s", "kernel", "size", "median ms", "mad %", "kept");
+	if (comparePath != nullptr) {
+		printf(" %11s %8s %7s", "base ms", "change", "p");
+	}
+	printf("\n");
+
+	std::vector<Result> results;
+	uint32_t regressions = 0u;
+
+	for (const Kernel* kernel : kernels) {
+		for (const std::pair<uint32_t, uint32_t>& size : sizes) {
+			Result r;
+			if (!run_case(*kernel, size.first, size.second, samples, r)) {
+				fprintf(stderr, "sobel_bench: cannot allocate %ux%u images\n", size.first, size.second);
+				return kExitError;
+			}
+			results.push_back(r);
+
+			char shape[32];
+			snprintf(shape, sizeof(shape), "%ux%u", r.width, r.height);
+			printf("%-26s %11s %11.6f %7.2f %3zu/%-2u", r.kernel.c_str(), shape, r.median * 1e3, 100.0 * r.mad / r.median, r.samples.size(), samples);
+
+			if (comparePath != nullptr) {
+				const Result* base = nullptr;
+				for (const Result& b : baseline) {
+					if (b.kernel == r.kernel && b.width == r.width && b.height == r.height) {
+						base = &b;
+					}
+				}
+
+				if (base == nullptr || base->samples.empty()) {
+					printf(" %11s", "new");
+				} else {
+					const double change = 100.0 * (r.median / base->median - 1.0);
+					const double p = mann_whitney_p(base->samples, r.samples);
+					const bool regressed = change > threshold && p < kAlpha;
+					regressions += regressed ? 1u : 0u;
+					printf(" %11.6f %+7.2f%% %7.4f%s", base->median * 1e3, change, p, regressed ? "  REGRESSION" : "");
+				}
+			}
+			printf("\n");
+		}
+	}
+
+	if (recordPath != nullptr && !record(recordPath, host, results)) {
+		fprintf(stderr, "sobel_bench: cannot write baseline %s\n", recordPath);
+		return kExitError;
+	}
+
+	if (regressions != 0u) {
+		printf("%u case(s) slower than the baseline by more than %.1f%%\n", regressions, threshold);
+		return kExitRegression;
+	}
+	return kExitOk;
+}
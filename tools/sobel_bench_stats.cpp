@@ -0,0 +1,151 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "sobel_bench_stats.h"
+
+static constexpr double kOutlierMads = 3.0;
+static constexpr double kMadToSigma = 1.4826;
+
+double median_of(std::vector<double> values) {
+	const size_t middle = values.size() / 2u;
+	std::nth_element(values.begin(), values.begin() + middle, values.end());
+	const double upper = values[middle];
+	if (values.size() % 2u != 0u) {
+		return upper;
+	}
+	return 0.5 * (upper + *std::max_element(values.begin(), values.begin() + middle));
+}
+
+double mad_of(const std::vector<double>& values, double median) {
+	std::vector<double> deviations(values.size());
+	for (size_t i = 0u; i < values.size(); ++i) {
+		deviations[i] = std::fabs(values[i] - median);
+	}
+	return median_of(deviations);
+}
+
+void reject_outliers(const std::vector<double>& times, Result& result) {
+	const double median = median_of(times);
+	const double limit = kOutlierMads * kMadToSigma * mad_of(times, median);
+	result.samples.clear();
+	for (double t : times) {
+		if (std::fabs(t - median) <= limit) {
+			result.samples.push_back(t);
+		}
+	}
+	result.median = median_of(result.samples);
+	result.mad = mad_of(result.samples, result.median);
+}
+
+double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+	double u = 0.0;
+	for (double x : a) {
+		for (double y : b) {
+			u += (y > x) ? 1.0 : (y == x ? 0.5 : 0.0);
+		}
+	}
+
+	// Each run of t equal values in the pooled samples lowers the variance of U
+	std::vector<double> pooled(a);
+	pooled.insert(pooled.end(), b.begin(), b.end());
+	std::sort(pooled.begin(), pooled.end());
+	double ties = 0.0;
+	for (size_t i = 0u; i < pooled.size();) {
+		size_t j = i + 1u;
+		while (j < pooled.size() && pooled[j] == pooled[i]) {
+			++j;
+		}
+		const double t = static_cast<double>(j - i);
+		ties += t * t * t - t;
+		i = j;
+	}
+
+	const double n1 = static_cast<double>(a.size());
+	const double n2 = static_cast<double>(b.size());
+	const double n = n1 + n2;
+	const double variance = n < 2.0 ? 0.0 : n1 * n2 / 12.0 * (n + 1.0 - ties / (n * (n - 1.0)));
+	if (variance <= 0.0) {
+		return 1.0;
+	}
+	const double z = (u - 0.5 * n1 * n2) / std::sqrt(variance);
+	return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+bool record(const char* path, const Host& host, const std::vector<Result>& results) {
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) {
+		return false;
+	}
+
+	fprintf(file, "# sobel_bench baseline: host key value, then case kernel width height median_s samples_s...\n");
+	fprintf(file, "host\tcpu\t%s\n", host.cpu.c_str());
+	fprintf(file, "host\tisa\t%s\n", host.isa.c_str());
+	fprintf(file, "host\tgovernor\t%s\n", host.governor.c_str());
+	for (const Result& r : results) {
+		fprintf(file, "case\t%s\t%u\t%u\t%.9e", r.kernel.c_str(), r.width, r.height, r.median);
+		for (double t : r.samples) {
+			fprintf(file, "\t%.9e", t);
+		}
+		fprintf(file, "\n");
+	}
+	return fclose(file) == 0;
+}
+
+bool load(const char* path, Host& host, std::vector<Result>& results) {
+	FILE* file = fopen(path, "r");
+	if (file == nullptr) {
+		return false;
+	}
+
+	std::vector<char> line(1u << 16);
+	while (fgets(line.data(), static_cast<int>(line.size()), file) != nullptr) {
+		std::vector<std::string> fields;
+		std::string text(line.data());
+		text.erase(text.find_last_not_of("\r\n") + 1u);
+		size_t start = 0u;
+		for (;;) {
+			const size_t tab = text.find('\t', start);
+			fields.push_back(text.substr(start, tab - start));
+			if (tab == std::string::npos) {
+				break;
+			}
+			start = tab + 1u;
+		}
+
+		if (fields.size() == 3u && fields[0] == "host") {
+			if (fields[1] == "cpu") {
+				host.cpu = fields[2];
+			} else if (fields[1] == "isa") {
+				host.isa = fields[2];
+			} else if (fields[1] == "governor") {
+				host.governor = fields[2];
+			}
+		} else if (fields.size() >= 6u && fields[0] == "case") {
+			Result r;
+			r.kernel = fields[1];
+			r.width = static_cast<uint32_t>(strtoul(fields[2].c_str(), nullptr, 10));
+			r.height = static_cast<uint32_t>(strtoul(fields[3].c_str(), nullptr, 10));
+			r.median = strtod(fields[4].c_str(), nullptr);
+			for (size_t i = 5u; i < fields.size(); ++i) {
+				r.samples.push_back(strtod(fields[i].c_str(), nullptr));
+			}
+			r.mad = mad_of(r.samples, r.median);
+			results.push_back(r);
+		}
+	}
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,53 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Sample statistics and baseline files of sobel_bench
+
+struct Host {
+	std::string cpu;
+	std::string isa;
+	std::string governor;
+};
+
+struct Result {
+	std::string kernel;
+	uint32_t width;
+	uint32_t height;
+	double median;                // Seconds per call
+	double mad;
+	std::vector<double> samples;  // After outlier rejection
+};
+
+double median_of(std::vector<double> values);
+
+// Median absolute deviation from median
+double mad_of(const std::vector<double>& values, double median);
+
+// Keeps the times within three median absolute deviations, scaled to standard
+// deviations, of their median as the samples of result, with their median and MAD. With a MAD of 0 more
+// than half the times equal the median, and only those are kept.
+void reject_outliers(const std::vector<double>& times, Result& result);
+
+// p-value for "b is not slower than a", from a one-sided Mann-Whitney U test with
+// the normal approximation corrected for ties. 1 when every sample is tied.
+double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b);
+
+// Writes host and results as a baseline, false when the file cannot be written
+bool record(const char* path, const Host& host, const std::vector<Result>& results);
+
+// Reads a baseline written by record, appending its cases to results
+bool load(const char* path, Host& host, std::vector<Result>& results);
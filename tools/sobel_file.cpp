@@ -0,0 +1,76 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "sobel_file.h"
+#include "sobel_filter.h"
+
+static void usage() noexcept {
+	fprintf(stderr,
+		"usage: sobel_file [options] input output\n"
+		"  --raw WIDTH HEIGHT   input is headerless little endian float32\n"
+		"  --band ROWS          rows per band, default 256\n"
+		"  --isa NAME           scalar, sse2, avx2, avx512vl or avx512, default the best supported\n"
+		"PFM (Pf) and PGM (P5) inputs are recognized from their header, the output keeps the input format.\n");
+}
+
+int main(int argc, char** argv) {
+	const char* paths[2] = { nullptr, nullptr };
+	uint32_t pathCount = 0u;
+	bool raw = false;
+	uint32_t width = 0u;
+	uint32_t height = 0u;
+	uint32_t bandRows = 0u;
+	SobelIsa isa = sobel_detect_isa();
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--raw") == 0 && i + 2 < argc) {
+			raw = true;
+			width = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+			height = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		} else if (strcmp(argv[i], "--band") == 0 && i + 1 < argc) {
+			bandRows = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		} else if (strcmp(argv[i], "--isa") == 0 && i + 1 < argc) {
+			if (!sobel_isa_parse(argv[++i], &isa) || !sobel_isa_supported(isa)) {
+				fprintf(stderr, "sobel_file: unknown or unsupported isa %s\n", argv[i]);
+				return 1;
+			}
+		} else if (argv[i][0] != '-' && pathCount < 2u) {
+			paths[pathCount++] = argv[i];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+
+	if (pathCount != 2u || (raw && (width == 0u || height == 0u))) {
+		usage();
+		return 1;
+	}
+
+	const SobelFileFormat format = raw ? SobelFileFormat::kRaw : sobel_file_format(paths[0]);
+	if (format == SobelFileFormat::kRaw && !raw) {
+		fprintf(stderr, "sobel_file: %s is not PFM or PGM, use --raw WIDTH HEIGHT for raw floats\n", paths[0]);
+		return 1;
+	}
+
+	const SobelFileStatus status = sobel_filter_file(paths[0], paths[1], format, width, height, bandRows, isa);
+	if (status != SobelFileStatus::kOk) {
+		fprintf(stderr, "sobel_file: %s\n", sobel_file_status_string(status));
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,190 @@
+/*!
+ * Sobel Filter (the "software") provided by Anders Lind ("author") license agreements.
+ * - This software is free for both personal and commercial use. You may install and use it on your computers free of charge.
+ * - You may NOT modify, de-compile, disassemble or reverse engineer the software.
+ * - You may use, copy, sell, redistribute or give the software to third part freely as long as the software is not modified.
+ * - The software remains property of the authors also in case of dissemination to third parties.
+ * - The software's name and logo are not to be used to identify other products or services.
+ * - THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * - The authors reserve the rights to change the license agreements in future versions of the software
+ */
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "sobel_filter.h"
+#include "sobel_service.h"
+
+// Runs the shared memory filter service, or with --client checks a running one:
+// frames are filtered through the service, compared against sobel_filter in this
+// process and timed from submit to result.
+
+static constexpr uint32_t kTimeoutMs = 5000u;
+static constexpr float kTolerance = 1e-4f;
+
+static SobelServer gServer = nullptr;
+
+static void usage() noexcept {
+	fprintf(stderr,
+		"usage: sobel_service [options]\n"
+		"  --name NAME          shared memory name, default /sobel\n"
+		"  --slots N            frame slots, default 8\n"
+		"  --max WxH            largest frame, default 1920x1080\n"
+		"  --threads N          worker tasks per frame, default all\n"
+		"  --isa NAME           scalar, sse2, avx2, avx512vl or avx512, default the best supported\n"
+		"  --client             check a running server instead of serving\n"
+		"  --size WxH           client frame size, default 640x480\n"
+		"  --frames N           client frames, default 100\n");
+}
+
+static bool parse_size(const char* text, uint32_t& width, uint32_t& height) noexcept {
+	char* end;
+	width = static_cast<uint32_t>(strtoul(text, &end, 10));
+	if (*end != 'x') {
+		return false;
+	}
+	height = static_cast<uint32_t>(strtoul(end + 1, &end, 10));
+	return *end == '\0' && width != 0u && height != 0u;
+}
+
+static void stop(int) {
+	sobel_server_stop(gServer);
+}
+
+static int serve(const char* name, const SobelServerOptions& options) noexcept {
+	SobelServiceStatus status;
+	gServer = sobel_server_create(name, &options, &status);
+	if (gServer == nullptr) {
+		fprintf(stderr, "sobel_service: %s\n", sobel_service_status_string(status));
+		return 1;
+	}
+
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+
+	fprintf(stderr, "sobel_service: serving %s, %u slots up to %ux%u\n", name, options.slots, options.maxWidth, options.maxHeight);
+	status = sobel_server_run(gServer);
+	sobel_server_destroy(gServer);
+	return status == SobelServiceStatus::kOk ? 0 : 1;
+}
+
+static int check(const char* name, uint32_t width, uint32_t height, uint32_t frames) noexcept {
+	SobelServiceStatus status;
+	SobelClient client = sobel_client_connect(name, &status);
+	if (client == nullptr) {
+		fprintf(stderr, "sobel_service: %s\n", sobel_service_status_string(status));
+		return 1;
+	}
+
+	const uint32_t bytesPerLine = (width * static_cast<uint32_t>(sizeof(float)) + 63u) & ~63u;
+	const size_t elements = static_cast<size_t>(bytesPerLine / sizeof(float)) * height;
+	std::vector<float> storage(2u * elements + 16u);
+	float* src = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(storage.data()) + 63u) & ~static_cast<uintptr_t>(63u));
+	float* expected = src + elements;
+
+	double totalMs = 0.0;
+	double worstMs = 0.0;
+	uint32_t mismatches = 0u;
+
+	for (uint32_t f = 0u; f < frames && status == SobelServiceStatus::kOk; ++f) {
+		for (size_t i = 0u; i < elements; ++i) {
+			src[i] = static_cast<float>(rand() % 256);
+		}
+		sobel_filter(src, expected, width, height, bytesPerLine, bytesPerLine);
+
+		SobelServiceFrame frame;
+		status = sobel_client_acquire(client, width, height, kTimeoutMs, &frame);
+		if (status != SobelServiceStatus::kOk) {
+			break;
+		}
+		for (uint32_t y = 0u; y < height; ++y) {
+			memcpy(reinterpret_cast<uint8_t*>(frame.src) + static_cast<size_t>(y) * frame.bytesPerLine, reinterpret_cast<const uint8_t*>(src) + static_cast<size_t>(y) * bytesPerLine, width * sizeof(float));
+		}
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		status = sobel_client_submit(client, &frame);
+		if (status == SobelServiceStatus::kOk) {
+			status = sobel_client_wait(client, &frame, kTimeoutMs);
+		}
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (status == SobelServiceStatus::kOk) {
+			totalMs += ms;
+			worstMs = ms > worstMs ? ms : worstMs;
+			for (uint32_t y = 0u; y < height; ++y) {
+				const float* row = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(frame.dst) + static_cast<size_t>(y) * frame.bytesPerLine);
+				const float* reference = &expected[static_cast<size_t>(y) * (bytesPerLine / sizeof(float))];
+				for (uint32_t x = 0u; x < width; ++x) {
+					if (!(std::fabs(row[x] - reference[x]) <= kTolerance * (1.0f + std::fabs(reference[x])))) {
+						++mismatches;
+					}
+				}
+			}
+		}
+		sobel_client_release(client, &frame);
+	}
+
+	sobel_client_disconnect(client);
+
+	if (status != SobelServiceStatus::kOk) {
+		fprintf(stderr, "sobel_service: %s\n", sobel_service_status_string(status));
+		return 1;
+	}
+
+	printf("%u frames of %ux%u, %.3f ms mean and %.3f ms worst from submit to result, %u mismatching pixels\n", frames, width, height, frames != 0u ? totalMs / frames : 0.0, worstMs, mismatches);
+	return mismatches == 0u ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+	const char* name = "/sobel";
+	SobelServerOptions options = { 8u, 1920u, 1080u, sobel_detect_isa(), 0u };
+	bool client = false;
+	uint32_t width = 640u;
+	uint32_t height = 480u;
+	uint32_t frames = 100u;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+			name = argv[++i];
+		} else if (strcmp(argv[i], "--slots") == 0 && i + 1 < argc) {
+			options.slots = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		} else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc) {
+			if (!parse_size(argv[++i], options.maxWidth, options.maxHeight)) {
+				usage();
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			options.threads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		} else if (strcmp(argv[i], "--isa") == 0 && i + 1 < argc) {
+			if (!sobel_isa_parse(argv[++i], &options.isa) || !sobel_isa_supported(options.isa)) {
+				fprintf(stderr, "sobel_service: unknown or unsupported isa %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--client") == 0) {
+			client = true;
+		} else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+			if (!parse_size(argv[++i], width, height)) {
+				usage();
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		} else {
+			usage();
+			return 1;
+		}
+	}
+
+	if (options.slots == 0u) {
+		usage();
+		return 1;
+	}
+
+	return client ? check(name, width, height, frames) : serve(name, options);
+}